@@ -1,64 +1,265 @@
 #include "appointments.h"
-#include "ui.h"
+#include "reminder.h"
+#include "trace.h"
+#include "cow.h"
+#include "wmem.h"
+#include "psort.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <conio.h>
+#include "compat.h"
+
+// The last few dates asked about, each with every appointment touching it.
+// A slot holds while the list's generation is the one it was filled at.
+#define DATE_CACHE_SLOTS 4
+
+typedef struct {
+    Date date;
+    unsigned long long generation;  // 0 while empty
+    int *indices;
+    int count;
+    int capacity;
+} DateCacheSlot;
+
+struct DateCache {
+    DateCacheSlot slots[DATE_CACHE_SLOTS];
+    int next;                       // The slot to refill next, round robin
+};
 
 void init_appointments(AppointmentList *list) {
     list->capacity = 100;
     list->count = 0;
-    list->items = (Appointment*)malloc(sizeof(Appointment) * list->capacity);
+    list->max_duration_minutes = 0;
+    list->reminders = NULL;
+    list->generation = 1;
+    list->dates = (struct DateCache*)wmem_calloc(MEM_INDEXES, 1, sizeof(struct DateCache));
+    list->items = (Appointment*)cow_alloc(MEM_APPOINTMENTS, sizeof(Appointment) * list->capacity);
 }
 
 void free_appointments(AppointmentList *list) {
     if (list->items) {
-        free(list->items);
+        cow_free(list->items);
         list->items = NULL;
     }
+    if (list->dates) {
+        for (int i = 0; i < DATE_CACHE_SLOTS; i++) wmem_free(list->dates->slots[i].indices);
+        wmem_free(list->dates);
+        list->dates = NULL;
+    }
     list->count = 0;
     list->capacity = 0;
+    list->max_duration_minutes = 0;
 }
 
-int add_appointment(AppointmentList *list, Appointment *appointment) {
-    // Resize if necessary
-    if (list->count >= list->capacity) {
-        list->capacity *= 2;
-        Appointment *new_items = (Appointment*)realloc(list->items, sizeof(Appointment) * list->capacity);
-        if (!new_items) return 0;
-        list->items = new_items;
+// Take a copy into a slot that is already in start order
+static void place_appointment(AppointmentList *list, int index, const Appointment *appointment) {
+    list->items[index] = *appointment;
+    list->items[index].reminder_timer = 0;
+    if (list->reminders) reminder_schedule(list->reminders, &list->items[index]);
+    
+    // Only ever raised between sorts; an upper bound is all the search needs
+    if (appointment->duration_minutes > list->max_duration_minutes) {
+        list->max_duration_minutes = appointment->duration_minutes;
     }
+}
+
+int reserve_appointments(AppointmentList *list, int count) {
+    int capacity = list->capacity ? list->capacity : 100;
+    while (capacity < count) capacity *= 2;
+    
+    // Every change to the items comes through here first
+    list->generation++;
+    
+    // Also where the list parts from any snapshot still sharing its items
+    Appointment *items = (Appointment*)cow_reserve(MEM_APPOINTMENTS, list->items, sizeof(Appointment) * list->count,
+                                                   sizeof(Appointment) * capacity);
+    if (!items) return 0;
+    list->items = items;
+    list->capacity = capacity;
+    return 1;
+}
+
+void snapshot_appointments(AppointmentList *list, AppointmentList *snapshot) {
+    *snapshot = *list;
+    snapshot->items = (Appointment*)cow_retain(list->items);
+    snapshot->reminders = NULL;
     
-    list->items[list->count] = *appointment;
-    list->count++;
+    // The cache is the owner's; a snapshot may be read on another thread
+    snapshot->dates = NULL;
+}
+
+void release_appointments_snapshot(AppointmentList *snapshot) {
+    cow_release(snapshot->items);
+    snapshot->items = NULL;
+    snapshot->count = 0;
+    snapshot->capacity = 0;
+}
+
+static int upper_bound_start(AppointmentList *list, DateTime when);
+
+// Appointments sorted by start through their keys: each part of the work is
+// a range that psort_for may hand to a thread of its own
+typedef struct {
+    const Appointment *items;
+    SortPair *pairs;
+    Appointment *sorted;
+} StartSort;
+
+static void take_keys(void *context, int part, int first, int end) {
+    StartSort *sort = (StartSort*)context;
+    (void)part;
+    
+    for (int i = first; i < end; i++) {
+        sort->pairs[i].key = datetime_key(sort->items[i].date_time);
+        sort->pairs[i].index = i;
+    }
+}
+
+static void gather(void *context, int part, int first, int end) {
+    StartSort *sort = (StartSort*)context;
+    (void)part;
+    
+    for (int i = first; i < end; i++) {
+#if defined(__GNUC__) || defined(__clang__)
+        if (i + 8 < end) {
+            const char *ahead = (const char*)&sort->items[sort->pairs[i + 8].index];
+            for (size_t line = 0; line < sizeof(Appointment); line += 64) __builtin_prefetch(ahead + line);
+        }
+#endif
+        sort->sorted[i] = sort->items[sort->pairs[i].index];
+    }
+}
+
+// Pairs for items in start order, equal starts kept in the order given.
+// Returns NULL when out of memory; moved is 0 if items were in order.
+static SortPair *sort_starts(const Appointment *items, int count, int *moved) {
+    SortPair *pairs = (SortPair*)wmem_malloc(MEM_INDEXES, sizeof(SortPair) * (count ? count : 1));
+    if (!pairs) return NULL;
+    
+    StartSort sort = {items, pairs, NULL};
+    psort_for(count, psort_parts(count), take_keys, &sort);
+    
+    int passes = psort_pairs(pairs, count);
+    if (passes < 0) {
+        wmem_free(pairs);
+        return NULL;
+    }
+    *moved = passes > 0;
+    return pairs;
+}
+
+// Follow each cycle of the permutation, so every appointment still moves
+// once without a second block
+static void permute_in_place(Appointment *items, SortPair *pairs, int count) {
+    for (int i = 0; i < count; i++) {
+        if (pairs[i].index < 0 || pairs[i].index == i) continue;
+        
+        Appointment held = items[i];
+        int to = i;
+        int from = pairs[i].index;
+        while (from != i) {
+            items[to] = items[from];
+            pairs[to].index = -1;
+            to = from;
+            from = pairs[from].index;
+        }
+        items[to] = held;
+        pairs[to].index = -1;
+    }
+}
+
+int add_appointment(AppointmentList *list, Appointment *appointment) {
+    return add_appointments(list, appointment, 1);
+}
+
+int add_appointments(AppointmentList *list, const Appointment *appointments, int count) {
+    if (count <= 0) return 1;
+    if (!reserve_appointments(list, list->count + count)) return 0;
+    
+    // A single appointment slides in after those starting at the same time
+    if (count == 1) {
+        int index = upper_bound_start(list, appointments[0].date_time);
+        memmove(&list->items[index + 1], &list->items[index], sizeof(Appointment) * (list->count - index));
+        place_appointment(list, index, &appointments[0]);
+        list->count++;
+        return 1;
+    }
     
-    // Keep sorted
-    sort_appointments(list);
+    // Several: sort them on their own, copying each straight to its place,
+    // then merge the two runs from the back, so every appointment already in
+    // the list moves at most once
+    int moved;
+    Appointment *incoming = (Appointment*)wmem_malloc(MEM_APPOINTMENTS, sizeof(Appointment) * count);
+    SortPair *pairs = incoming ? sort_starts(appointments, count, &moved) : NULL;
+    if (!pairs) {
+        wmem_free(incoming);
+        return 0;
+    }
+    StartSort sort = {appointments, pairs, incoming};
+    psort_for(count, psort_parts(count), gather, &sort);
+    wmem_free(pairs);
+    
+    int from = list->count - 1;
+    int next = count - 1;
+    int to = list->count + count - 1;
+    while (next >= 0) {
+        if (from >= 0 && compare_datetimes(list->items[from].date_time, incoming[next].date_time) > 0) {
+            list->items[to--] = list->items[from--];
+        } else {
+            place_appointment(list, to--, &incoming[next--]);
+        }
+    }
+    list->count += count;
     
+    wmem_free(incoming);
     return 1;
 }
 
 int delete_appointment(AppointmentList *list, int index) {
     if (index < 0 || index >= list->count) return 0;
+    if (!reserve_appointments(list, list->count)) return 0;
+    
+    if (list->reminders) reminder_cancel(list->reminders, &list->items[index]);
     
     // Shift items
-    for (int i = index; i < list->count - 1; i++) {
-        list->items[i] = list->items[i + 1];
-    }
+    memmove(&list->items[index], &list->items[index + 1], sizeof(Appointment) * (list->count - index - 1));
     
     list->count--;
     return 1;
 }
 
-int edit_appointment(AppointmentList *list, int index, Appointment *new_appointment) {
-    if (index < 0 || index >= list->count) return 0;
+int delete_appointments(AppointmentList *list, const int *indices, int count) {
+    if (count <= 0) return 1;
+    for (int i = 0; i < count; i++) {
+        if (indices[i] < 0 || indices[i] >= list->count || (i > 0 && indices[i] <= indices[i - 1])) return 0;
+    }
+    if (!reserve_appointments(list, list->count)) return 0;
     
-    list->items[index] = *new_appointment;
-    sort_appointments(list);
+    // Close each gap as it is reached, moving every survivor at most once
+    int to = indices[0];
+    for (int i = 0; i < count; i++) {
+        int next = i + 1 < count ? indices[i + 1] : list->count;
+        int run = next - indices[i] - 1;
+        
+        if (list->reminders) reminder_cancel(list->reminders, &list->items[indices[i]]);
+        memmove(&list->items[to], &list->items[indices[i] + 1], sizeof(Appointment) * run);
+        to += run;
+    }
     
+    list->count -= count;
     return 1;
 }
 
+int edit_appointment(AppointmentList *list, int index, Appointment *new_appointment) {
+    if (index < 0 || index >= list->count) return 0;
+    
+    // The start may have moved, so the appointment is taken out and put back
+    // in order; the reminder timer is replaced on the way
+    Appointment edited = *new_appointment;
+    delete_appointment(list, index);
+    return add_appointment(list, &edited);
+}
+
 // Comparison function for sorting
 static int compare_appointments(const void *a, const void *b) {
     Appointment *app1 = (Appointment*)a;
@@ -66,306 +267,358 @@ static int compare_appointments(const void *a, const void *b) {
     return compare_datetimes(app1->date_time, app2->date_time);
 }
 
-void sort_appointments(AppointmentList *list) {
-    qsort(list->items, list->count, sizeof(Appointment), compare_appointments);
+// On one thread the appointments are moved in place, which beats faulting
+// in a second block; with more, the copy into a new one is split between
+// them, if there is room for it
+static void sort_items(AppointmentList *list) {
+    int parts = psort_parts(list->count);
+    int moved;
+    SortPair *pairs = sort_starts(list->items, list->count, &moved);
+    
+    // Even the pairs didn't fit: the comparator needs no memory
+    if (!pairs) {
+        qsort(list->items, list->count, sizeof(Appointment), compare_appointments);
+        return;
+    }
+    
+    if (moved) {
+        Appointment *sorted = NULL;
+        if (parts > 1) sorted = (Appointment*)cow_alloc(MEM_APPOINTMENTS, sizeof(Appointment) * list->capacity);
+        if (sorted) {
+            StartSort sort = {list->items, pairs, sorted};
+            psort_for(list->count, parts, gather, &sort);
+            cow_free(list->items);
+            list->items = sorted;
+        } else {
+            permute_in_place(list->items, pairs, list->count);
+        }
+    }
+    wmem_free(pairs);
 }
 
-int find_appointments_by_date(AppointmentList *list, Date date, int *indices, int max_indices) {
-    int count = 0;
+void sort_appointments(AppointmentList *list) {
+    if (!reserve_appointments(list, list->count)) return;
     
-    for (int i = 0; i < list->count && count < max_indices; i++) {
-        Appointment *app = &list->items[i];
-        
-        // Calculate end date/time for multi-day appointments
-        DateTime end_time = app->date_time;
-        int remaining_minutes = app->duration_minutes;
-        
-        // Add minutes to get end time
-        end_time.minute += remaining_minutes;
-        while (end_time.minute >= 60) {
-            end_time.hour++;
-            end_time.minute -= 60;
-        }
-        while (end_time.hour >= 24) {
-            end_time.day++;
-            end_time.hour -= 24;
-            
-            // Handle month/year overflow
-            int days_in_month = get_days_in_month(end_time.year, end_time.month);
-            if (end_time.day > days_in_month) {
-                end_time.day -= days_in_month;
-                end_time.month++;
-                if (end_time.month > 12) {
-                    end_time.month = 1;
-                    end_time.year++;
-                }
-            }
+    unsigned long long span = trace_begin();
+    sort_items(list);
+    
+    // Loads end up here; the search bound is recomputed exactly, dropping any slack deletes left
+    list->max_duration_minutes = 0;
+    for (int i = 0; i < list->count; i++) {
+        if (list->items[i].duration_minutes > list->max_duration_minutes) {
+            list->max_duration_minutes = list->items[i].duration_minutes;
         }
+    }
+    trace_end(TRACE_SORT, span);
+}
+
+DateTime get_appointment_end(const Appointment *app) {
+    DateTime end = app->date_time;
+    int minutes = end.hour * 60 + end.minute + app->duration_minutes;
+    Date day = {end.year, end.month, end.day};
+    
+    add_days_to_date(&day, minutes / (24 * 60));
+    minutes %= 24 * 60;
+    
+    end.year = day.year;
+    end.month = day.month;
+    end.day = day.day;
+    end.hour = minutes / 60;
+    end.minute = minutes % 60;
+    return end;
+}
+
+// Last day an appointment touches, following its duration past midnight
+static Date appointment_end_date(const Appointment *app) {
+    DateTime end_time = app->date_time;
+    int remaining_minutes = app->duration_minutes;
+    
+    // Add minutes to get end time
+    end_time.minute += remaining_minutes;
+    while (end_time.minute >= 60) {
+        end_time.hour++;
+        end_time.minute -= 60;
+    }
+    while (end_time.hour >= 24) {
+        end_time.day++;
+        end_time.hour -= 24;
         
-        // Check if the given date falls within the appointment's span
-        Date start_date = {app->date_time.year, app->date_time.month, app->date_time.day};
-        Date end_date = {end_time.year, end_time.month, end_time.day};
-        
-        if (compare_dates(date, start_date) >= 0 && compare_dates(date, end_date) <= 0) {
-            indices[count++] = i;
+        // Handle month/year overflow
+        int days_in_month = get_days_in_month(end_time.year, end_time.month);
+        if (end_time.day > days_in_month) {
+            end_time.day -= days_in_month;
+            end_time.month++;
+            if (end_time.month > 12) {
+                end_time.month = 1;
+                end_time.year++;
+            }
         }
     }
     
-    return count;
+    Date end_date = {end_time.year, end_time.month, end_time.day};
+    return end_date;
 }
 
-int has_appointment_on_date(AppointmentList *list, Date date) {
-    int indices[1];
-    return find_appointments_by_date(list, date, indices, 1) > 0;
+// Index of the first appointment starting at or after the given time
+static int lower_bound_start(AppointmentList *list, DateTime when) {
+    int low = 0;
+    int high = list->count;
+    
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (compare_datetimes(list->items[mid].date_time, when) < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    
+    return low;
 }
 
-// Function to format duration in compact XdYhZm format
-static void format_duration_compact(int total_minutes, char *buffer, int buffer_size) {
-    buffer[0] = '\0';  // Start with empty string
-    
-    if (total_minutes == 0) {
-        strcpy_s(buffer, buffer_size, "0m");
-        return;
+// Index just past the last appointment starting at or before the given time
+static int upper_bound_start(AppointmentList *list, DateTime when) {
+    int low = 0;
+    int high = list->count;
+    
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (compare_datetimes(list->items[mid].date_time, when) <= 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
     }
     
-    int days = total_minutes / (24 * 60);
-    int remaining = total_minutes % (24 * 60);
-    int hours = remaining / 60;
-    int minutes = remaining % 60;
-    
-    char temp[32];
+    return low;
+}
+
+// The list is sorted by start and nothing lasts longer than max_duration_minutes,
+// so only appointments starting between (date - longest span) and the end of the
+// date can cover it. Returns the first index of that slice.
+static int first_candidate(AppointmentList *list, Date date) {
+    int days_back = (list->max_duration_minutes + 24 * 60 - 1) / (24 * 60);
+    Date window_start = date;
+    add_days_to_date(&window_start, -days_back);
+    
+    DateTime from = {window_start.year, window_start.month, window_start.day, 0, 0};
+    return lower_bound_start(list, from);
+}
+
+static int scan_date(AppointmentList *list, Date date, int first, int *indices, int max_indices) {
+    int count = 0;
+    int matched = 0;
     
-    if (days > 0) {
-        sprintf_s(temp, sizeof(temp), "%dd", days);
-        strcat_s(buffer, buffer_size, temp);
+    for (int i = first_candidate(list, date); i < list->count && count < max_indices; i++) {
+        Appointment *app = &list->items[i];
+        Date start_date = {app->date_time.year, app->date_time.month, app->date_time.day};
+        
+        if (compare_dates(start_date, date) > 0) break;    // Starts after the day
+        
+        // Check if the given date falls within the appointment's span
+        if (compare_dates(date, appointment_end_date(app)) <= 0) {
+            if (matched++ >= first) {
+                indices[count++] = i;
+            }
+        }
     }
     
-    if (hours > 0) {
-        sprintf_s(temp, sizeof(temp), "%dh", hours);
-        strcat_s(buffer, buffer_size, temp);
-    }
+    return count;
+}
+
+// The date's slot if it is still good, else NULL
+static DateCacheSlot *lookup_date(AppointmentList *list, Date date) {
+    if (!list->dates) return NULL;
     
-    if (minutes > 0) {
-        sprintf_s(temp, sizeof(temp), "%dm", minutes);
-        strcat_s(buffer, buffer_size, temp);
+    for (int i = 0; i < DATE_CACHE_SLOTS; i++) {
+        DateCacheSlot *slot = &list->dates->slots[i];
+        if (slot->generation == list->generation && compare_dates(slot->date, date) == 0) return slot;
     }
+    return NULL;
 }
 
-// Helper function to read a line with visual feedback
-static void read_line_visual(char *buffer, int max_len, int x, int y) {
-    int pos = 0;
-    char ch;
+// The date's slot, filled with the whole day if it wasn't there; NULL for a
+// snapshot, or when out of memory
+static DateCacheSlot *cached_date(AppointmentList *list, Date date) {
+    DateCacheSlot *slot = lookup_date(list, date);
+    if (slot || !list->dates) return slot;
+    
+    slot = &list->dates->slots[list->dates->next];
+    slot->generation = 0;
+    slot->count = 0;
+    
+    // A full buffer may have stopped the scan short: grow it and go on
+    for (;;) {
+        slot->count += scan_date(list, date, slot->count, slot->indices + slot->count, slot->capacity - slot->count);
+        if (slot->count < slot->capacity) break;
+        
+        int capacity = slot->capacity ? slot->capacity * 2 : 64;
+        int *indices = (int*)wmem_realloc(MEM_INDEXES, slot->indices, sizeof(int) * capacity);
+        if (!indices) return NULL;
+        slot->indices = indices;
+        slot->capacity = capacity;
+    }
     
-    // Show cursor
-    CONSOLE_CURSOR_INFO cursorInfo;
-    HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
-    GetConsoleCursorInfo(hOut, &cursorInfo);
-    cursorInfo.bVisible = TRUE;
-    SetConsoleCursorInfo(hOut, &cursorInfo);
+    slot->date = date;
+    slot->generation = list->generation;
+    list->dates->next = (list->dates->next + 1) % DATE_CACHE_SLOTS;
+    return slot;
+}
+
+int find_appointments_by_date_window(AppointmentList *list, Date date, int first, int *indices, int max_indices) {
+    unsigned long long span = trace_begin();
+    DateCacheSlot *slot = cached_date(list, date);
+    int count;
+    
+    if (slot) {
+        count = first < slot->count ? slot->count - first : 0;
+        if (count > max_indices) count = max_indices;
+        if (count > 0) memcpy(indices, slot->indices + first, sizeof(int) * count);
+    } else {
+        count = scan_date(list, date, first, indices, max_indices);
+    }
     
-    gotoxy(x, y);
+    trace_end(TRACE_FIND_BY_DATE, span);
+    return count;
+}
+
+int find_appointments_in_range(AppointmentList *list, Date from, Date to, int first, int *indices, int max_indices) {
+    int count = 0;
+    int matched = 0;
     
-    while (1) {
-        ch = _getch();
+    for (int i = first_candidate(list, from); i < list->count && count < max_indices; i++) {
+        Appointment *app = &list->items[i];
+        Date start_date = {app->date_time.year, app->date_time.month, app->date_time.day};
+        
+        if (compare_dates(start_date, to) > 0) break;      // Starts after the range
         
-        if (ch == '\r' || ch == '\n') {  // Enter
-            buffer[pos] = '\0';
-            break;
-        } else if (ch == '\b' && pos > 0) {  // Backspace
-            pos--;
-            gotoxy(x + pos, y);
-            printf(" ");
-            gotoxy(x + pos, y);
-        } else if (ch == 27) {  // Escape
-            buffer[0] = '\0';
-            break;
-        } else if (ch >= 32 && ch < 127 && pos < max_len - 1) {  // Printable chars
-            buffer[pos++] = ch;
-            printf("%c", ch);
+        if (compare_dates(from, appointment_end_date(app)) <= 0) {
+            if (matched++ >= first) {
+                indices[count++] = i;
+            }
         }
     }
     
-    // Hide cursor again
-    cursorInfo.bVisible = FALSE;
-    SetConsoleCursorInfo(hOut, &cursorInfo);
+    return count;
 }
 
-void add_appointment_interactive(AppointmentList *list, struct UIState *state) {
-    UIState *ui_state = (UIState *)state;  // Cast to the full type
-    Appointment new_app;
-    char buffer[256];
-    
-    // Clear a section for input
-    int input_y = ui_state->window_height / 2 - 5;
-    int input_x = ui_state->window_width / 2 - 30;
-    
-    // Clear the background area first
-    clear_area(input_x, input_y, 60, 10);
-    
-    // Draw input box
-    draw_box(input_x, input_y, 60, 10, "Add Appointment");
-    
-    // Get date (default to selected date)
-    new_app.date_time.year = ui_state->selected_date.year;
-    new_app.date_time.month = ui_state->selected_date.month;
-    new_app.date_time.day = ui_state->selected_date.day;
-    
-    set_color(NORMAL_FG, NORMAL_BG);
-    
-    // Get time
-    gotoxy(input_x + 2, input_y + 2);
-    printf("Time (HH:MM): ");
-    read_line_visual(buffer, 10, input_x + 16, input_y + 2);
+int find_appointments_by_date(AppointmentList *list, Date date, int *indices, int max_indices) {
+    return find_appointments_by_date_window(list, date, 0, indices, max_indices);
+}
+
+int count_appointments_on_date(AppointmentList *list, Date date) {
+    DateCacheSlot *slot = cached_date(list, date);
+    int count = 0;
     
-    if (strlen(buffer) == 0) return;  // Cancelled
+    if (slot) return slot->count;
     
-    // Parse time
-    int hour, minute;
-    if (sscanf_s(buffer, "%d:%d", &hour, &minute) != 2) {
-        return;  // Invalid format
+    for (int i = first_candidate(list, date); i < list->count; i++) {
+        Appointment *app = &list->items[i];
+        Date start_date = {app->date_time.year, app->date_time.month, app->date_time.day};
+        
+        if (compare_dates(start_date, date) > 0) break;
+        if (compare_dates(date, appointment_end_date(app)) <= 0) count++;
     }
     
-    new_app.date_time.hour = hour;
-    new_app.date_time.minute = minute;
-    
-    // Get duration
-    gotoxy(input_x + 2, input_y + 3);
-    printf("Duration (e.g., 30m, 4h, 3d2h30m): ");
-    read_line_visual(buffer, 20, input_x + 37, input_y + 3);
-    
-    // Parse duration string
-    new_app.duration_minutes = 0;
-    char *p = buffer;
+    return count;
+}
+
+// Parse durations such as "30m", "4h" or "3d2h30m"; a bare number is minutes
+int parse_duration_string(const char *duration_str) {
+    int total_minutes = 0;
     int num = 0;
-    while (*p) {
+    
+    for (const char *p = duration_str; *p; p++) {
         if (*p >= '0' && *p <= '9') {
             num = num * 10 + (*p - '0');
         } else if (*p == 'd' || *p == 'D') {
-            new_app.duration_minutes += num * 24 * 60;
+            total_minutes += num * 24 * 60;
             num = 0;
         } else if (*p == 'h' || *p == 'H') {
-            new_app.duration_minutes += num * 60;
+            total_minutes += num * 60;
             num = 0;
         } else if (*p == 'm' || *p == 'M') {
-            new_app.duration_minutes += num;
+            total_minutes += num;
             num = 0;
         }
-        p++;
     }
     // If there's a number left without a suffix, assume minutes
-    if (num > 0) {
-        new_app.duration_minutes += num;
-    }
+    total_minutes += num;
     
-    // Get description
-    gotoxy(input_x + 2, input_y + 4);
-    printf("Description: ");
-    read_line_visual(new_app.description, MAX_DESCRIPTION_LENGTH - 1, input_x + 15, input_y + 4);
-    
-    if (strlen(new_app.description) == 0) return;  // Cancelled
-    
-    // Add the appointment
-    add_appointment(list, &new_app);
+    return total_minutes;
 }
 
-void edit_appointment_interactive(AppointmentList *list, int index) {
-    if (index < 0 || index >= list->count) return;
-    
-    Appointment *app = &list->items[index];
-    Appointment new_app = *app;  // Copy current appointment
-    char buffer[256];
-    
-    // Get window dimensions for centering
-    CONSOLE_SCREEN_BUFFER_INFO csbi;
-    GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &csbi);
-    int window_width = csbi.srWindow.Right - csbi.srWindow.Left + 1;
-    int window_height = csbi.srWindow.Bottom - csbi.srWindow.Top + 1;
-    
-    // Clear a section for input
-    int input_y = window_height / 2 - 5;
-    int input_x = window_width / 2 - 30;
-    
-    // Clear the background area first
-    clear_area(input_x, input_y, 60, 12);
+// The month grid asks this of every day it shows, more days than the cache
+// holds, so it only takes a slot that is already there; the first match
+// answers it anyway
+int has_appointment_on_date(AppointmentList *list, Date date) {
+    DateCacheSlot *slot = lookup_date(list, date);
+    int indices[1];
     
-    // Draw input box
-    draw_box(input_x, input_y, 60, 12, "Edit Appointment");
+    if (slot) return slot->count > 0;
+    return scan_date(list, date, 0, indices, 1) > 0;
+}
+
+int find_first_appointment_at(AppointmentList *list, DateTime start) {
+    return lower_bound_start(list, start);
+}
+
+// Index of the appointment holding a reminder timer, found through its start time
+int find_appointment_by_timer(AppointmentList *list, DateTime start, int timer) {
+    for (int i = lower_bound_start(list, start); i < list->count; i++) {
+        if (compare_datetimes(list->items[i].date_time, start) != 0) break;
+        if (list->items[i].reminder_timer == timer) return i;
+    }
+    return -1;
+}
+
+// Function to format duration in compact XdYhZm format
+void format_duration_compact(int total_minutes, char *buffer, int buffer_size) {
+    buffer[0] = '\0';  // Start with empty string
     
-    set_color(NORMAL_FG, NORMAL_BG);
+    if (total_minutes == 0) {
+        strcpy_s(buffer, buffer_size, "0m");
+        return;
+    }
     
-    // Show current values and get new ones
+    int days = total_minutes / (24 * 60);
+    int remaining = total_minutes % (24 * 60);
+    int hours = remaining / 60;
+    int minutes = remaining % 60;
     
-    // Time
-    gotoxy(input_x + 2, input_y + 2);
-    printf("Time (HH:MM) [%02d:%02d]: ", app->date_time.hour, app->date_time.minute);
-    read_line_visual(buffer, 10, input_x + 26, input_y + 2);
+    char temp[32];
     
-    if (strlen(buffer) > 0) {
-        int hour, minute;
-        if (sscanf_s(buffer, "%d:%d", &hour, &minute) == 2) {
-            new_app.date_time.hour = hour;
-            new_app.date_time.minute = minute;
-        }
+    if (days > 0) {
+        sprintf_s(temp, sizeof(temp), "%dd", days);
+        strcat_s(buffer, buffer_size, temp);
     }
     
-    // Duration
-    gotoxy(input_x + 2, input_y + 3);
-    char duration_str[32];
-    format_duration_compact(app->duration_minutes, duration_str, sizeof(duration_str));
-    printf("Duration [%s]: ", duration_str);
-    // Calculate correct cursor position based on actual text length
-    int cursor_x = input_x + 2 + 10 + (int)strlen(duration_str) + 3; // "Duration [" + duration + "]: "
-    read_line_visual(buffer, 20, cursor_x, input_y + 3);
-    
-    if (strlen(buffer) > 0) {
-        // Parse duration string (same as add)
-        new_app.duration_minutes = 0;
-        char *p = buffer;
-        int num = 0;
-        while (*p) {
-            if (*p >= '0' && *p <= '9') {
-                num = num * 10 + (*p - '0');
-            } else if (*p == 'd' || *p == 'D') {
-                new_app.duration_minutes += num * 24 * 60;
-                num = 0;
-            } else if (*p == 'h' || *p == 'H') {
-                new_app.duration_minutes += num * 60;
-                num = 0;
-            } else if (*p == 'm' || *p == 'M') {
-                new_app.duration_minutes += num;
-                num = 0;
-            }
-            p++;
-        }
-        if (num > 0) {
-            new_app.duration_minutes += num;
-        }
+    if (hours > 0) {
+        sprintf_s(temp, sizeof(temp), "%dh", hours);
+        strcat_s(buffer, buffer_size, temp);
     }
     
-    // Description
-    gotoxy(input_x + 2, input_y + 4);
-    printf("Description:");
-    gotoxy(input_x + 2, input_y + 5);
-    printf("[%.50s]", app->description);
-    gotoxy(input_x + 2, input_y + 6);
-    printf("New: ");
-    read_line_visual(buffer, MAX_DESCRIPTION_LENGTH - 1, input_x + 7, input_y + 6);
-    
-    if (strlen(buffer) > 0) {
-        strcpy_s(new_app.description, MAX_DESCRIPTION_LENGTH, buffer);
+    if (minutes > 0) {
+        sprintf_s(temp, sizeof(temp), "%dm", minutes);
+        strcat_s(buffer, buffer_size, temp);
     }
-    
-    // Update the appointment
-    edit_appointment(list, index, &new_app);
 }
 
 int get_appointment_index_for_display(AppointmentList *list, Date date, int display_index) {
-    int indices[100];  // Max appointments per day
-    int count = find_appointments_by_date(list, date, indices, 100);
+    int index;
     
-    if (display_index >= 0 && display_index < count) {
-        return indices[display_index];
+    if (display_index >= 0 && find_appointments_by_date_window(list, date, display_index, &index, 1) == 1) {
+        return index;
     }
     
     return -1;
+}
+
+size_t appointments_data_bytes(const AppointmentList *list) {
+    size_t bytes = 0;
+    
+    for (int i = 0; i < list->count; i++) {
+        bytes += sizeof(Appointment) - MAX_DESCRIPTION_LENGTH + strlen(list->items[i].description) + 1;
+    }
+    return bytes;
 }
\ No newline at end of file
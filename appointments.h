@@ -1,19 +1,22 @@
 #ifndef APPOINTMENTS_H
 #define APPOINTMENTS_H
 
+#include <stddef.h>
 #include "calendar.h"
 
 #define MAX_APPOINTMENTS 1000
 #define MAX_DESCRIPTION_LENGTH 256
 
-// Forward declaration
-struct UIState;
+struct ReminderWheel;
+struct DateCache;
 
 // Appointment structure
 typedef struct {
     DateTime date_time;
     char description[MAX_DESCRIPTION_LENGTH];
     int duration_minutes;
+    int reminder_minutes;       // Remind this long before the start; 0 for no reminder
+    int reminder_timer;         // Reminder wheel handle while scheduled, 0 otherwise
 } Appointment;
 
 // Appointment list
@@ -21,23 +24,52 @@ typedef struct {
     Appointment *items;
     int count;
     int capacity;
+    int max_duration_minutes;   // At least the longest appointment, bounds the per-date search
+    struct ReminderWheel *reminders;    // When set, adds, edits and deletes keep it in step
+    unsigned long long generation;      // Moves on with every change to the items
+    struct DateCache *dates;            // Recent per-date results; NULL in snapshots
 } AppointmentList;
 
-// Duration parsing
+// Duration parsing and formatting ("3d2h30m")
 int parse_duration_string(const char *duration_str);
+void format_duration_compact(int total_minutes, char *buffer, int buffer_size);
+DateTime get_appointment_end(const Appointment *app);
 
 // Appointment functions
 void init_appointments(AppointmentList *list);
 void free_appointments(AppointmentList *list);
 int add_appointment(AppointmentList *list, Appointment *appointment);
 int delete_appointment(AppointmentList *list, int index);
+// Bulk forms that move each existing appointment at most once; the
+// indices to delete must be in ascending order
+int add_appointments(AppointmentList *list, const Appointment *appointments, int count);
+int delete_appointments(AppointmentList *list, const int *indices, int count);
 int edit_appointment(AppointmentList *list, int index, Appointment *new_appointment);
 void sort_appointments(AppointmentList *list);
+// Room for count appointments in items, which are then the list's own to
+// write; code that writes to items directly calls this first, which also
+// drops the per-date results remembered so far. Returns 0 when out of memory.
+int reserve_appointments(AppointmentList *list, int count);
+
+// A read-only copy in O(1) that shares the items until the list next changes.
+// Take it on the thread that owns the list; it can be read (with the find
+// functions, or storage's savers) and released on any thread.
+void snapshot_appointments(AppointmentList *list, AppointmentList *snapshot);
+void release_appointments_snapshot(AppointmentList *snapshot);
+// The per-date queries remember their last few dates, so asking about the
+// same day again before the list changes costs a copy
 int find_appointments_by_date(AppointmentList *list, Date date, int *indices, int max_indices);
+int find_appointments_by_date_window(AppointmentList *list, Date date, int first, int *indices, int max_indices);
+// Appointments touching any day in [from, to], each once, in start order
+int find_appointments_in_range(AppointmentList *list, Date from, Date to, int first, int *indices, int max_indices);
+int count_appointments_on_date(AppointmentList *list, Date date);
+int get_appointment_index_for_display(AppointmentList *list, Date date, int display_index);
 int has_appointment_on_date(AppointmentList *list, Date date);
-
-// Interactive functions
-void add_appointment_interactive(AppointmentList *list, struct UIState *state);
-void edit_appointment_interactive(AppointmentList *list, int index);
+int find_appointment_by_timer(AppointmentList *list, DateTime start, int timer);
+// Index of the first appointment starting at or after start
+int find_first_appointment_at(AppointmentList *list, DateTime start);
+// Bytes of the items that hold data: spare capacity and the unused part of
+// each description don't count (for --mem-report)
+size_t appointments_data_bytes(const AppointmentList *list);
 
 #endif // APPOINTMENTS_H
\ No newline at end of file
@@ -0,0 +1,467 @@
+#include "archive.h"
+#include "crc32c.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "compat.h"
+
+// ZIP record signatures
+#define ZIP_END_OF_DIRECTORY    0x06054b50u
+#define ZIP_DIRECTORY_ENTRY     0x02014b50u
+#define ZIP_LOCAL_HEADER        0x04034b50u
+
+#define ZIP_METHOD_STORED       0
+#define ZIP_METHOD_DEFLATED     8
+
+// Huffman codes up to this length decode with one table lookup
+#define FAST_BITS 10
+
+static unsigned int read_u16(const unsigned char *p) {
+    return p[0] | (p[1] << 8);
+}
+
+static unsigned int read_u32(const unsigned char *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+// The end-of-directory record, then a comment of up to 64K
+#define END_RECORD_SIZE         22
+#define MAX_COMMENT             0xffff
+
+static int read_at(FILE *file, size_t offset, void *buffer, size_t size) {
+    return fseek(file, (long)offset, SEEK_SET) == 0 && fread(buffer, 1, size, file) == size;
+}
+
+// Find the end-of-directory record in the file's tail and read the
+// directory it points to
+static int read_directory(Archive *archive) {
+    size_t tail = archive->size < END_RECORD_SIZE + MAX_COMMENT ? archive->size : END_RECORD_SIZE + MAX_COMMENT;
+    unsigned char *buffer = (unsigned char*)malloc(tail);
+    int ok = 0;
+
+    if (!buffer || !read_at(archive->file, archive->size - tail, buffer, tail)) {
+        free(buffer);
+        return 0;
+    }
+
+    for (size_t end = tail - END_RECORD_SIZE + 1; end-- > 0; ) {
+        if (read_u32(buffer + end) != ZIP_END_OF_DIRECTORY) continue;
+
+        size_t size = read_u32(buffer + end + 12);
+        size_t offset = read_u32(buffer + end + 16);
+        if (offset > archive->size || size > archive->size - offset) break;
+
+        archive->entries = read_u16(buffer + end + 10);
+        archive->directory_size = size;
+        archive->directory = (unsigned char*)malloc(size ? size : 1);
+        ok = archive->directory && read_at(archive->file, offset, archive->directory, size);
+        break;
+    }
+
+    free(buffer);
+    return ok;
+}
+
+int archive_open(Archive *archive, const char *path) {
+    memset(archive, 0, sizeof(*archive));
+    if (fopen_s(&archive->file, path, "rb") != 0) return 0;
+
+    fseek(archive->file, 0, SEEK_END);
+    long size = ftell(archive->file);
+    archive->size = size > 0 ? (size_t)size : 0;
+
+    if (archive->size < END_RECORD_SIZE || !read_directory(archive)) {
+        archive_close(archive);
+        return 0;
+    }
+    return 1;
+}
+
+void archive_close(Archive *archive) {
+    if (archive->file) fclose(archive->file);
+    free(archive->directory);
+    memset(archive, 0, sizeof(*archive));
+}
+
+// ---------------------------------------------------------------------------
+// Inflate (RFC 1951)
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    unsigned short fast[1 << FAST_BITS];    // symbol << 4 | length, 0 = use the slow path
+    short count[16];                        // Codes of each length
+    short symbol[288];                      // Symbols in canonical order
+} Huffman;
+
+typedef struct {
+    const unsigned char *in;
+    size_t in_size;
+    size_t in_pos;
+    unsigned long long bits;
+    int bit_count;
+    size_t padding;         // Zero bytes fed past the end of the input
+
+    unsigned char *out;
+    size_t out_size;
+    size_t out_pos;
+} Inflater;
+
+static const short length_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const short length_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const short distance_base[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const short distance_extra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+// Keep at least 57 bits buffered. Past the end of the input the buffer is
+// topped up with zeros; overrun() tells whether any of those were consumed.
+static void refill(Inflater *s) {
+    while (s->bit_count <= 56) {
+        unsigned int byte = 0;
+        if (s->in_pos < s->in_size) {
+            byte = s->in[s->in_pos++];
+        } else {
+            s->padding++;
+        }
+        s->bits |= (unsigned long long)byte << s->bit_count;
+        s->bit_count += 8;
+    }
+}
+
+static int overrun(const Inflater *s) {
+    return (s->in_pos + s->padding) * 8 - s->bit_count > s->in_size * 8;
+}
+
+static unsigned int get_bits(Inflater *s, int count) {
+    if (count == 0) return 0;
+
+    refill(s);
+    unsigned int value = (unsigned int)(s->bits & ((1u << count) - 1));
+    s->bits >>= count;
+    s->bit_count -= count;
+    return value;
+}
+
+static int build_huffman(Huffman *h, const unsigned char *lengths, int n) {
+    short offsets[16];
+    unsigned int next_code[16];
+
+    memset(h->count, 0, sizeof(h->count));
+    for (int i = 0; i < n; i++) h->count[lengths[i]]++;
+    h->count[0] = 0;
+
+    // Reject over-subscribed sets; incomplete ones are legal (e.g. one distance code)
+    int left = 1;
+    for (int len = 1; len < 16; len++) {
+        left <<= 1;
+        left -= h->count[len];
+        if (left < 0) return 0;
+    }
+
+    offsets[1] = 0;
+    for (int len = 1; len < 15; len++) offsets[len + 1] = offsets[len] + h->count[len];
+    for (int i = 0; i < n; i++) {
+        if (lengths[i]) h->symbol[offsets[lengths[i]]++] = (short)i;
+    }
+
+    // Lookup table indexed by the next FAST_BITS input bits. Deflate sends
+    // codes most significant bit first, so each code is bit-reversed.
+    unsigned int code = 0;
+    next_code[0] = 0;
+    for (int len = 1; len < 16; len++) {
+        code = (code + h->count[len - 1]) << 1;
+        next_code[len] = code;
+    }
+
+    memset(h->fast, 0, sizeof(h->fast));
+    for (int i = 0; i < n; i++) {
+        int len = lengths[i];
+        if (len == 0 || len > FAST_BITS) continue;
+
+        unsigned int reversed = 0;
+        unsigned int value = next_code[len]++;
+        for (int bit = 0; bit < len; bit++) {
+            reversed = (reversed << 1) | ((value >> bit) & 1);
+        }
+        for (unsigned int j = reversed; j < (1u << FAST_BITS); j += 1u << len) {
+            h->fast[j] = (unsigned short)(i << 4 | len);
+        }
+    }
+
+    return 1;
+}
+
+static int decode_symbol(Inflater *s, const Huffman *h) {
+    refill(s);
+
+    unsigned int entry = h->fast[s->bits & ((1u << FAST_BITS) - 1)];
+    if (entry) {
+        int len = entry & 15;
+        s->bits >>= len;
+        s->bit_count -= len;
+        return (int)(entry >> 4);
+    }
+
+    // Longer codes: walk the canonical code one bit at a time
+    int code = 0, first = 0, index = 0;
+    for (int len = 1; len < 16; len++) {
+        code |= (int)(s->bits & 1);
+        s->bits >>= 1;
+        s->bit_count--;
+
+        int count = h->count[len];
+        if (code - count < first) return h->symbol[index + (code - first)];
+        index += count;
+        first = (first + count) << 1;
+        code <<= 1;
+    }
+
+    return -1;
+}
+
+static int inflate_stored(Inflater *s) {
+    // Skip to the byte boundary; whole bytes may still sit in the bit buffer
+    get_bits(s, s->bit_count & 7);
+
+    unsigned int length = get_bits(s, 16);
+    unsigned int complement = get_bits(s, 16);
+    if (length != (~complement & 0xffff)) return 0;
+    if (length > s->out_size - s->out_pos) return 0;
+
+    while (length--) {
+        s->out[s->out_pos++] = (unsigned char)get_bits(s, 8);
+    }
+    return !overrun(s);
+}
+
+static int inflate_codes(Inflater *s, const Huffman *literals, const Huffman *distances) {
+    for (;;) {
+        int symbol = decode_symbol(s, literals);
+
+        if (symbol < 0 || overrun(s)) return 0;
+        if (symbol < 256) {
+            if (s->out_pos >= s->out_size) return 0;
+            s->out[s->out_pos++] = (unsigned char)symbol;
+            continue;
+        }
+        if (symbol == 256) return 1;
+
+        symbol -= 257;
+        if (symbol >= 29) return 0;
+        size_t length = length_base[symbol] + get_bits(s, length_extra[symbol]);
+
+        symbol = decode_symbol(s, distances);
+        if (symbol < 0 || symbol >= 30) return 0;
+        size_t distance = distance_base[symbol] + get_bits(s, distance_extra[symbol]);
+
+        if (distance > s->out_pos || length > s->out_size - s->out_pos) return 0;
+
+        // Byte by byte: the source may overlap what is being written
+        unsigned char *to = s->out + s->out_pos;
+        const unsigned char *from = to - distance;
+        for (size_t i = 0; i < length; i++) to[i] = from[i];
+        s->out_pos += length;
+    }
+}
+
+static int inflate_fixed(Inflater *s) {
+    static Huffman literals, distances;
+    static int built = 0;
+
+    if (!built) {
+        unsigned char lengths[288];
+        int i = 0;
+        for (; i < 144; i++) lengths[i] = 8;
+        for (; i < 256; i++) lengths[i] = 9;
+        for (; i < 280; i++) lengths[i] = 7;
+        for (; i < 288; i++) lengths[i] = 8;
+        build_huffman(&literals, lengths, 288);
+
+        for (i = 0; i < 30; i++) lengths[i] = 5;
+        build_huffman(&distances, lengths, 30);
+        built = 1;
+    }
+
+    return inflate_codes(s, &literals, &distances);
+}
+
+static int inflate_dynamic(Inflater *s) {
+    static const unsigned char order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+    unsigned char lengths[288 + 30];
+    Huffman lengths_code, literals, distances;
+
+    int literal_count = get_bits(s, 5) + 257;
+    int distance_count = get_bits(s, 5) + 1;
+    int code_count = get_bits(s, 4) + 4;
+    if (literal_count > 286 || distance_count > 30) return 0;
+
+    memset(lengths, 0, sizeof(lengths));
+    for (int i = 0; i < code_count; i++) lengths[order[i]] = (unsigned char)get_bits(s, 3);
+    if (!build_huffman(&lengths_code, lengths, 19)) return 0;
+
+    // Literal and distance code lengths, run-length coded as one sequence
+    int total = literal_count + distance_count;
+    int i = 0;
+    while (i < total) {
+        int symbol = decode_symbol(s, &lengths_code);
+        if (symbol < 0) return 0;
+
+        if (symbol < 16) {
+            lengths[i++] = (unsigned char)symbol;
+            continue;
+        }
+
+        unsigned char value = 0;
+        int repeat;
+        if (symbol == 16) {
+            if (i == 0) return 0;
+            value = lengths[i - 1];
+            repeat = 3 + get_bits(s, 2);
+        } else if (symbol == 17) {
+            repeat = 3 + get_bits(s, 3);
+        } else {
+            repeat = 11 + get_bits(s, 7);
+        }
+        if (i + repeat > total) return 0;
+        while (repeat--) lengths[i++] = value;
+    }
+
+    if (lengths[256] == 0) return 0;    // No end-of-block code
+    if (!build_huffman(&literals, lengths, literal_count)) return 0;
+    if (!build_huffman(&distances, lengths + literal_count, distance_count)) return 0;
+
+    return inflate_codes(s, &literals, &distances);
+}
+
+// With crc, each block's output is checksummed as soon as it is decoded,
+// while it is still in cache
+static int inflate_buffer(const unsigned char *in, size_t in_size, unsigned char *out, size_t out_size,
+                          unsigned int *crc) {
+    Inflater s;
+    int last;
+
+    memset(&s, 0, sizeof(s));
+    s.in = in;
+    s.in_size = in_size;
+    s.out = out;
+    s.out_size = out_size;
+
+    do {
+        size_t block_start = s.out_pos;
+        last = get_bits(&s, 1);
+        int ok;
+        switch (get_bits(&s, 2)) {
+            case 0: ok = inflate_stored(&s); break;
+            case 1: ok = inflate_fixed(&s); break;
+            case 2: ok = inflate_dynamic(&s); break;
+            default: ok = 0; break;
+        }
+        if (!ok || overrun(&s)) return 0;
+        if (crc) *crc = crc32c(*crc, out + block_start, s.out_pos - block_start);
+    } while (!last);
+
+    return s.out_pos == out_size;
+}
+
+// ---------------------------------------------------------------------------
+// Directory lookup
+// ---------------------------------------------------------------------------
+
+static const char *base_name(const char *name, size_t length, size_t *base_length) {
+    const char *base = name;
+    for (size_t i = 0; i < length; i++) {
+        if (name[i] == '/' || name[i] == '\\') base = name + i + 1;
+    }
+    *base_length = length - (size_t)(base - name);
+    return base;
+}
+
+// The member's directory entry, or NULL
+static const unsigned char *find_entry(Archive *archive, const char *name) {
+    const unsigned char *directory = archive->directory;
+    size_t length = archive->directory_size;
+    size_t position = 0;
+    size_t name_length = strlen(name);
+
+    if (!directory) return NULL;
+
+    for (unsigned int e = 0; e < archive->entries; e++) {
+        if (position + 46 > length || read_u32(directory + position) != ZIP_DIRECTORY_ENTRY) return NULL;
+
+        const unsigned char *entry = directory + position;
+        size_t entry_name_length = read_u16(entry + 28);
+
+        position += 46 + entry_name_length + read_u16(entry + 30) + read_u16(entry + 32);
+        if (position > length) return NULL;
+
+        size_t base_length;
+        const char *base = base_name((const char*)entry + 46, entry_name_length, &base_length);
+        if (base_length == name_length && memcmp(base, name, name_length) == 0) return entry;
+    }
+
+    return NULL;
+}
+
+int archive_contains(Archive *archive, const char *name) {
+    return find_entry(archive, name) != NULL;
+}
+
+char *archive_extract(Archive *archive, const char *name, size_t *size) {
+    return archive_extract_crc(archive, name, size, NULL);
+}
+
+char *archive_extract_crc(Archive *archive, const char *name, size_t *size, unsigned int *crc) {
+    const unsigned char *entry = find_entry(archive, name);
+    if (!entry) return NULL;
+
+    unsigned int method = read_u16(entry + 10);
+    size_t compressed = read_u32(entry + 20);
+    size_t uncompressed = read_u32(entry + 24);
+    size_t header = read_u32(entry + 42);
+
+    // Encrypted members and ZIP64 sizes are left to the external tools
+    if (read_u16(entry + 8) & 1) return NULL;
+    if (compressed == 0xffffffffu || uncompressed == 0xffffffffu) return NULL;
+
+    unsigned char local[30];
+    if (header > archive->size || !read_at(archive->file, header, local, sizeof(local)) ||
+        read_u32(local) != ZIP_LOCAL_HEADER) {
+        return NULL;
+    }
+    size_t offset = header + 30 + read_u16(local + 26) + read_u16(local + 28);
+    if (offset > archive->size || compressed > archive->size - offset) return NULL;
+
+    char *contents = (char*)malloc(uncompressed + 1);
+    if (!contents) return NULL;
+
+    int ok = 0;
+    if (crc) *crc = 0;
+    if (method == ZIP_METHOD_STORED) {
+        ok = compressed == uncompressed && read_at(archive->file, offset, contents, uncompressed);
+        if (ok && crc) *crc = crc32c(0, contents, uncompressed);
+    } else if (method == ZIP_METHOD_DEFLATED) {
+        unsigned char *packed = (unsigned char*)malloc(compressed ? compressed : 1);
+        ok = packed && read_at(archive->file, offset, packed, compressed) &&
+             inflate_buffer(packed, compressed, (unsigned char*)contents, uncompressed, crc);
+        free(packed);
+    }
+
+    if (!ok) {
+        free(contents);
+        return NULL;
+    }
+
+    contents[uncompressed] = '\0';
+    if (size) *size = uncompressed;
+    return contents;
+}
\ No newline at end of file
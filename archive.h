@@ -0,0 +1,34 @@
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+// Read-only access to the data archive without unpacking it to disk. Handles
+// the stored and deflated members that zip and Compress-Archive write;
+// anything else (ZIP64, encryption, other methods) fails so the caller can
+// fall back to the external tools. Opening reads just the directory; each
+// extract reads just that member's bytes.
+typedef struct {
+    FILE *file;
+    size_t size;                // Of the whole file
+    unsigned char *directory;   // The central directory, read whole
+    size_t directory_size;
+    unsigned int entries;
+} Archive;
+
+int archive_open(Archive *archive, const char *path);
+void archive_close(Archive *archive);
+
+// Returns the member's contents as a malloc'd, NUL-terminated buffer (size
+// excludes the terminator), or NULL if it is missing or cannot be decoded.
+// The name matches with or without a leading directory.
+char *archive_extract(Archive *archive, const char *name, size_t *size);
+// The same, also setting crc to the contents' CRC-32C, taken as they are
+// decoded
+char *archive_extract_crc(Archive *archive, const char *name, size_t *size, unsigned int *crc);
+
+// 1 if the directory lists the member, decodable or not
+int archive_contains(Archive *archive, const char *name);
+
+#endif // ARCHIVE_H
\ No newline at end of file
@@ -0,0 +1,466 @@
+#include "batch.h"
+#include "ui.h"
+#include "input.h"
+#include "calendar.h"
+#include "appointments.h"
+#include "todo.h"
+#include "storage.h"
+#include "reminder.h"
+#include "wmem.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "compat.h"
+
+// Script commands, one per line ('#' starts a comment):
+//
+//   today YYYY-MM-DD                      pretend today is this date (reproducible runs)
+//   date YYYY-MM-DD                       select a date
+//   view calendar|appointments|todo       switch the active panel
+//   key NAME [COUNT]                      up down left right pgup pgdn home tab space
+//   add-appointment YYYY-MM-DD HH:MM DURATION [remind DURATION] DESCRIPTION
+//   add-todo normal|high|urgent [due YYYY-MM-DD] DESCRIPTION
+//   delete                                delete the selected item, no confirmation
+//   toggle                                toggle the selected todo
+//   filter all|overdue                    which todos the todo panel lists
+//   size WxH                              screen size used by 'dump screen'
+//   calendar add NAME FILE.ics            merge a read-only calendar into the views
+//   calendar toggle N                     show or hide calendar N (1 is the main one)
+//   calendar reload N                     merge in what changed in calendar N's file
+//   clock YYYY-MM-DD HH:MM                set the reminder clock; later uses print what came due
+//   dump appointments|todos|screen        print a view to stdout
+//   echo TEXT
+//   save                                  write the data file now
+//
+// Data is saved at the end of a script that changed anything.
+
+#define BATCH_LINE_LENGTH 1024
+
+typedef struct {
+    UIState state;
+    AppointmentList appointments;
+    TodoList todos;
+    CalendarSet calendars;
+    ReminderWheel reminders;
+    int reminders_started;
+    int modified;
+} BatchSession;
+
+typedef struct {
+    const char *name;
+    int key;
+} KeyName;
+
+static const KeyName g_key_names[] = {
+    {"up", KEY_UP}, {"down", KEY_DOWN}, {"left", KEY_LEFT}, {"right", KEY_RIGHT},
+    {"pgup", KEY_PGUP}, {"pgdn", KEY_PGDN}, {"home", KEY_HOME},
+    {"tab", KEY_TAB}, {"space", KEY_SPACE}
+};
+
+// Split off the next whitespace separated word; returns NULL at the end of the line
+static char *next_word(char **cursor) {
+    char *p = *cursor;
+    while (*p && isspace((unsigned char)*p)) p++;
+    if (!*p) {
+        *cursor = p;
+        return NULL;
+    }
+
+    char *word = p;
+    while (*p && !isspace((unsigned char)*p)) p++;
+    if (*p) *p++ = '\0';
+    *cursor = p;
+    return word;
+}
+
+// The rest of the line with surrounding whitespace removed
+static char *rest_of_line(char **cursor) {
+    char *p = *cursor;
+    while (*p && isspace((unsigned char)*p)) p++;
+
+    char *end = p + strlen(p);
+    while (end > p && isspace((unsigned char)end[-1])) *--end = '\0';
+
+    *cursor = end;
+    return p;
+}
+
+static void select_view(BatchSession *session, ViewType view) {
+    // Same reset as cycling with Tab
+    session->state.selected_view = view;
+    session->state.cursor_x = 0;
+    session->state.cursor_y = 0;
+    session->state.appointment_display_index = 0;
+    session->state.appointment_scroll = 0;
+    mark_dirty(&session->state, DIRTY_ALL);
+}
+
+static char box_to_ascii(char ch) {
+    switch (ch) {
+        case BOX_VERTICAL: return '|';
+        case BOX_HORIZONTAL: return '-';
+        case BOX_TOP_LEFT: case BOX_TOP_RIGHT:
+        case BOX_BOTTOM_LEFT: case BOX_BOTTOM_RIGHT:
+        case BOX_CROSS: case BOX_T_DOWN: case BOX_T_UP:
+        case BOX_T_RIGHT: case BOX_T_LEFT:
+            return '+';
+    }
+    return ch;
+}
+
+static void dump_screen(BatchSession *session) {
+    mark_dirty(&session->state, DIRTY_ALL);
+    compose_ui(&session->state, &session->appointments, &session->todos);
+
+    const FrameBuffer *fb = fb_get();
+    char line[BATCH_LINE_LENGTH];
+
+    for (int y = 0; y < fb->height; y++) {
+        int length = 0;
+        for (int x = 0; x < fb->width && length < BATCH_LINE_LENGTH - 1; x++) {
+            line[length++] = box_to_ascii(fb->cells[y * fb->width + x].ch);
+        }
+        while (length > 0 && line[length - 1] == ' ') length--;
+        line[length] = '\0';
+        printf("%s\n", line);
+    }
+}
+
+static void dump_appointments(BatchSession *session) {
+    UIState *state = &session->state;
+    int count = ui_appointment_count(state, &session->appointments, state->selected_date);
+    int merged = session->calendars.count > 1;
+
+    printf("%04d-%02d-%02d: %d appointment%s\n", state->selected_date.year, state->selected_date.month,
+           state->selected_date.day, count, count == 1 ? "" : "s");
+
+    // Same merged order as the panel; the calendar is named once there are several
+    for (int i = 0; i < count; i++) {
+        AppointmentRef ref;
+        if (!ui_appointments_on_date(state, &session->appointments, state->selected_date, i, &ref, 1)) break;
+
+        const Appointment *app = ref.app;
+        int selected = state->selected_view == VIEW_APPOINTMENTS && i == state->appointment_display_index;
+        char calendar[MAX_CALENDAR_NAME + 4] = "";
+        char reminder[32] = "";
+
+        if (merged) {
+            sprintf_s(calendar, sizeof(calendar), "[%s] ", session->calendars.calendars[ref.calendar].name);
+        }
+        if (app->reminder_minutes > 0) {
+            sprintf_s(reminder, sizeof(reminder), "!%dm ", app->reminder_minutes);
+        }
+
+        printf("%c %04d-%02d-%02d %02d:%02d %5dm %s%s%s\n", selected ? '>' : ' ',
+               app->date_time.year, app->date_time.month, app->date_time.day,
+               app->date_time.hour, app->date_time.minute, app->duration_minutes, calendar, reminder,
+               app->description);
+    }
+}
+
+static void dump_todos(BatchSession *session) {
+    UIState *state = &session->state;
+    static const char *priorities[] = {"normal", "high", "urgent"};
+
+    int count = ui_todo_count(state, &session->todos);
+
+    // Lists what the todo panel would, so the overdue filter applies
+    printf("%d todo%s\n", count, count == 1 ? "" : "s");
+
+    for (int position = 0; position < count; position++) {
+        TodoItem *todo = todo_at(&session->todos, ui_todo_index(state, &session->todos, position));
+        int selected = state->selected_view == VIEW_TODO && position == state->todo_scroll + state->cursor_y;
+        int priority = todo->priority >= 0 && todo->priority <= 2 ? todo->priority : 0;
+        char due[16] = "";
+
+        if (todo->due.year) {
+            sprintf_s(due, sizeof(due), "%04d-%02d-%02d", todo->due.year, todo->due.month, todo->due.day);
+        }
+
+        printf("%c %d. [%c] %-6s %-10s %s\n", selected ? '>' : ' ', position + 1, todo->completed ? 'X' : ' ',
+               priorities[priority], due, todo->description);
+    }
+}
+
+// Run one script line; returns an error message or NULL on success
+static const char *run_command(BatchSession *session, char *line) {
+    UIState *state = &session->state;
+    char *cursor = line;
+    char *command = next_word(&cursor);
+
+    if (!command || command[0] == '#') return NULL;
+
+    if (strcmp(command, "today") == 0) {
+        if (!parse_date(next_word(&cursor), &state->current_date)) return "expected YYYY-MM-DD";
+        state->selected_date = state->current_date;
+        mark_dirty(state, DIRTY_ALL);
+    } else if (strcmp(command, "date") == 0) {
+        if (!parse_date(next_word(&cursor), &state->selected_date)) return "expected YYYY-MM-DD";
+        state->appointment_display_index = 0;
+        state->appointment_scroll = 0;
+        if (state->selected_view == VIEW_APPOINTMENTS) state->cursor_y = 0;
+        mark_dirty(state, DIRTY_ALL);
+    } else if (strcmp(command, "view") == 0) {
+        char *name = next_word(&cursor);
+        if (name && strcmp(name, "calendar") == 0) select_view(session, VIEW_CALENDAR);
+        else if (name && strcmp(name, "appointments") == 0) select_view(session, VIEW_APPOINTMENTS);
+        else if (name && strcmp(name, "todo") == 0) select_view(session, VIEW_TODO);
+        else return "expected calendar, appointments or todo";
+    } else if (strcmp(command, "key") == 0) {
+        char *name = next_word(&cursor);
+        char *count_text = next_word(&cursor);
+        int count = count_text ? atoi(count_text) : 1;
+        int key = 0;
+
+        for (size_t i = 0; name && i < sizeof(g_key_names) / sizeof(g_key_names[0]); i++) {
+            if (strcmp(name, g_key_names[i].name) == 0) key = g_key_names[i].key;
+        }
+        if (!key) return "unknown key";
+        if (count < 1) return "bad repeat count";
+
+        if (key == KEY_SPACE) {
+            // Space toggles the selected todo
+            for (int i = 0; i < count; i++) {
+                if (process_input(key, 1, state, &session->appointments, &session->todos) == ACTION_TOGGLE) {
+                    toggle_selected_todo(state, &session->todos);
+                    session->modified = 1;
+                }
+            }
+        } else if (is_navigation_key(key)) {
+            process_input(key, count, state, &session->appointments, &session->todos);
+        } else {
+            for (int i = 0; i < count; i++) {
+                process_input(key, 1, state, &session->appointments, &session->todos);
+            }
+        }
+    } else if (strcmp(command, "add-appointment") == 0) {
+        Appointment app;
+        Date date;
+        char *date_text = next_word(&cursor);
+        char *time_text = next_word(&cursor);
+        char *duration_text = next_word(&cursor);
+
+        memset(&app, 0, sizeof(app));
+        while (isspace((unsigned char)*cursor)) cursor++;
+        if (strncmp(cursor, "remind ", 7) == 0) {
+            next_word(&cursor);
+            char *reminder_text = next_word(&cursor);
+            if (!reminder_text || parse_duration_string(reminder_text) <= 0) return "expected remind DURATION";
+            app.reminder_minutes = parse_duration_string(reminder_text);
+        }
+
+        char *description = rest_of_line(&cursor);
+        if (!parse_date(date_text, &date)) return "expected YYYY-MM-DD";
+        if (!time_text || sscanf_s(time_text, "%d:%d", &app.date_time.hour, &app.date_time.minute) != 2 ||
+            app.date_time.hour < 0 || app.date_time.hour > 23 ||
+            app.date_time.minute < 0 || app.date_time.minute > 59) {
+            return "expected HH:MM";
+        }
+        if (!duration_text) return "expected a duration";
+        if (!*description) return "expected a description";
+
+        app.date_time.year = date.year;
+        app.date_time.month = date.month;
+        app.date_time.day = date.day;
+        app.duration_minutes = parse_duration_string(duration_text);
+        strncpy(app.description, description, MAX_DESCRIPTION_LENGTH - 1);
+
+        if (!add_appointment(&session->appointments, &app)) return "out of memory";
+        session->modified = 1;
+        mark_dirty(state, DIRTY_APPOINTMENTS | DIRTY_CALENDAR);
+    } else if (strcmp(command, "add-todo") == 0) {
+        TodoItem todo;
+        char *priority = next_word(&cursor);
+
+        memset(&todo, 0, sizeof(todo));
+        if (priority && (strcmp(priority, "normal") == 0 || strcmp(priority, "0") == 0)) todo.priority = 0;
+        else if (priority && (strcmp(priority, "high") == 0 || strcmp(priority, "1") == 0)) todo.priority = 1;
+        else if (priority && (strcmp(priority, "urgent") == 0 || strcmp(priority, "2") == 0)) todo.priority = 2;
+        else return "expected normal, high or urgent";
+
+        while (isspace((unsigned char)*cursor)) cursor++;
+        if (strncmp(cursor, "due ", 4) == 0) {
+            next_word(&cursor);
+            if (!parse_date(next_word(&cursor), &todo.due)) return "expected due YYYY-MM-DD";
+        }
+
+        char *description = rest_of_line(&cursor);
+        if (!*description) return "expected a description";
+
+        strncpy(todo.description, description, MAX_TODO_DESCRIPTION - 1);
+        if (!add_todo(&session->todos, &todo)) return "out of memory";
+        session->modified = 1;
+        mark_dirty(state, DIRTY_TODO | DIRTY_CALENDAR);
+    } else if (strcmp(command, "delete") == 0) {
+        if (state->selected_view == VIEW_CALENDAR) return "nothing selected in the calendar view";
+        delete_selection(state, &session->appointments, &session->todos);
+        session->modified = 1;
+    } else if (strcmp(command, "toggle") == 0) {
+        if (state->selected_view != VIEW_TODO ||
+            get_selected_index(state, &session->appointments, &session->todos) < 0) {
+            return "no todo selected";
+        }
+        toggle_selected_todo(state, &session->todos);
+        session->modified = 1;
+    } else if (strcmp(command, "filter") == 0) {
+        char *filter = next_word(&cursor);
+        if (filter && strcmp(filter, "all") == 0) state->todo_filter = TODO_FILTER_ALL;
+        else if (filter && strcmp(filter, "overdue") == 0) state->todo_filter = TODO_FILTER_OVERDUE;
+        else return "expected all or overdue";
+        state->todo_scroll = 0;
+        if (state->selected_view == VIEW_TODO) state->cursor_y = 0;
+        mark_dirty(state, DIRTY_TODO);
+    } else if (strcmp(command, "size") == 0) {
+        char *size = next_word(&cursor);
+        int width, height;
+        if (!size || sscanf_s(size, "%dx%d", &width, &height) != 2 || width < 20 || height < 10) {
+            return "expected WxH (at least 20x10)";
+        }
+        state->window_width = width;
+        state->window_height = height;
+        clamp_appointment_selection(state, &session->appointments);
+        if (state->selected_view == VIEW_TODO) clamp_todo_selection(state, &session->todos);
+        mark_dirty(state, DIRTY_ALL);
+    } else if (strcmp(command, "calendar") == 0) {
+        char *action = next_word(&cursor);
+        if (action && strcmp(action, "add") == 0) {
+            char *name = next_word(&cursor);
+            char *path = rest_of_line(&cursor);
+            if (!name || !*path) return "expected calendar add NAME FILE";
+            if (calset_add_file(&session->calendars, name, path) < 0) return "cannot load calendar";
+        } else if (action && strcmp(action, "toggle") == 0) {
+            char *number = next_word(&cursor);
+            if (!number || calset_toggle(&session->calendars, atoi(number) - 1) < 0) return "no such calendar";
+        } else if (action && strcmp(action, "reload") == 0) {
+            char *number = next_word(&cursor);
+            SyncStats stats;
+            int result = number ? calset_reload(&session->calendars, atoi(number) - 1, &stats) : -1;
+            if (result < 0) return "no such calendar";
+            if (result == 0) return "cannot reload calendar";
+            printf("reloaded %s: %d added, %d changed, %d removed%s\n", session->calendars.calendars[atoi(number) - 1].name,
+                   stats.added, stats.changed, stats.removed, stats.todos_reloaded ? ", todos replaced" : "");
+        } else {
+            return "expected add, toggle or reload";
+        }
+        clamp_appointment_selection(state, &session->appointments);
+        mark_dirty(state, DIRTY_ALL);
+    } else if (strcmp(command, "clock") == 0) {
+        Date date;
+        DateTime now;
+        int fired[MAX_FIRED_REMINDERS];
+        int count;
+        char *time_text;
+
+        if (!parse_date(next_word(&cursor), &date)) return "expected YYYY-MM-DD HH:MM";
+        time_text = next_word(&cursor);
+        if (!time_text || sscanf_s(time_text, "%d:%d", &now.hour, &now.minute) != 2 ||
+            now.hour < 0 || now.hour > 23 || now.minute < 0 || now.minute > 59) {
+            return "expected YYYY-MM-DD HH:MM";
+        }
+        now.year = date.year;
+        now.month = date.month;
+        now.day = date.day;
+
+        // The first clock starts the wheel the way start-up does interactively
+        if (!session->reminders_started) {
+            reminder_init(&session->reminders, datetime_to_minutes(now));
+            reminder_attach(&session->reminders, &session->appointments);
+            session->reminders_started = 1;
+        }
+
+        while ((count = reminder_advance(&session->reminders, &session->appointments, datetime_to_minutes(now),
+                                         fired, MAX_FIRED_REMINDERS)) > 0) {
+            for (int i = 0; i < count; i++) {
+                Appointment *app = &session->appointments.items[fired[i]];
+                char message[MAX_STATUS_MESSAGE];
+
+                reminder_describe(&session->reminders, app, message, sizeof(message));
+                printf("%s\n", message);
+                reminder_run_command(app);
+            }
+        }
+    } else if (strcmp(command, "dump") == 0) {
+        char *what = next_word(&cursor);
+        if (what && strcmp(what, "appointments") == 0) dump_appointments(session);
+        else if (what && strcmp(what, "todos") == 0) dump_todos(session);
+        else if (what && strcmp(what, "screen") == 0) dump_screen(session);
+        else return "expected appointments, todos or screen";
+    } else if (strcmp(command, "echo") == 0) {
+        printf("%s\n", rest_of_line(&cursor));
+    } else if (strcmp(command, "save") == 0) {
+        if (!calset_save_main(&session->calendars, &session->todos)) return "save failed";
+        session->modified = 0;
+    } else {
+        return "unknown command";
+    }
+
+    return NULL;
+}
+
+int run_batch(const char *script_path) {
+    FILE *script = stdin;
+    BatchSession session;
+    char line[BATCH_LINE_LENGTH];
+    int line_number = 0;
+    int result = 0;
+
+    if (script_path && strcmp(script_path, "-") != 0) {
+        if (fopen_s(&script, script_path, "r") != 0) {
+            fprintf(stderr, "wcal: cannot open batch script %s\n", script_path);
+            return 1;
+        }
+    }
+
+    memset(&session, 0, sizeof(session));
+    session.state.selected_view = VIEW_CALENDAR;
+    get_today(&session.state.current_date);
+    session.state.selected_date = session.state.current_date;
+    session.state.window_width = 140;
+    session.state.window_height = 30;
+    mark_dirty(&session.state, DIRTY_ALL);
+
+    init_appointments(&session.appointments);
+    init_todos(&session.todos);
+    calset_init(&session.calendars, &session.appointments, "main");
+    session.state.calendars = &session.calendars;
+    calset_load_main(&session.calendars, &session.todos);
+    if (storage_damaged()) {
+        fprintf(stderr, "wcal: %s is damaged; saving keeps a copy as %s\n", ARCHIVE_NAME, DAMAGED_ARCHIVE_NAME);
+    }
+
+    while (fgets(line, sizeof(line), script)) {
+        line_number++;
+
+        const char *error = run_command(&session, line);
+        if (error) {
+            fprintf(stderr, "wcal: batch line %d: %s\n", line_number, error);
+            result = 1;
+            break;
+        }
+        storage_reach(&session.appointments, session.state.selected_date.year, session.state.selected_date.year);
+        fflush(stdout);
+    }
+
+    // A failed script leaves the data file untouched
+    if (result == 0 && session.modified) {
+        if (!save_data_to_zip(&session.appointments, &session.todos)) {
+            fprintf(stderr, "wcal: saving failed\n");
+            result = 1;
+        }
+    }
+
+    if (script != stdin) fclose(script);
+    if (g_mem_report) {
+        size_t used[MEM_SUBSYSTEM_COUNT];
+        calset_measure(&session.calendars, &session.todos, used);
+        wmem_report_checkpoint(used);
+    }
+    fb_free();
+    session.appointments.reminders = NULL;
+    reminder_free(&session.reminders);
+    calset_free(&session.calendars);
+    free_appointments(&session.appointments);
+    free_todos(&session.todos);
+    return result;
+}
\ No newline at end of file
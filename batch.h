@@ -0,0 +1,10 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+// Headless command mode: `wcal --batch [script]`. Reads commands from the
+// script (stdin when NULL or "-"), never touches the console and never
+// prompts. Data is loaded and saved like an interactive session.
+// Returns the process exit code: 0 on success, 1 at the first failing line.
+int run_batch(const char *script_path);
+
+#endif // BATCH_H
\ No newline at end of file
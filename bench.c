@@ -0,0 +1,404 @@
+// Headless render / keystroke benchmark.
+//
+// Builds synthetic appointment and todo lists, feeds a scripted key sequence
+// through process_input and renders every resulting frame with draw_ui. The
+// frames go through the normal terminal backend with stdout pointed at the
+// null device, so the byte counts are what a real terminal would receive.
+// Between keys and frame the reminder wheel is advanced, as the main loop's
+// check_reminders does; "drops" counts frames before which the per-date
+// results were thrown away, which navigation alone should never cause.
+//
+// Usage: wcal_bench [--keys N] [--burst N] [--size WxH] [appointment counts...]
+//        wcal_bench --sort N
+//
+// --burst N queues N keys before each frame, the way the main loop drains a
+// held key's auto-repeat backlog, so the coalescing path can be measured.
+// --sort N times the bulk-load sorts instead: N shuffled appointments
+// through sort_appointments against qsort, and N todos through add_todos
+// against add_todo one at a time.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "compat.h"
+#include "ui.h"
+#include "calendar.h"
+#include "appointments.h"
+#include "todo.h"
+#include "input.h"
+#include "reminder.h"
+#include "psort.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define DEFAULT_KEYS        5000
+#define DEFAULT_WIDTH       140
+#define DEFAULT_HEIGHT      30
+#define SPREAD_DAYS         1000    // Appointments are spread over this many days
+#define MAX_SIZES           16
+
+// One pass over all three panels; repeated until the key budget is used up
+static const int g_script[] = {
+    KEY_RIGHT, KEY_RIGHT, KEY_RIGHT, KEY_DOWN, KEY_DOWN, KEY_LEFT, KEY_UP,
+    KEY_PGDN, KEY_RIGHT, KEY_PGUP, KEY_HOME,
+    KEY_TAB,
+    KEY_DOWN, KEY_DOWN, KEY_DOWN, KEY_PGDN, KEY_PGDN, KEY_UP, KEY_PGUP, KEY_DOWN,
+    KEY_TAB,
+    KEY_DOWN, KEY_DOWN, KEY_PGDN, KEY_PGDN, KEY_PGDN, KEY_UP, KEY_PGUP, KEY_DOWN,
+    KEY_TAB
+};
+
+static double now_us(void) {
+#ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart * 1000000.0 / (double)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000000.0 + (double)ts.tv_nsec / 1000.0;
+#endif
+}
+
+// Point the terminal backend at the null device while frames are rendered
+#ifdef _WIN32
+static HANDLE g_saved_stdout;
+
+static void redirect_output(void) {
+    g_saved_stdout = GetStdHandle(STD_OUTPUT_HANDLE);
+    SetStdHandle(STD_OUTPUT_HANDLE, CreateFileA("NUL", GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL));
+}
+
+static void restore_output(void) {
+    CloseHandle(GetStdHandle(STD_OUTPUT_HANDLE));
+    SetStdHandle(STD_OUTPUT_HANDLE, g_saved_stdout);
+}
+#else
+static int g_saved_stdout = -1;
+
+static void redirect_output(void) {
+    int null_fd = open("/dev/null", O_WRONLY);
+    fflush(stdout);
+    g_saved_stdout = dup(STDOUT_FILENO);
+    dup2(null_fd, STDOUT_FILENO);
+    close(null_fd);
+}
+
+static void restore_output(void) {
+    dup2(g_saved_stdout, STDOUT_FILENO);
+    close(g_saved_stdout);
+}
+#endif
+
+// Fill the list directly and sort once; add_appointment re-sorts on every call
+static int fill_appointments(AppointmentList *list, int count, Date centre) {
+    if (!reserve_appointments(list, count)) return 0;
+
+    int per_day = count / SPREAD_DAYS + 1;
+    Date day = centre;
+    add_days_to_date(&day, -SPREAD_DAYS / 2);
+
+    for (int i = 0; i < count; i++) {
+        if (i > 0 && i % per_day == 0) {
+            add_days_to_date(&day, 1);
+        }
+
+        Appointment *app = &list->items[i];
+        int slot = i % per_day;
+        app->date_time.year = day.year;
+        app->date_time.month = day.month;
+        app->date_time.day = day.day;
+        app->date_time.hour = 8 + (slot / 4) % 12;
+        app->date_time.minute = (slot % 4) * 15;
+        app->duration_minutes = (i % 97 == 0) ? 26 * 60 : 30 + (i % 8) * 15;   // A few span midnight
+        app->reminder_minutes = (i % 10 == 0) ? 15 : 0;
+        sprintf_s(app->description, sizeof(app->description), "Benchmark appointment %d", i);
+    }
+
+    list->count = count;
+    sort_appointments(list);
+    return 1;
+}
+
+static void make_todo(TodoItem *todo, int i, Date centre) {
+    memset(todo, 0, sizeof(*todo));
+    sprintf_s(todo->description, sizeof(todo->description), "Benchmark task %d", i);
+    todo->priority = i % 3;
+    todo->completed = (i % 4 == 0);
+    if (i % 3 == 0) {
+        // Due dates spread over two months either side, so some are overdue
+        todo->due = centre;
+        add_days_to_date(&todo->due, i % 120 - 60);
+    }
+}
+
+static int fill_todos(TodoList *list, int count, Date centre) {
+    clear_todos(list);
+
+    for (int i = 0; i < count; i++) {
+        TodoItem todo;
+        make_todo(&todo, i, centre);
+        if (!add_todo(list, &todo)) return 0;
+    }
+
+    return 1;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const double *sorted, int count, double p) {
+    if (count == 0) return 0.0;
+    int index = (int)(p * (count - 1) + 0.5);
+    return sorted[index];
+}
+
+static int compare_starts(const void *a, const void *b) {
+    return compare_datetimes(((const Appointment*)a)->date_time, ((const Appointment*)b)->date_time);
+}
+
+// Fixed seed, so runs are comparable
+static void shuffle_appointments(AppointmentList *list) {
+    unsigned int seed = 12345;
+
+    reserve_appointments(list, list->count);
+    for (int i = list->count - 1; i > 0; i--) {
+        seed = seed * 1103515245u + 12345u;
+        int j = (int)((seed >> 4) % (unsigned int)(i + 1));
+        Appointment swap = list->items[i];
+        list->items[i] = list->items[j];
+        list->items[j] = swap;
+    }
+}
+
+static void run_sort_benchmark(int count) {
+    AppointmentList appointments;
+    TodoList one_by_one, batch;
+    Date centre = {2025, 6, 15};
+    int parts = psort_parts(count);
+
+    printf("%d appointments and todos, %d sort thread%s\n\n", count, parts, parts == 1 ? "" : "s");
+    printf("%-24s %12s %12s\n", "", "new (ms)", "before (ms)");
+
+    init_appointments(&appointments);
+    if (!fill_appointments(&appointments, count, centre)) {
+        printf("out of memory\n");
+        free_appointments(&appointments);
+        return;
+    }
+
+    shuffle_appointments(&appointments);
+    double start = now_us();
+    qsort(appointments.items, appointments.count, sizeof(Appointment), compare_starts);
+    double before = now_us() - start;
+
+    shuffle_appointments(&appointments);
+    start = now_us();
+    sort_appointments(&appointments);
+    double after = now_us() - start;
+
+    int in_order = 1;
+    for (int i = 1; i < appointments.count && in_order; i++) {
+        in_order = compare_starts(&appointments.items[i - 1], &appointments.items[i]) <= 0;
+    }
+    printf("%-24s %12.1f %12.1f%s\n", "appointments, shuffled", after / 1000.0, before / 1000.0,
+           in_order ? "" : "  OUT OF ORDER");
+
+    start = now_us();
+    sort_appointments(&appointments);
+    printf("%-24s %12.1f\n", "appointments, in order", (now_us() - start) / 1000.0);
+    free_appointments(&appointments);
+
+    TodoItem *todos = (TodoItem*)malloc(sizeof(TodoItem) * (count ? count : 1));
+    if (!todos) return;
+    for (int i = 0; i < count; i++) make_todo(&todos[i], i, centre);
+
+    init_todos(&one_by_one);
+    init_todos(&batch);
+    start = now_us();
+    for (int i = 0; i < count; i++) add_todo(&one_by_one, &todos[i]);
+    before = now_us() - start;
+
+    start = now_us();
+    add_todos(&batch, todos, count);
+    after = now_us() - start;
+
+    // Both ways must give the same display order
+    int same = one_by_one.count == batch.count;
+    for (int i = 0; i < batch.count && same; i++) {
+        same = strcmp(todo_at(&one_by_one, i)->description, todo_at(&batch, i)->description) == 0;
+    }
+    printf("%-24s %12.1f %12.1f%s\n", "todos", after / 1000.0, before / 1000.0, same ? "" : "  ORDER DIFFERS");
+
+    free(todos);
+    free_todos(&one_by_one);
+    free_todos(&batch);
+}
+
+static void run_benchmark(int appointment_count, int key_count, int burst, int width, int height) {
+    AppointmentList appointments;
+    TodoList todos;
+    UIState state;
+    ReminderWheel reminders;
+    Date centre = {2025, 6, 15};   // Fixed so runs are comparable across days
+    DateTime noon = {centre.year, centre.month, centre.day, 12, 0};
+    long long minute = datetime_to_minutes(noon);
+    int fired[MAX_FIRED_REMINDERS];
+
+    init_appointments(&appointments);
+    init_todos(&todos);
+
+    int todo_count = appointment_count / 10 > 100 ? appointment_count / 10 : 100;
+    if (!fill_appointments(&appointments, appointment_count, centre) || !fill_todos(&todos, todo_count, centre)) {
+        printf("%12d  out of memory\n", appointment_count);
+        free_appointments(&appointments);
+        free_todos(&todos);
+        return;
+    }
+
+    // The clock stands still at noon, so the passes find nothing due
+    reminder_init(&reminders, minute);
+    reminder_attach(&reminders, &appointments);
+
+    memset(&state, 0, sizeof(state));
+    state.selected_view = VIEW_CALENDAR;
+    state.current_date = centre;
+    state.selected_date = centre;
+    state.window_width = width;
+    state.window_height = height;
+    mark_dirty(&state, DIRTY_ALL);
+
+    double *latencies = (double*)malloc(sizeof(double) * key_count);
+    if (!latencies) {
+        appointments.reminders = NULL;
+        reminder_free(&reminders);
+        free_appointments(&appointments);
+        free_todos(&todos);
+        return;
+    }
+
+    redirect_output();
+
+    // The first frame is a full paint; keep it out of the per-key numbers
+    draw_ui(&state, &appointments, &todos);
+
+    int frames = 0;
+    int drops = 0;
+    unsigned long long generation = appointments.generation;
+    size_t total_bytes = 0;
+    long long total_cells = 0;
+    int script_length = (int)(sizeof(g_script) / sizeof(g_script[0]));
+    double start = now_us();
+
+    int samples = 0;
+    KeyQueue queue;
+    
+    for (int i = 0; i < key_count; i += burst) {
+        double key_start = now_us();
+        KeyEvent key_event;
+        
+        key_queue_clear(&queue);
+        for (int k = i; k < i + burst && k < key_count; k++) {
+            key_queue_push(&queue, g_script[k % script_length]);
+        }
+        while (key_queue_pop(&queue, &key_event)) {
+            process_input(key_event.key, key_event.count, &state, &appointments, &todos);
+        }
+        reminder_advance(&reminders, &appointments, minute, fired, MAX_FIRED_REMINDERS);
+        
+        if (ui_needs_redraw(&state)) {
+            if (appointments.generation != generation) drops++;
+            generation = appointments.generation;
+            draw_ui(&state, &appointments, &todos);
+            frames++;
+            total_bytes += fb_get()->last_flush_bytes;
+            total_cells += fb_get()->last_flush_cells;
+        }
+        
+        latencies[samples++] = now_us() - key_start;
+    }
+    
+    double elapsed = now_us() - start;
+
+    restore_output();
+
+    qsort(latencies, samples, sizeof(double), compare_doubles);
+    printf("%12d %10d %8d %12.0f %12.0f %12.0f %10.1f %10.1f %10.1f\n",
+           appointment_count, frames, drops,
+           elapsed > 0 ? frames * 1000000.0 / elapsed : 0.0,
+           frames ? (double)total_bytes / frames : 0.0,
+           frames ? (double)total_cells / frames : 0.0,
+           percentile(latencies, samples, 0.50),
+           percentile(latencies, samples, 0.99),
+           latencies[samples - 1]);
+
+    free(latencies);
+    fb_free();
+    appointments.reminders = NULL;
+    reminder_free(&reminders);
+    free_appointments(&appointments);
+    free_todos(&todos);
+}
+
+int main(int argc, char *argv[]) {
+    int sizes[MAX_SIZES];
+    int size_count = 0;
+    int key_count = DEFAULT_KEYS;
+    int burst = 1;
+    int width = DEFAULT_WIDTH;
+    int height = DEFAULT_HEIGHT;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--keys") == 0 && i + 1 < argc) {
+            key_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--burst") == 0 && i + 1 < argc) {
+            burst = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            if (sscanf_s(argv[++i], "%dx%d", &width, &height) != 2) {
+                fprintf(stderr, "Bad --size, expected WxH\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--sort") == 0 && i + 1 < argc) {
+            run_sort_benchmark(atoi(argv[++i]));
+            return 0;
+        } else if (size_count < MAX_SIZES && atoi(argv[i]) > 0) {
+            sizes[size_count++] = atoi(argv[i]);
+        } else {
+            fprintf(stderr, "Usage: %s [--keys N] [--burst N] [--size WxH] [appointment counts...]\n"
+                            "       %s --sort N\n", argv[0], argv[0]);
+            return 1;
+        }
+    }
+
+    if (size_count == 0) {
+        sizes[size_count++] = 1000;
+        sizes[size_count++] = 100000;
+        sizes[size_count++] = 1000000;
+    }
+    if (key_count < 1) key_count = 1;
+    if (burst < 1) burst = 1;
+    if (burst > KEY_QUEUE_SIZE) burst = KEY_QUEUE_SIZE;
+    if (width < 20) width = 20;
+    if (height < 10) height = 10;
+
+    printf("%d keys per run, %d per frame, %dx%d frame\n\n", key_count, burst, width, height);
+    printf("%12s %10s %8s %12s %12s %12s %10s %10s %10s\n",
+           "appointments", "frames", "drops", "frames/s", "bytes/frame", "cells/frame",
+           "p50 (us)", "p99 (us)", "max (us)");
+
+    for (int i = 0; i < size_count; i++) {
+        run_benchmark(sizes[i], key_count, burst, width, height);
+        fflush(stdout);
+    }
+
+    return 0;
+}
\ No newline at end of file
@@ -12,9 +12,59 @@ if errorlevel 1 (
 
 REM Clean previous build
 echo Cleaning previous build...
-del *.obj wcal.exe 2>nul
+del *.obj libwcal.lib wcal.exe 2>nul
 
-REM Compile source files
+REM Compile the core library (libwcal): model, persistence and queries, no console code
+echo Building libwcal...
+cl /c /W3 /O2 /TC /nologo calendar.c
+if errorlevel 1 goto :error
+
+cl /c /W3 /O2 /TC /nologo appointments.c
+if errorlevel 1 goto :error
+
+cl /c /W3 /O2 /TC /nologo todo.c
+if errorlevel 1 goto :error
+
+cl /c /W3 /O2 /TC /nologo storage.c
+if errorlevel 1 goto :error
+
+cl /c /W3 /O2 /TC /nologo archive.c
+if errorlevel 1 goto :error
+
+cl /c /W3 /O2 /TC /nologo query.c
+if errorlevel 1 goto :error
+
+cl /c /W3 /O2 /TC /nologo reminder.c
+if errorlevel 1 goto :error
+
+cl /c /W3 /O2 /TC /nologo calset.c
+if errorlevel 1 goto :error
+
+cl /c /W3 /O2 /TC /nologo sync.c
+if errorlevel 1 goto :error
+
+cl /c /W3 /O2 /TC /nologo watch.c
+if errorlevel 1 goto :error
+
+cl /c /W3 /O2 /TC /nologo trace.c
+if errorlevel 1 goto :error
+
+cl /c /W3 /O2 /TC /nologo wmem.c
+if errorlevel 1 goto :error
+
+cl /c /W3 /O2 /TC /nologo cow.c
+if errorlevel 1 goto :error
+
+cl /c /W3 /O2 /TC /nologo crc32c.c
+if errorlevel 1 goto :error
+
+cl /c /W3 /O2 /TC /nologo psort.c
+if errorlevel 1 goto :error
+
+lib /nologo /OUT:libwcal.lib calendar.obj appointments.obj todo.obj storage.obj archive.obj query.obj reminder.obj calset.obj sync.obj watch.obj trace.obj wmem.obj cow.obj crc32c.obj psort.obj
+if errorlevel 1 goto :error
+
+REM Compile the console application
 echo Compiling source files...
 cl /c /W3 /O2 /TC /nologo main.c
 if errorlevel 1 goto :error
@@ -22,24 +72,30 @@ if errorlevel 1 goto :error
 cl /c /W3 /O2 /TC /nologo ui.c
 if errorlevel 1 goto :error
 
-cl /c /W3 /O2 /TC /nologo calendar.c
+cl /c /W3 /O2 /TC /nologo render.c
 if errorlevel 1 goto :error
 
-cl /c /W3 /O2 /TC /nologo appointments.c
+cl /c /W3 /O2 /TC /nologo term_win32.c
 if errorlevel 1 goto :error
 
-cl /c /W3 /O2 /TC /nologo todo.c
+cl /c /W3 /O2 /TC /nologo term_ansi.c
 if errorlevel 1 goto :error
 
-cl /c /W3 /O2 /TC /nologo storage.c
+cl /c /W3 /O2 /TC /nologo input.c
 if errorlevel 1 goto :error
 
-cl /c /W3 /O2 /TC /nologo input.c
+cl /c /W3 /O2 /TC /nologo dialog.c
+if errorlevel 1 goto :error
+
+cl /c /W3 /O2 /TC /nologo batch.c
+if errorlevel 1 goto :error
+
+cl /c /W3 /O2 /TC /nologo server.c
 if errorlevel 1 goto :error
 
 REM Link executable
 echo Linking executable...
-cl main.obj ui.obj calendar.obj appointments.obj todo.obj storage.obj input.obj /Fe:wcal.exe /link kernel32.lib user32.lib
+cl main.obj ui.obj render.obj term_win32.obj term_ansi.obj input.obj dialog.obj batch.obj server.obj libwcal.lib /Fe:wcal.exe /link kernel32.lib user32.lib
 if errorlevel 1 goto :error
 
 echo.
@@ -2,6 +2,7 @@
 #include <time.h>
 #include <stdlib.h>
 #include <string.h>
+#include "compat.h"
 
 static const char *month_names[] = {
     "January", "February", "March", "April", "May", "June",
@@ -82,6 +83,18 @@ int compare_dates(Date d1, Date d2) {
     return d1.day - d2.day;
 }
 
+// Parses YYYY-MM-DD; returns 0 for malformed text or a day that does not exist
+int parse_date(const char *text, Date *date) {
+    Date parsed;
+    
+    if (!text || sscanf_s(text, "%d-%d-%d", &parsed.year, &parsed.month, &parsed.day) != 3) return 0;
+    if (parsed.month < 1 || parsed.month > 12) return 0;
+    if (parsed.day < 1 || parsed.day > get_days_in_month(parsed.year, parsed.month)) return 0;
+    
+    *date = parsed;
+    return 1;
+}
+
 int compare_datetimes(DateTime dt1, DateTime dt2) {
     if (dt1.year != dt2.year) return dt1.year - dt2.year;
     if (dt1.month != dt2.month) return dt1.month - dt2.month;
@@ -137,4 +150,73 @@ void add_months_to_date(Date *date, int months) {
     if (date->day > max_days) {
         date->day = max_days;
     }
+}
+
+void get_today(Date *date) {
+    time_t t = time(NULL);
+    struct tm tm_storage;
+    localtime_s(&tm_storage, &t);
+    date->year = tm_storage.tm_year + 1900;
+    date->month = tm_storage.tm_mon + 1;
+    date->day = tm_storage.tm_mday;
+}
+
+void get_now(DateTime *now) {
+    time_t t = time(NULL);
+    struct tm tm_storage;
+    localtime_s(&tm_storage, &t);
+    now->year = tm_storage.tm_year + 1900;
+    now->month = tm_storage.tm_mon + 1;
+    now->day = tm_storage.tm_mday;
+    now->hour = tm_storage.tm_hour;
+    now->minute = tm_storage.tm_min;
+}
+
+long long datetime_to_minutes(DateTime date_time) {
+    // Days from the civil calendar, counting years from March so the leap
+    // day falls at the end of each year
+    int year = date_time.month <= 2 ? date_time.year - 1 : date_time.year;
+    int era = (year >= 0 ? year : year - 399) / 400;
+    int year_of_era = year - era * 400;
+    int day_of_year = (153 * (date_time.month + (date_time.month > 2 ? -3 : 9)) + 2) / 5 + date_time.day - 1;
+    int day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    long long days = (long long)era * 146097 + day_of_era - 719468;
+    
+    return days * 24 * 60 + date_time.hour * 60 + date_time.minute;
+}
+
+// A field's byte; anything out of range sorts at its end
+static unsigned int key_byte(int field) {
+    return field < 0 ? 0 : field > 255 ? 255 : (unsigned int)field;
+}
+
+unsigned long long datetime_key(DateTime date_time) {
+    // Flipping the sign bit puts negative years first as unsigned
+    unsigned int year = (unsigned int)date_time.year ^ 0x80000000u;
+    
+    return ((unsigned long long)year << 32) | (key_byte(date_time.month) << 24) | (key_byte(date_time.day) << 16) |
+           (key_byte(date_time.hour) << 8) | key_byte(date_time.minute);
+}
+
+int get_ms_until_midnight(void) {
+    time_t t = time(NULL);
+    struct tm tm_storage;
+    localtime_s(&tm_storage, &t);
+    
+    int seconds_today = tm_storage.tm_hour * 3600 + tm_storage.tm_min * 60 + tm_storage.tm_sec;
+    int seconds_left = 24 * 3600 - seconds_today;
+    if (seconds_left < 1) seconds_left = 1;
+    
+    return seconds_left * 1000;
+}
+
+int get_ms_until_next_minute(void) {
+    time_t t = time(NULL);
+    struct tm tm_storage;
+    localtime_s(&tm_storage, &t);
+    
+    int seconds_left = 60 - tm_storage.tm_sec;
+    if (seconds_left < 1) seconds_left = 1;    // Leap second
+    
+    return seconds_left * 1000;
 }
\ No newline at end of file
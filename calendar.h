@@ -26,8 +26,15 @@ int get_week_number(int year, int month, int day);
 const char* get_month_name(int month);
 const char* get_day_name(int day_of_week);
 int compare_dates(Date d1, Date d2);
+int parse_date(const char *text, Date *date);
 int compare_datetimes(DateTime dt1, DateTime dt2);
 void add_days_to_date(Date *date, int days);
 void add_months_to_date(Date *date, int months);
+void get_today(Date *date);
+void get_now(DateTime *now);
+long long datetime_to_minutes(DateTime date_time);     // Minutes since 1970-01-01 00:00, wall clock
+unsigned long long datetime_key(DateTime date_time);   // The fields packed to order as compare_datetimes does
+int get_ms_until_midnight(void);
+int get_ms_until_next_minute(void);
 
 #endif // CALENDAR_H
\ No newline at end of file
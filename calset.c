@@ -0,0 +1,211 @@
+#include "calset.h"
+#include "wmem.h"
+#include "storage.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "compat.h"
+
+// Appointments fetched from one calendar at a time while merging
+#define MERGE_CHUNK 64
+
+// Read position in one calendar's appointments for the merged date
+typedef struct {
+    int calendar;
+    int indices[MERGE_CHUNK];
+    int count;          // Filled entries of indices
+    int position;       // Next entry of indices to hand out
+    int fetched;        // Entries fetched from the calendar so far
+} MergeCursor;
+
+void calset_init(CalendarSet *set, AppointmentList *main_list, const char *main_name) {
+    memset(set, 0, sizeof(*set));
+    strcpy_s(set->calendars[0].name, MAX_CALENDAR_NAME, main_name);
+    set->calendars[0].list = main_list;
+    set->calendars[0].visible = 1;
+    set->count = 1;
+}
+
+void calset_free(CalendarSet *set) {
+    for (int i = 0; i < set->count; i++) {
+        sync_close(&set->calendars[i].source);
+        if (set->calendars[i].owned) {
+            free_appointments(set->calendars[i].list);
+            wmem_free(set->calendars[i].list);
+        }
+    }
+    memset(set, 0, sizeof(*set));
+}
+
+int calset_add_file(CalendarSet *set, const char *name, const char *path) {
+    if (set->count >= MAX_CALENDARS) return -1;
+
+    Calendar *calendar = &set->calendars[set->count];
+    AppointmentList *list = (AppointmentList*)wmem_malloc(MEM_APPOINTMENTS, sizeof(AppointmentList));
+    if (!list) return -1;
+    init_appointments(list);
+    if (!list->items || !sync_open(&calendar->source, path, list, NULL)) {
+        sync_close(&calendar->source);
+        free_appointments(list);
+        wmem_free(list);
+        return -1;
+    }
+
+    strcpy_s(calendar->name, MAX_CALENDAR_NAME, name);
+    calendar->list = list;
+    calendar->owned = 1;
+    calendar->visible = 1;
+    return set->count++;
+}
+
+int calset_load_main(CalendarSet *set, TodoList *todos) {
+    Calendar *calendar = &set->calendars[0];
+
+    if (sync_open(&calendar->source, ARCHIVE_NAME, calendar->list, todos)) return 1;
+
+    // No archive yet: stay tracked, so one that appears later is loaded
+    FILE *file;
+    if (fopen_s(&file, ARCHIVE_NAME, "rb") != 0) return 0;
+    fclose(file);
+
+    // The external tools read archives the built-in reader can't, but then
+    // there is no index to diff a later version against: not tracked
+    sync_close(&calendar->source);
+    return load_data_from_zip(calendar->list, todos);
+}
+
+int calset_save_main(CalendarSet *set, TodoList *todos) {
+    if (!save_data_to_zip(set->calendars[0].list, todos)) return 0;
+    sync_rebase(&set->calendars[0].source);
+    return 1;
+}
+
+int calset_save_main_in_background(CalendarSet *set, TodoList *todos) {
+    return save_data_in_background(set->calendars[0].list, todos);
+}
+
+SaveState calset_save_state(CalendarSet *set, int wait) {
+    SaveState state = storage_save_state(wait);
+    if (state == SAVE_DONE) sync_rebase(&set->calendars[0].source);
+    return state;
+}
+
+int calset_reload(CalendarSet *set, int calendar, SyncStats *stats) {
+    if (calendar < 0 || calendar >= set->count) return -1;
+    return sync_reload(&set->calendars[calendar].source, stats);
+}
+
+int calset_toggle(CalendarSet *set, int calendar) {
+    if (calendar < 0 || calendar >= set->count) return -1;
+    set->calendars[calendar].visible = !set->calendars[calendar].visible;
+    return set->calendars[calendar].visible;
+}
+
+// Refill an exhausted cursor; 0 once its calendar has nothing more that day
+static int cursor_fill(const CalendarSet *set, MergeCursor *cursor, Date date) {
+    if (cursor->position < cursor->count) return 1;
+
+    // A short chunk means the day ran out
+    if (cursor->count > 0 && cursor->count < MERGE_CHUNK) return 0;
+
+    cursor->count = find_appointments_by_date_window(set->calendars[cursor->calendar].list, date,
+                                                     cursor->fetched, cursor->indices, MERGE_CHUNK);
+    cursor->position = 0;
+    cursor->fetched += cursor->count;
+    return cursor->count > 0;
+}
+
+static const Appointment *cursor_head(const CalendarSet *set, const MergeCursor *cursor) {
+    return &set->calendars[cursor->calendar].list->items[cursor->indices[cursor->position]];
+}
+
+static int cursor_before(const CalendarSet *set, const MergeCursor *a, const MergeCursor *b) {
+    int order = compare_datetimes(cursor_head(set, a)->date_time, cursor_head(set, b)->date_time);
+    return order < 0 || (order == 0 && a->calendar < b->calendar);
+}
+
+static void sift_down(const CalendarSet *set, MergeCursor **heap, int size, int i) {
+    for (;;) {
+        int smallest = i;
+        int left = 2 * i + 1;
+        int right = left + 1;
+
+        if (left < size && cursor_before(set, heap[left], heap[smallest])) smallest = left;
+        if (right < size && cursor_before(set, heap[right], heap[smallest])) smallest = right;
+        if (smallest == i) return;
+
+        MergeCursor *swap = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = swap;
+        i = smallest;
+    }
+}
+
+int calset_find_on_date(const CalendarSet *set, Date date, int first, AppointmentRef *refs, int max_refs) {
+    MergeCursor cursors[MAX_CALENDARS];
+    MergeCursor *heap[MAX_CALENDARS];
+    int size = 0;
+    int skipped = 0;
+    int found = 0;
+
+    // One cursor per visible calendar with anything that day
+    for (int i = 0; i < set->count; i++) {
+        if (!set->calendars[i].visible) continue;
+
+        MergeCursor *cursor = &cursors[size];
+        cursor->calendar = i;
+        cursor->count = 0;
+        cursor->position = 0;
+        cursor->fetched = 0;
+        if (cursor_fill(set, cursor, date)) heap[size++] = cursor;
+    }
+    for (int i = size / 2 - 1; i >= 0; i--) {
+        sift_down(set, heap, size, i);
+    }
+
+    // Pop the earliest head each time; a calendar's next entry takes its place
+    while (size > 0 && found < max_refs) {
+        MergeCursor *cursor = heap[0];
+
+        if (skipped < first) {
+            skipped++;
+        } else {
+            AppointmentRef *ref = &refs[found++];
+            ref->calendar = cursor->calendar;
+            ref->index = cursor->indices[cursor->position];
+            ref->app = cursor_head(set, cursor);
+        }
+
+        cursor->position++;
+        if (!cursor_fill(set, cursor, date)) heap[0] = heap[--size];
+        sift_down(set, heap, size, 0);
+    }
+
+    return found;
+}
+
+int calset_count_on_date(const CalendarSet *set, Date date) {
+    int count = 0;
+
+    // Counting needs no merge
+    for (int i = 0; i < set->count; i++) {
+        if (set->calendars[i].visible) count += count_appointments_on_date(set->calendars[i].list, date);
+    }
+    return count;
+}
+
+int calset_has_on_date(const CalendarSet *set, Date date) {
+    for (int i = 0; i < set->count; i++) {
+        if (set->calendars[i].visible && has_appointment_on_date(set->calendars[i].list, date)) return 1;
+    }
+    return 0;
+}
+
+void calset_measure(const CalendarSet *set, TodoList *todos, size_t used[MEM_SUBSYSTEM_COUNT]) {
+    memset(used, 0, sizeof(size_t) * MEM_SUBSYSTEM_COUNT);
+    for (int i = 0; i < set->count; i++) {
+        used[MEM_APPOINTMENTS] += appointments_data_bytes(set->calendars[i].list);
+        if (set->calendars[i].owned) used[MEM_APPOINTMENTS] += sizeof(AppointmentList);
+    }
+    used[MEM_TODOS] = todos_data_bytes(todos);
+}
\ No newline at end of file
@@ -0,0 +1,73 @@
+#ifndef CALSET_H
+#define CALSET_H
+
+#include "calendar.h"
+#include "appointments.h"
+#include "todo.h"
+#include "sync.h"
+#include "storage.h"
+#include "wmem.h"
+
+#define MAX_CALENDARS       8
+#define MAX_CALENDAR_NAME   32
+
+// One source of appointments. Calendar 0 is the main, editable list from
+// the data archive; the others are read-only ICS files loaded at start-up.
+typedef struct {
+    char name[MAX_CALENDAR_NAME];
+    AppointmentList *list;
+    int owned;                  // The set allocated list and frees it
+    int visible;
+    SyncSource source;          // The file behind the list, for reloads
+} Calendar;
+
+// Several sorted lists viewed as one. Nothing is copied: day views merge
+// the visible lists on the fly, so hiding a calendar is a flag flip.
+typedef struct {
+    Calendar calendars[MAX_CALENDARS];
+    int count;
+} CalendarSet;
+
+// One appointment in a merged view. The pointer and index stay valid
+// until that calendar's list changes.
+typedef struct {
+    const Appointment *app;
+    int calendar;
+    int index;
+} AppointmentRef;
+
+void calset_init(CalendarSet *set, AppointmentList *main_list, const char *main_name);
+void calset_free(CalendarSet *set);
+
+// Load or save the main calendar and the todos in the data archive
+int calset_load_main(CalendarSet *set, TodoList *todos);
+int calset_save_main(CalendarSet *set, TodoList *todos);
+// The same save on a thread of its own (see save_data_in_background).
+// calset_save_state passes on storage_save_state, and once a save is done
+// rebases the main calendar on it as calset_save_main does; call it, with
+// wait, before reloading the main calendar while a save may be running.
+int calset_save_main_in_background(CalendarSet *set, TodoList *todos);
+SaveState calset_save_state(CalendarSet *set, int wait);
+
+// Load an ICS file as a new read-only calendar; returns its number or -1
+int calset_add_file(CalendarSet *set, const char *name, const char *path);
+
+// Merge in what changed in a calendar's file since it was last read.
+// Returns 0 if the file can't be read or isn't tracked; -1 for a calendar
+// that doesn't exist.
+int calset_reload(CalendarSet *set, int calendar, SyncStats *stats);
+
+// Returns the new visibility, or -1 for a calendar that doesn't exist
+int calset_toggle(CalendarSet *set, int calendar);
+
+// Visible appointments touching a date, k-way merged into start order
+// (ties go to the lower calendar number). Skips the first `first`.
+int calset_find_on_date(const CalendarSet *set, Date date, int first, AppointmentRef *refs, int max_refs);
+int calset_count_on_date(const CalendarSet *set, Date date);
+int calset_has_on_date(const CalendarSet *set, Date date);
+
+// Data bytes held by every calendar's list and by the todos, per subsystem,
+// for wmem_report_checkpoint
+void calset_measure(const CalendarSet *set, TodoList *todos, size_t used[MEM_SUBSYSTEM_COUNT]);
+
+#endif // CALSET_H
\ No newline at end of file
@@ -0,0 +1,36 @@
+#ifndef COMPAT_H
+#define COMPAT_H
+
+// Portable stand-ins for the MSVC secure CRT functions used throughout wcal
+#ifndef _WIN32
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#define sprintf_s snprintf
+#define sscanf_s sscanf
+#define localtime_s(tm, t) localtime_r((t), (tm))
+#define _putenv_s(name, value) setenv((name), (value), 1)
+
+static inline int strcpy_s(char *dest, size_t size, const char *src) {
+    snprintf(dest, size, "%s", src);
+    return 0;
+}
+
+static inline int strcat_s(char *dest, size_t size, const char *src) {
+    size_t len = strlen(dest);
+    if (len < size) {
+        snprintf(dest + len, size - len, "%s", src);
+    }
+    return 0;
+}
+
+static inline int fopen_s(FILE **file, const char *filename, const char *mode) {
+    *file = fopen(filename, mode);
+    return *file ? 0 : errno;
+}
+#endif
+
+#endif // COMPAT_H
\ No newline at end of file
@@ -0,0 +1,113 @@
+#include "cow.h"
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#define INCREMENT(counter) InterlockedIncrement(counter)
+#define DECREMENT(counter) InterlockedDecrement(counter)
+#define LOAD(counter) InterlockedCompareExchange((counter), 0, 0)
+#define LOAD_POINTER(target) InterlockedCompareExchangePointer((target), NULL, NULL)
+#define SWAP_IF(target, expected, value) (InterlockedCompareExchangePointer((target), (value), (expected)) == (expected))
+#define TAKE_ALL(target) InterlockedExchangePointer((target), NULL)
+#else
+#define INCREMENT(counter) __atomic_add_fetch((counter), 1, __ATOMIC_RELAXED)
+#define DECREMENT(counter) __atomic_sub_fetch((counter), 1, __ATOMIC_ACQ_REL)
+#define LOAD(counter) __atomic_load_n((counter), __ATOMIC_ACQUIRE)
+#define LOAD_POINTER(target) __atomic_load_n((target), __ATOMIC_ACQUIRE)
+#define SWAP_IF(target, expected, value) \
+    __atomic_compare_exchange_n((target), &(expected), (value), 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED)
+#define TAKE_ALL(target) __atomic_exchange_n((target), NULL, __ATOMIC_ACQUIRE)
+#endif
+
+// Sits between the wmem header and the data, keeping the data aligned
+typedef union CowHeader {
+    struct {
+        volatile long refs;
+        size_t size;
+        union CowHeader *next;      // In g_released once its last reader let go
+    } info;
+    long double align_float;
+    long long align_integer;
+    void *align_pointer;
+} CowHeader;
+
+// Blocks whose last reference went on another thread, waiting for the owner
+static void *volatile g_released;
+
+// Free what readers handed back; only the owner calls this, so taking the
+// whole stack at once leaves nothing for a concurrent pop to get wrong
+static void collect_released(void) {
+    if (!LOAD_POINTER(&g_released)) return;
+
+    CowHeader *header = (CowHeader*)TAKE_ALL(&g_released);
+    while (header) {
+        CowHeader *next = header->info.next;
+        wmem_free(header);
+        header = next;
+    }
+}
+
+void *cow_alloc(MemSubsystem subsystem, size_t size) {
+    collect_released();
+
+    CowHeader *header = (CowHeader*)wmem_malloc(subsystem, sizeof(CowHeader) + size);
+    if (!header) return NULL;
+
+    header->info.refs = 1;
+    header->info.size = size;
+    header->info.next = NULL;
+    return header + 1;
+}
+
+void *cow_reserve(MemSubsystem subsystem, void *block, size_t used, size_t size) {
+    if (!block) return cow_alloc(subsystem, size);
+
+    CowHeader *header = (CowHeader*)block - 1;
+
+    // Only the owner takes references, so a count of one stays one while
+    // the block is written
+    if (LOAD(&header->info.refs) == 1) {
+        if (header->info.size == size) return block;
+
+        header = (CowHeader*)wmem_realloc(subsystem, header, sizeof(CowHeader) + size);
+        if (!header) return NULL;
+        header->info.size = size;
+        return header + 1;
+    }
+
+    void *copy = cow_alloc(subsystem, size);
+    if (!copy) return NULL;
+    memcpy(copy, block, used < size ? used : size);
+    cow_free(block);
+    return copy;
+}
+
+void *cow_retain(void *block) {
+    if (!block) return NULL;
+
+    collect_released();
+    INCREMENT(&((CowHeader*)block - 1)->info.refs);
+    return block;
+}
+
+void cow_release(void *block) {
+    if (!block) return;
+
+    CowHeader *header = (CowHeader*)block - 1;
+    if (DECREMENT(&header->info.refs) != 0) return;
+
+    // Push it for the owner; wmem isn't safe to call from here
+    void *head;
+    do {
+        head = LOAD_POINTER(&g_released);
+        header->info.next = (CowHeader*)head;
+    } while (!SWAP_IF(&g_released, head, header));
+}
+
+void cow_free(void *block) {
+    collect_released();
+    if (!block) return;
+
+    CowHeader *header = (CowHeader*)block - 1;
+    if (DECREMENT(&header->info.refs) == 0) wmem_free(header);
+}
\ No newline at end of file
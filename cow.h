@@ -0,0 +1,34 @@
+#ifndef COW_H
+#define COW_H
+
+#include <stddef.h>
+#include "wmem.h"
+
+// Copy-on-write blocks behind the model's arrays, for snapshots. A block
+// carries a reference count in front of its data: a snapshot takes another
+// reference in O(1), and the owner copies the block only when it next
+// writes to one that is still shared, so readers never copy and never wait.
+//
+// Everything but cow_release runs on the thread that owns the data, as wmem
+// does. cow_release may run on any thread; it never frees, the last reader
+// hands the block back and the owner frees it on its next cow call.
+
+// A new block with one reference, the owner's
+void *cow_alloc(MemSubsystem subsystem, size_t size);
+
+// A block of size bytes the owner may write, holding the first used bytes
+// of block: block itself while no snapshot shares it, else a copy (the
+// owner's reference to block is dropped). NULL block allocates. Returns NULL
+// when out of memory, leaving block as it was.
+void *cow_reserve(MemSubsystem subsystem, void *block, size_t used, size_t size);
+
+// Another reference for a snapshot; NULL stays NULL
+void *cow_retain(void *block);
+
+// Drop a snapshot's reference, from any thread
+void cow_release(void *block);
+
+// Drop the owner's reference
+void cow_free(void *block);
+
+#endif // COW_H
\ No newline at end of file
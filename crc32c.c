@@ -0,0 +1,249 @@
+#include "crc32c.h"
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define CRC32C_SSE42
+#include <nmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) && !defined(__AARCH64EB__) && (defined(__GNUC__) || defined(__clang__))
+// MSVC on ARM64 takes the tables
+#define CRC32C_ARMV8
+#include <arm_acle.h>
+#if defined(__linux__)
+#include <sys/auxv.h>
+#ifndef HWCAP_CRC32
+#define HWCAP_CRC32 (1 << 7)
+#endif
+#endif
+#endif
+
+#ifdef _MSC_VER
+#define TARGET(features)
+#else
+#define TARGET(features) __attribute__((target(features)))
+#endif
+
+// Reflected Castagnoli polynomial
+#define POLY 0x82f63b78u
+
+// Stream lengths for the hardware loops: long runs for big buffers, short
+// ones for what is left
+#define LONG_STREAM 8192
+#define SHORT_STREAM 256
+
+enum { METHOD_TABLE, METHOD_SSE42, METHOD_ARMV8 };
+
+// g_table[k][n]: the CRC of byte n followed by k zero bytes
+static uint32_t g_table[8][256];
+
+// The effect of LONG_STREAM or SHORT_STREAM zero bytes on a CRC, a byte of
+// it at a time, for joining the streams back together
+static uint32_t g_long[4][256];
+static uint32_t g_short[4][256];
+
+static int g_method = -1;
+
+static uint32_t read_u32(const unsigned char *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Both hardware paths are little-endian, as the CRC wants the words
+static uint64_t load_u64(const unsigned char *p) {
+    uint64_t word;
+    memcpy(&word, p, sizeof(word));
+    return word;
+}
+
+// ---------------------------------------------------------------------------
+// Zero operators: a CRC is linear over GF(2), so appending n zero bytes is a
+// 32x32 bit matrix, found by squaring the one-bit operator
+// ---------------------------------------------------------------------------
+
+static uint32_t matrix_times(const uint32_t *matrix, uint32_t vector) {
+    uint32_t sum = 0;
+
+    for (; vector; vector >>= 1, matrix++) {
+        if (vector & 1) sum ^= *matrix;
+    }
+    return sum;
+}
+
+static void matrix_square(uint32_t *square, const uint32_t *matrix) {
+    for (int n = 0; n < 32; n++) square[n] = matrix_times(matrix, matrix[n]);
+}
+
+// The operator for length zero bytes, length a power of two
+static void zeros_operator(uint32_t *even, size_t length) {
+    uint32_t odd[32];
+    uint32_t row = 1;
+
+    odd[0] = POLY;
+    for (int n = 1; n < 32; n++) {
+        odd[n] = row;
+        row <<= 1;
+    }
+
+    // Two zero bits, then four
+    matrix_square(even, odd);
+    matrix_square(odd, even);
+
+    // Each pass doubles: even holds a byte's worth first
+    do {
+        matrix_square(even, odd);
+        length >>= 1;
+        if (length == 0) return;
+        matrix_square(odd, even);
+        length >>= 1;
+    } while (length);
+
+    memcpy(even, odd, sizeof(odd));
+}
+
+static void build_zeros(uint32_t zeros[4][256], size_t length) {
+    uint32_t op[32];
+
+    zeros_operator(op, length);
+    for (uint32_t n = 0; n < 256; n++) {
+        zeros[0][n] = matrix_times(op, n);
+        zeros[1][n] = matrix_times(op, n << 8);
+        zeros[2][n] = matrix_times(op, n << 16);
+        zeros[3][n] = matrix_times(op, n << 24);
+    }
+}
+
+static uint32_t shift(uint32_t zeros[4][256], uint32_t crc) {
+    return zeros[0][crc & 0xff] ^ zeros[1][(crc >> 8) & 0xff] ^ zeros[2][(crc >> 16) & 0xff] ^ zeros[3][crc >> 24];
+}
+
+// ---------------------------------------------------------------------------
+// Tables: eight bytes per step
+// ---------------------------------------------------------------------------
+
+static uint32_t crc_table(uint32_t crc, const unsigned char *next, size_t size) {
+    while (size >= 8) {
+        uint32_t low = crc ^ read_u32(next);
+        uint32_t high = read_u32(next + 4);
+        crc = g_table[7][low & 0xff] ^ g_table[6][(low >> 8) & 0xff] ^
+              g_table[5][(low >> 16) & 0xff] ^ g_table[4][low >> 24] ^
+              g_table[3][high & 0xff] ^ g_table[2][(high >> 8) & 0xff] ^
+              g_table[1][(high >> 16) & 0xff] ^ g_table[0][high >> 24];
+        next += 8;
+        size -= 8;
+    }
+    while (size--) crc = (crc >> 8) ^ g_table[0][(crc ^ *next++) & 0xff];
+    return crc;
+}
+
+// ---------------------------------------------------------------------------
+// Hardware: three independent streams keep the CRC unit busy, then the
+// zero operators join them
+// ---------------------------------------------------------------------------
+
+#ifdef CRC32C_SSE42
+#define CRC_BYTE(crc, p) _mm_crc32_u8((uint32_t)(crc), *(p))
+#define CRC_WORD(crc, p) _mm_crc32_u64((crc), load_u64(p))
+#define HARDWARE_TARGET TARGET("sse4.2")
+#define crc_hardware crc_sse42
+#elif defined(CRC32C_ARMV8)
+#define CRC_BYTE(crc, p) __crc32cb((uint32_t)(crc), *(p))
+#define CRC_WORD(crc, p) __crc32cd((uint32_t)(crc), load_u64(p))
+#define HARDWARE_TARGET TARGET("+crc")
+#define crc_hardware crc_armv8
+#endif
+
+#ifdef HARDWARE_TARGET
+HARDWARE_TARGET static uint32_t crc_hardware(uint32_t crc, const unsigned char *next, size_t size) {
+    uint64_t crc0 = crc;
+
+    // Word loads from here on are aligned
+    while (size && ((uintptr_t)next & 7)) {
+        crc0 = CRC_BYTE(crc0, next);
+        next++;
+        size--;
+    }
+
+    while (size >= 3 * LONG_STREAM) {
+        uint64_t crc1 = 0, crc2 = 0;
+        const unsigned char *end = next + LONG_STREAM;
+        do {
+            crc0 = CRC_WORD(crc0, next);
+            crc1 = CRC_WORD(crc1, next + LONG_STREAM);
+            crc2 = CRC_WORD(crc2, next + 2 * LONG_STREAM);
+            next += 8;
+        } while (next < end);
+        crc0 = shift(g_long, (uint32_t)crc0) ^ crc1;
+        crc0 = shift(g_long, (uint32_t)crc0) ^ crc2;
+        next += 2 * LONG_STREAM;
+        size -= 3 * LONG_STREAM;
+    }
+
+    while (size >= 3 * SHORT_STREAM) {
+        uint64_t crc1 = 0, crc2 = 0;
+        const unsigned char *end = next + SHORT_STREAM;
+        do {
+            crc0 = CRC_WORD(crc0, next);
+            crc1 = CRC_WORD(crc1, next + SHORT_STREAM);
+            crc2 = CRC_WORD(crc2, next + 2 * SHORT_STREAM);
+            next += 8;
+        } while (next < end);
+        crc0 = shift(g_short, (uint32_t)crc0) ^ crc1;
+        crc0 = shift(g_short, (uint32_t)crc0) ^ crc2;
+        next += 2 * SHORT_STREAM;
+        size -= 3 * SHORT_STREAM;
+    }
+
+    for (; size >= 8; next += 8, size -= 8) crc0 = CRC_WORD(crc0, next);
+    for (; size; next++, size--) crc0 = CRC_BYTE(crc0, next);
+    return (uint32_t)crc0;
+}
+#endif
+
+static int detect_method(void) {
+#if defined(CRC32C_SSE42) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    if (info[2] & (1 << 20)) return METHOD_SSE42;
+#elif defined(CRC32C_SSE42)
+    if (__builtin_cpu_supports("sse4.2")) return METHOD_SSE42;
+#elif defined(CRC32C_ARMV8) && (defined(__ARM_FEATURE_CRC32) || defined(__APPLE__))
+    return METHOD_ARMV8;
+#elif defined(CRC32C_ARMV8) && defined(__linux__)
+    if (getauxval(AT_HWCAP) & HWCAP_CRC32) return METHOD_ARMV8;
+#endif
+    return METHOD_TABLE;
+}
+
+static void init(void) {
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t crc = n;
+        for (int k = 0; k < 8; k++) crc = crc & 1 ? (crc >> 1) ^ POLY : crc >> 1;
+        g_table[0][n] = crc;
+    }
+    for (int n = 0; n < 256; n++) {
+        for (int k = 1; k < 8; k++) g_table[k][n] = (g_table[k - 1][n] >> 8) ^ g_table[0][g_table[k - 1][n] & 0xff];
+    }
+
+    build_zeros(g_long, LONG_STREAM);
+    build_zeros(g_short, SHORT_STREAM);
+    g_method = detect_method();
+}
+
+unsigned int crc32c(unsigned int crc, const void *data, size_t size) {
+    const unsigned char *next = (const unsigned char*)data;
+
+    if (g_method < 0) init();
+
+    crc = ~crc;
+#ifdef HARDWARE_TARGET
+    if (g_method != METHOD_TABLE) return ~crc_hardware(crc, next, size);
+#endif
+    return ~crc_table(crc, next, size);
+}
+
+const char *crc32c_method(void) {
+    if (g_method < 0) init();
+    return g_method == METHOD_SSE42 ? "sse4.2" : g_method == METHOD_ARMV8 ? "armv8" : "table";
+}
\ No newline at end of file
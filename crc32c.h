@@ -0,0 +1,18 @@
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <stddef.h>
+
+// CRC-32C (Castagnoli), the checksum the archive's manifest keeps for every
+// member. Uses the SSE4.2 or ARMv8 CRC instructions when the CPU has them,
+// three streams at a time so the instruction's latency is hidden, and
+// tables otherwise. The tables are built on the first call.
+
+// The CRC of size bytes, continuing from crc: 0 to start, or the result of
+// the previous call for the bytes before these
+unsigned int crc32c(unsigned int crc, const void *data, size_t size);
+
+// "sse4.2", "armv8" or "table", for diagnostics
+const char *crc32c_method(void);
+
+#endif // CRC32C_H
\ No newline at end of file
@@ -0,0 +1,316 @@
+#include "dialog.h"
+#include "input.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "compat.h"
+
+static void add_field(Dialog *dialog, const char *label, const char *text, int max_length,
+                      const char *accept, int required) {
+    DialogField *field = &dialog->fields[dialog->field_count++];
+
+    strcpy_s(field->label, sizeof(field->label), label);
+    field->max_length = max_length < DIALOG_FIELD_LENGTH - 1 ? max_length : DIALOG_FIELD_LENGTH - 1;
+    field->accept = accept;
+    field->required = required;
+
+    field->text[0] = '\0';
+    if (text) {
+        strncpy(field->text, text, field->max_length);
+        field->text[field->max_length] = '\0';
+    }
+    field->length = (int)strlen(field->text);
+}
+
+int dialog_open(Dialog *dialog, DialogType type, UIState *state, AppointmentList *appointments, TodoList *todos) {
+    char text[32];
+
+    memset(dialog, 0, sizeof(*dialog));
+    dialog->target = -1;
+
+    switch (type) {
+        case DIALOG_ADD_APPOINTMENT:
+            dialog->title = "Add Appointment";
+            dialog->width = 60;
+            dialog->height = 10;
+            dialog->date = state->selected_date;
+            add_field(dialog, "Time (HH:MM): ", NULL, 9, "0123456789:", 1);
+            add_field(dialog, "Duration (e.g., 30m, 4h, 3d2h30m): ", NULL, 19, NULL, 0);
+            add_field(dialog, "Description: ", NULL, MAX_DESCRIPTION_LENGTH - 1, NULL, 1);
+            add_field(dialog, "Remind before (e.g., 15m, optional): ", NULL, 19, NULL, 0);
+            break;
+
+        case DIALOG_EDIT_APPOINTMENT:
+            {
+                if (state->selected_view != VIEW_APPOINTMENTS) return 0;
+                dialog->target = get_selected_index(state, appointments, todos);
+                if (dialog->target < 0) return 0;
+
+                // Fields start out holding the current values
+                Appointment *app = &appointments->items[dialog->target];
+                dialog->title = "Edit Appointment";
+                dialog->width = 60;
+                dialog->height = 10;
+                sprintf_s(text, sizeof(text), "%02d:%02d", app->date_time.hour, app->date_time.minute);
+                add_field(dialog, "Time (HH:MM): ", text, 9, "0123456789:", 0);
+                format_duration_compact(app->duration_minutes, text, sizeof(text));
+                add_field(dialog, "Duration: ", text, 19, NULL, 0);
+                add_field(dialog, "Description: ", app->description, MAX_DESCRIPTION_LENGTH - 1, NULL, 0);
+                text[0] = '\0';
+                if (app->reminder_minutes > 0) {
+                    format_duration_compact(app->reminder_minutes, text, sizeof(text));
+                }
+                add_field(dialog, "Remind before (- for none): ", text, 19, NULL, 0);
+            }
+            break;
+
+        case DIALOG_ADD_TODO:
+            dialog->title = "Add TODO";
+            dialog->width = 60;
+            dialog->height = 9;
+            add_field(dialog, "Description: ", NULL, MAX_TODO_DESCRIPTION - 1, NULL, 1);
+            add_field(dialog, "Priority (0=Normal, 1=High, 2=Urgent): ", NULL, 1, "012", 0);
+            add_field(dialog, "Due (YYYY-MM-DD, optional): ", NULL, 10, "0123456789-", 0);
+            break;
+
+        case DIALOG_EDIT_TODO:
+            {
+                if (state->selected_view != VIEW_TODO) return 0;
+                dialog->target = get_selected_index(state, appointments, todos);
+                if (dialog->target < 0) return 0;
+
+                TodoItem *todo = todo_at(todos, dialog->target);
+                dialog->title = "Edit TODO";
+                dialog->width = 60;
+                dialog->height = 9;
+                sprintf_s(text, sizeof(text), "%d", todo->priority);
+                add_field(dialog, "Description: ", todo->description, MAX_TODO_DESCRIPTION - 1, NULL, 0);
+                add_field(dialog, "Priority (0=Normal, 1=High, 2=Urgent): ", text, 1, "012", 0);
+                text[0] = '\0';
+                if (todo->due.year) {
+                    sprintf_s(text, sizeof(text), "%04d-%02d-%02d", todo->due.year, todo->due.month, todo->due.day);
+                }
+                add_field(dialog, "Due (YYYY-MM-DD, - for none): ", text, 10, "0123456789-", 0);
+            }
+            break;
+
+        case DIALOG_CONFIRM_DELETE:
+            if (get_selected_index(state, appointments, todos) < 0) return 0;
+            dialog->title = "Confirm Delete";
+            dialog->width = 40;
+            dialog->height = 6;
+            break;
+
+        case DIALOG_HELP:
+            dialog->title = "Help";
+            dialog->width = 70;
+            dialog->height = 20;
+            break;
+
+        default:
+            return 0;
+    }
+
+    dialog->type = type;
+    return 1;
+}
+
+int dialog_is_open(const Dialog *dialog) {
+    return dialog->type != DIALOG_NONE;
+}
+
+void dialog_close(Dialog *dialog, UIState *state) {
+    dialog->type = DIALOG_NONE;
+    fb_show_cursor(0);
+    mark_dirty(state, DIRTY_ALL);   // Repaint whatever the dialog covered
+}
+
+// Apply a completed form to the data
+static void dialog_submit(Dialog *dialog, UIState *state, AppointmentList *appointments, TodoList *todos) {
+    DialogField *fields = dialog->fields;
+    int hour, minute;
+
+    switch (dialog->type) {
+        case DIALOG_ADD_APPOINTMENT:
+            {
+                Appointment app;
+                memset(&app, 0, sizeof(app));
+
+                if (sscanf_s(fields[0].text, "%d:%d", &hour, &minute) != 2) break;   // Invalid time
+                app.date_time.year = dialog->date.year;
+                app.date_time.month = dialog->date.month;
+                app.date_time.day = dialog->date.day;
+                app.date_time.hour = hour;
+                app.date_time.minute = minute;
+                app.duration_minutes = parse_duration_string(fields[1].text);
+                strcpy_s(app.description, MAX_DESCRIPTION_LENGTH, fields[2].text);
+                app.reminder_minutes = parse_duration_string(fields[3].text);
+
+                add_appointment(appointments, &app);
+            }
+            break;
+
+        case DIALOG_EDIT_APPOINTMENT:
+            {
+                if (dialog->target >= appointments->count) break;
+                Appointment app = appointments->items[dialog->target];
+
+                // Cleared fields keep the old value
+                if (sscanf_s(fields[0].text, "%d:%d", &hour, &minute) == 2) {
+                    app.date_time.hour = hour;
+                    app.date_time.minute = minute;
+                }
+                if (fields[1].length > 0) {
+                    app.duration_minutes = parse_duration_string(fields[1].text);
+                }
+                if (fields[2].length > 0) {
+                    strcpy_s(app.description, MAX_DESCRIPTION_LENGTH, fields[2].text);
+                }
+                if (strcmp(fields[3].text, "-") == 0) {
+                    app.reminder_minutes = 0;
+                } else if (fields[3].length > 0) {
+                    app.reminder_minutes = parse_duration_string(fields[3].text);
+                }
+
+                edit_appointment(appointments, dialog->target, &app);
+            }
+            break;
+
+        case DIALOG_ADD_TODO:
+            {
+                TodoItem todo;
+                memset(&todo, 0, sizeof(todo));
+
+                strcpy_s(todo.description, MAX_TODO_DESCRIPTION, fields[0].text);
+                todo.priority = atoi(fields[1].text);
+                parse_date(fields[2].text, &todo.due);     // Left without a due date if blank or invalid
+                add_todo(todos, &todo);
+            }
+            break;
+
+        case DIALOG_EDIT_TODO:
+            {
+                if (dialog->target >= todos->count) break;
+                TodoItem todo = *todo_at(todos, dialog->target);
+
+                if (fields[0].length > 0) {
+                    strcpy_s(todo.description, MAX_TODO_DESCRIPTION, fields[0].text);
+                }
+                if (fields[1].length > 0) {
+                    todo.priority = atoi(fields[1].text);
+                }
+                if (strcmp(fields[2].text, "-") == 0) {
+                    memset(&todo.due, 0, sizeof(todo.due));
+                } else if (fields[2].length > 0) {
+                    parse_date(fields[2].text, &todo.due);
+                }
+
+                edit_todo(todos, dialog->target, &todo);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+void dialog_handle_key(Dialog *dialog, int key, UIState *state, AppointmentList *appointments, TodoList *todos) {
+    if (key == KEY_IGNORED) return;
+
+    switch (dialog->type) {
+        case DIALOG_NONE:
+            return;
+
+        case DIALOG_HELP:
+            // Any key returns
+            dialog_close(dialog, state);
+            return;
+
+        case DIALOG_CONFIRM_DELETE:
+            if (key == 'y' || key == 'Y') {
+                delete_selection(state, appointments, todos);
+            }
+            dialog_close(dialog, state);
+            return;
+
+        default:
+            break;
+    }
+
+    DialogField *field = &dialog->fields[dialog->active_field];
+
+    if (key == KEY_ESC || key == KEY_NONE) {
+        dialog_close(dialog, state);
+    } else if (key == KEY_ENTER || key == '\n') {
+        if (field->required && field->length == 0) {
+            dialog_close(dialog, state);    // Empty answer cancels, as it always has
+        } else if (dialog->active_field < dialog->field_count - 1) {
+            dialog->active_field++;
+        } else {
+            dialog_submit(dialog, state, appointments, todos);
+            dialog_close(dialog, state);
+        }
+    } else if (key == KEY_UP) {
+        if (dialog->active_field > 0) dialog->active_field--;
+    } else if (key == KEY_DOWN || key == KEY_TAB) {
+        if (dialog->active_field < dialog->field_count - 1) dialog->active_field++;
+    } else if (key == KEY_BACKSPACE) {
+        if (field->length > 0) field->text[--field->length] = '\0';
+    } else if (key >= 32 && key < 127 && field->length < field->max_length) {
+        if (!field->accept || strchr(field->accept, key)) {
+            field->text[field->length++] = (char)key;
+            field->text[field->length] = '\0';
+        }
+    }
+}
+
+void dialog_draw(const Dialog *dialog, UIState *state) {
+    if (!dialog_is_open(dialog)) return;
+
+    if (dialog->type == DIALOG_HELP) {
+        draw_help_screen(state);
+        fb_show_cursor(0);
+        return;
+    }
+
+    // Centred on the current window, so a resize moves the dialog with it
+    int x = state->window_width / 2 - dialog->width / 2;
+    int y = state->window_height / 2 - dialog->height / 2;
+
+    clear_area(x, y, dialog->width, dialog->height);
+    draw_box(x, y, dialog->width, dialog->height, dialog->title);
+    set_color(NORMAL_FG, NORMAL_BG);
+
+    if (dialog->type == DIALOG_CONFIRM_DELETE) {
+        gotoxy(x + 2, y + 2);
+        fb_printf("Delete selected item? (y/n)");
+        fb_show_cursor(0);
+        return;
+    }
+
+    int cursor_x = x + 2;
+    int cursor_y = y + 2;
+
+    for (int i = 0; i < dialog->field_count; i++) {
+        const DialogField *field = &dialog->fields[i];
+        int label_length = (int)strlen(field->label);
+        int visible = dialog->width - 4 - label_length;
+        const char *text = field->text;
+
+        // Long values scroll so the end being typed stays in view
+        if (visible < 1) visible = 1;
+        if (field->length > visible - 1) text += field->length - (visible - 1);
+
+        gotoxy(x + 2, y + 2 + i);
+        fb_printf("%s%s", field->label, text);
+
+        if (i == dialog->active_field) {
+            cursor_x = x + 2 + label_length + (int)strlen(text);
+            cursor_y = y + 2 + i;
+        }
+    }
+
+    // Leave the frame buffer cursor on the active field
+    gotoxy(cursor_x, cursor_y);
+    fb_show_cursor(1);
+}
\ No newline at end of file
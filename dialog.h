@@ -0,0 +1,56 @@
+#ifndef DIALOG_H
+#define DIALOG_H
+
+#include "ui.h"
+#include "appointments.h"
+#include "todo.h"
+
+#define DIALOG_MAX_FIELDS   4
+#define DIALOG_FIELD_LENGTH 256
+
+typedef enum {
+    DIALOG_NONE,
+    DIALOG_ADD_APPOINTMENT,
+    DIALOG_EDIT_APPOINTMENT,
+    DIALOG_ADD_TODO,
+    DIALOG_EDIT_TODO,
+    DIALOG_CONFIRM_DELETE,
+    DIALOG_HELP
+} DialogType;
+
+// One line of text input
+typedef struct {
+    char label[48];
+    char text[DIALOG_FIELD_LENGTH];
+    int length;
+    int max_length;         // Characters accepted, not counting the terminator
+    const char *accept;     // Allowed characters, NULL for any printable one
+    int required;           // Enter on an empty required field cancels the dialog
+} DialogField;
+
+// A modal dialog. It does not block: main_loop hands it keys with
+// dialog_handle_key and draws it over the panels with dialog_draw, so
+// resizes and timers keep being handled while it is open.
+typedef struct {
+    DialogType type;
+    const char *title;
+    int width, height;
+    DialogField fields[DIALOG_MAX_FIELDS];
+    int field_count;
+    int active_field;
+    int target;             // Item being edited
+    Date date;              // Day a new appointment goes on
+} Dialog;
+
+// Opening returns 0 when there is nothing to act on (e.g. edit without a selection)
+int dialog_open(Dialog *dialog, DialogType type, UIState *state, AppointmentList *appointments, TodoList *todos);
+int dialog_is_open(const Dialog *dialog);
+void dialog_close(Dialog *dialog, UIState *state);
+
+// Feed one key; applies the dialog's change and closes it when it completes
+void dialog_handle_key(Dialog *dialog, int key, UIState *state, AppointmentList *appointments, TodoList *todos);
+
+// Draw over the composed panels (call between compose_ui and fb_flush)
+void dialog_draw(const Dialog *dialog, UIState *state);
+
+#endif // DIALOG_H
\ No newline at end of file
@@ -1,13 +1,57 @@
 #include "input.h"
-#include <conio.h>
+#include "trace.h"
+#include "compat.h"
 #include <stdio.h>
 
-// Global to track the last key pressed for context
-static int g_last_key_pressed = 0;
+// Keys that only move the selection or scroll; a run of them can be applied as one move
+int is_navigation_key(int key) {
+    switch (key) {
+        case KEY_UP:
+        case KEY_DOWN:
+        case KEY_LEFT:
+        case KEY_RIGHT:
+        case KEY_PGUP:
+        case KEY_PGDN:
+        case KEY_HOME:
+            return 1;
+    }
+    return 0;
+}
 
-InputAction process_input(int key, UIState *state, AppointmentList *appointments, TodoList *todos) {
-    g_last_key_pressed = key;  // Track the key that was pressed
+void key_queue_clear(KeyQueue *queue) {
+    queue->head = 0;
+    queue->count = 0;
+}
+
+// Returns 0 when the queue is full and the key was not taken
+int key_queue_push(KeyQueue *queue, int key) {
+    if (queue->count > 0 && is_navigation_key(key)) {
+        KeyEvent *last = &queue->events[(queue->head + queue->count - 1) % KEY_QUEUE_SIZE];
+        if (last->key == key) {
+            last->count++;
+            return 1;
+        }
+    }
+    
+    if (queue->count >= KEY_QUEUE_SIZE) return 0;
+    
+    KeyEvent *event = &queue->events[(queue->head + queue->count) % KEY_QUEUE_SIZE];
+    event->key = key;
+    event->count = 1;
+    queue->count++;
+    return 1;
+}
+
+int key_queue_pop(KeyQueue *queue, KeyEvent *event) {
+    if (queue->count == 0) return 0;
     
+    *event = queue->events[queue->head];
+    queue->head = (queue->head + 1) % KEY_QUEUE_SIZE;
+    queue->count--;
+    return 1;
+}
+
+static InputAction handle_key(int key, int count, UIState *state, AppointmentList *appointments, TodoList *todos) {
     // Global keys that work in any view
     switch (key) {
         case 'q':
@@ -49,118 +93,99 @@ InputAction process_input(int key, UIState *state, AppointmentList *appointments
             state->cursor_x = 0;
             state->cursor_y = 0;
             state->appointment_display_index = 0;
+            state->appointment_scroll = 0;
+            mark_dirty(state, DIRTY_ALL);   // Selection highlight moves between panels
             return ACTION_REDRAW;
             
         case KEY_SPACE:
             // Toggle completion for todos only
             if (state->selected_view == VIEW_TODO) {
-                return ACTION_EDIT;  // This will be handled specially in edit_selected_item
+                return ACTION_TOGGLE;
             }
             break;
+            
+        case 'o':
+        case 'O':
+            // Switch the todo list between everything and overdue items
+            if (state->selected_view == VIEW_TODO) {
+                state->todo_filter = state->todo_filter == TODO_FILTER_ALL ? TODO_FILTER_OVERDUE : TODO_FILTER_ALL;
+                state->todo_scroll = 0;
+                state->cursor_y = 0;
+                mark_dirty(state, DIRTY_TODO);
+                return ACTION_REDRAW;
+            }
+            break;
+            
+        case '`':
+            // Not in the help: live timings of the traced paths, for "wcal is slow" reports
+            state->show_timings = !state->show_timings;
+            trace_set_live(state->show_timings);
+            mark_dirty(state, DIRTY_STATUS);
+            return ACTION_REDRAW;
+    }
+    
+    // Number keys show or hide a calendar, in any view
+    if (key >= '1' && key < '1' + MAX_CALENDARS && state->calendars &&
+        calset_toggle(state->calendars, key - '1') >= 0) {
+        clamp_appointment_selection(state, appointments);
+        mark_dirty(state, DIRTY_APPOINTMENTS | DIRTY_CALENDAR | DIRTY_STATUS);
+        return ACTION_REDRAW;
     }
     
     // View-specific navigation
     switch (state->selected_view) {
         case VIEW_CALENDAR:
-            navigate_calendar(key, state);
+            navigate_calendar(key, count, state);
             break;
             
         case VIEW_APPOINTMENTS:
-            navigate_appointments(key, state, appointments);
+            navigate_appointments(key, count, state, appointments);
             break;
             
         case VIEW_TODO:
-            navigate_todos(key, state, todos);
+            navigate_todos(key, count, state, todos);
             break;
     }
     
-    g_last_key_pressed = key; // Track the last key pressed
     return ACTION_REDRAW;
 }
 
-void navigate_calendar(int key, UIState *state) {
-    int days_in_month = get_days_in_month(state->selected_date.year, state->selected_date.month);
+InputAction process_input(int key, int count, UIState *state, AppointmentList *appointments, TodoList *todos) {
+    unsigned long long span = trace_begin();
+    InputAction action = handle_key(key, count, state, appointments, todos);
+    trace_end(TRACE_INPUT, span);
+    return action;
+}
+
+void navigate_calendar(int key, int count, UIState *state) {
+    Date old_date = state->selected_date;
     
+    // A run of repeated keys moves by the whole distance at once
     switch (key) {
         case KEY_LEFT:
-            state->selected_date.day--;
-            if (state->selected_date.day < 1) {
-                // Go to previous month
-                state->selected_date.month--;
-                if (state->selected_date.month < 1) {
-                    state->selected_date.month = 12;
-                    state->selected_date.year--;
-                }
-                state->selected_date.day = get_days_in_month(state->selected_date.year, state->selected_date.month);
-            }
+            add_days_to_date(&state->selected_date, -count);
             break;
             
         case KEY_RIGHT:
-            state->selected_date.day++;
-            if (state->selected_date.day > days_in_month) {
-                // Go to next month
-                state->selected_date.day = 1;
-                state->selected_date.month++;
-                if (state->selected_date.month > 12) {
-                    state->selected_date.month = 1;
-                    state->selected_date.year++;
-                }
-            }
+            add_days_to_date(&state->selected_date, count);
             break;
             
         case KEY_UP:
-            state->selected_date.day -= 7;
-            if (state->selected_date.day < 1) {
-                // Go to previous month
-                state->selected_date.month--;
-                if (state->selected_date.month < 1) {
-                    state->selected_date.month = 12;
-                    state->selected_date.year--;
-                }
-                int prev_days = get_days_in_month(state->selected_date.year, state->selected_date.month);
-                state->selected_date.day = prev_days + state->selected_date.day;
-            }
+            add_days_to_date(&state->selected_date, -7 * count);
             break;
             
         case KEY_DOWN:
-            state->selected_date.day += 7;
-            if (state->selected_date.day > days_in_month) {
-                // Go to next month
-                state->selected_date.day = state->selected_date.day - days_in_month;
-                state->selected_date.month++;
-                if (state->selected_date.month > 12) {
-                    state->selected_date.month = 1;
-                    state->selected_date.year++;
-                }
-            }
+            add_days_to_date(&state->selected_date, 7 * count);
             break;
             
         case KEY_PGUP:
-            // Previous month
-            state->selected_date.month--;
-            if (state->selected_date.month < 1) {
-                state->selected_date.month = 12;
-                state->selected_date.year--;
-            }
-            // Adjust day if necessary
-            days_in_month = get_days_in_month(state->selected_date.year, state->selected_date.month);
-            if (state->selected_date.day > days_in_month) {
-                state->selected_date.day = days_in_month;
-            }
+            // Previous month, day clamped to its length
+            add_months_to_date(&state->selected_date, -count);
             break;
             
         case KEY_PGDN:
-            // Next month
-            state->selected_date.month++;
-            if (state->selected_date.month > 12) {
-                state->selected_date.month = 1;
-                state->selected_date.year++;
-            }
-            // Adjust day if necessary
-            days_in_month = get_days_in_month(state->selected_date.year, state->selected_date.month);
-            if (state->selected_date.day > days_in_month) {
-                state->selected_date.day = days_in_month;
-            }
+            // Next month, day clamped to its length
+            add_months_to_date(&state->selected_date, count);
             break;
             
         case KEY_HOME:
@@ -171,208 +196,178 @@ void navigate_calendar(int key, UIState *state) {
     
     // Reset appointment display index when date changes
     state->appointment_display_index = 0;
+    state->appointment_scroll = 0;
+    
+    // Within the same month only the two day cells change
+    if (compare_dates(old_date, state->selected_date) != 0) {
+        if (old_date.year != state->selected_date.year || old_date.month != state->selected_date.month) {
+            mark_dirty(state, DIRTY_CALENDAR);
+        } else {
+            mark_dirty_range(&state->calendar_dirty_days, old_date.day, state->selected_date.day);
+        }
+        mark_dirty(state, DIRTY_APPOINTMENTS);
+    }
+}
+
+// Keep a selection inside [0, count) and the scroll offset inside
+// [0, count - page], moving the window just enough to show the selection
+static void clamp_selection(int *selected, int *scroll, int count, int page) {
+    int max_scroll = count - page;
+    if (max_scroll < 0) max_scroll = 0;
+    
+    if (*selected >= count) *selected = count - 1;
+    if (*selected < 0) *selected = 0;
+    
+    if (*selected < *scroll) *scroll = *selected;
+    if (*selected >= *scroll + page) *scroll = *selected - page + 1;
+    if (*scroll > max_scroll) *scroll = max_scroll;
+    if (*scroll < 0) *scroll = 0;
 }
 
-void navigate_appointments(int key, UIState *state, AppointmentList *appointments) {
-    // Get the count of appointments for the current selected date
-    int appointment_indices[100];
-    int appointment_count = 0;
+void clamp_appointment_selection(UIState *state, AppointmentList *appointments) {
+    int count = appointments ? ui_appointment_count(state, appointments, state->selected_date) : 0;
+    int selected = state->appointment_display_index;
+    int scroll = state->appointment_scroll / 2;
+    
+    clamp_selection(&selected, &scroll, count, ui_appointment_page_size(state));
     
-    if (appointments) {
-        appointment_count = find_appointments_by_date(appointments, state->selected_date, appointment_indices, 100);
+    state->appointment_display_index = selected;
+    state->appointment_scroll = scroll * 2;     // Each appointment takes 2 lines
+    if (state->selected_view == VIEW_APPOINTMENTS) {
+        state->cursor_y = selected * 2;
     }
+}
+
+void clamp_todo_selection(UIState *state, TodoList *todos) {
+    int count = todos ? ui_todo_count(state, todos) : 0;
+    int selected = state->todo_scroll + state->cursor_y;
+    
+    clamp_selection(&selected, &state->todo_scroll, count, ui_todo_page_size(state));
+    
+    state->cursor_y = selected - state->todo_scroll;
+}
+
+void navigate_appointments(int key, int count, UIState *state, AppointmentList *appointments) {
+    int page = ui_appointment_page_size(state);
+    int old_index = state->appointment_display_index;
+    int old_scroll = state->appointment_scroll;
     
     switch (key) {
         case KEY_UP:
-            if (state->cursor_y > 0) {
-                state->cursor_y -= 2;  // Each appointment takes 2 lines
-                state->appointment_display_index--;
-            } else if (state->appointment_scroll > 0) {
-                state->appointment_scroll--;
-            }
+            state->appointment_display_index -= count;
             break;
             
         case KEY_DOWN:
-            // Check if we can move down (appointment_display_index is 0-based)
-            if (state->appointment_display_index < appointment_count - 1) {
-                state->cursor_y += 2;  // Each appointment takes 2 lines
-                state->appointment_display_index++;
-            }
+            state->appointment_display_index += count;
             break;
             
         case KEY_PGUP:
-            state->appointment_scroll -= 5;
-            if (state->appointment_scroll < 0) {
-                state->appointment_scroll = 0;
-            }
+            state->appointment_display_index -= page * count;
+            state->appointment_scroll -= page * 2 * count;
             break;
             
         case KEY_PGDN:
-            state->appointment_scroll += 5;
+            state->appointment_display_index += page * count;
+            state->appointment_scroll += page * 2 * count;
             break;
     }
     
-    // Ensure cursor_y and appointment_display_index stay in sync
-    if (state->appointment_display_index < 0) {
-        state->appointment_display_index = 0;
-        state->cursor_y = 0;
-    } else if (state->appointment_display_index >= appointment_count && appointment_count > 0) {
-        state->appointment_display_index = appointment_count - 1;
-        state->cursor_y = state->appointment_display_index * 2;
-    } else if (appointment_count == 0) {
-        state->appointment_display_index = 0;
-        state->cursor_y = 0;
+    // Only the count for the selected day is needed, never the list itself
+    clamp_appointment_selection(state, appointments);
+    
+    // Scrolling moves every entry; a cursor move only touches two entries
+    if (state->appointment_scroll != old_scroll) {
+        mark_dirty(state, DIRTY_APPOINTMENTS);
+    } else if (state->appointment_display_index != old_index) {
+        mark_dirty_range(&state->appointment_dirty_rows, old_index, state->appointment_display_index);
     }
 }
 
-void navigate_todos(int key, UIState *state, TodoList *todos) {
-    int todo_count = todos ? todos->count : 0;
+void navigate_todos(int key, int count, UIState *state, TodoList *todos) {
+    int page = ui_todo_page_size(state);
+    int old_cursor = state->cursor_y;
+    int old_scroll = state->todo_scroll;
     
     switch (key) {
         case KEY_UP:
-            if (state->cursor_y > 0) {
-                state->cursor_y--;
-            } else if (state->todo_scroll > 0) {
-                state->todo_scroll--;
-            }
+            state->cursor_y -= count;
             break;
             
         case KEY_DOWN:
-            // Check if we can move down (considering scroll offset)
-            if (state->cursor_y + state->todo_scroll < todo_count - 1) {
-                state->cursor_y++;
-            }
+            state->cursor_y += count;
             break;
             
         case KEY_PGUP:
-            state->todo_scroll -= 5;
-            if (state->todo_scroll < 0) {
-                state->todo_scroll = 0;
-            }
+            // Move the window and the selection together by a page
+            state->todo_scroll -= page * count;
             break;
             
         case KEY_PGDN:
-            if (state->todo_scroll + 5 < todo_count) {
-                state->todo_scroll += 5;
-            }
+            state->todo_scroll += page * count;
             break;
     }
     
-    // Ensure cursor position stays within bounds
-    if (state->cursor_y < 0) {
-        state->cursor_y = 0;
-    }
+    // The scroll offset comes straight from the list size, so even a huge
+    // list pages in constant time
+    clamp_todo_selection(state, todos);
     
-    // Ensure we don't go beyond the available todos
-    if (state->cursor_y + state->todo_scroll >= todo_count && todo_count > 0) {
-        if (todo_count > 0) {
-            state->cursor_y = todo_count - 1 - state->todo_scroll;
-            if (state->cursor_y < 0) {
-                state->todo_scroll = todo_count - 1;
-                state->cursor_y = 0;
-            }
-        } else {
-            state->cursor_y = 0;
-            state->todo_scroll = 0;
-        }
+    if (state->todo_scroll != old_scroll) {
+        mark_dirty(state, DIRTY_TODO);
+    } else if (state->cursor_y != old_cursor) {
+        mark_dirty_range(&state->todo_dirty_rows, old_cursor, state->cursor_y);
     }
 }
 
-void delete_selected_item(UIState *state, AppointmentList *appointments, TodoList *todos) {
-    // Confirmation dialog
-    int window_width, window_height;
-    update_console_size(state);
-    window_width = state->window_width;
-    window_height = state->window_height;
-    
-    int dialog_x = window_width / 2 - 20;
-    int dialog_y = window_height / 2 - 3;
-    
-    // Clear the background area first
-    clear_area(dialog_x, dialog_y, 40, 6);
-    
-    draw_box(dialog_x, dialog_y, 40, 6, "Confirm Delete");
-    
-    set_color(NORMAL_FG, NORMAL_BG);
-    gotoxy(dialog_x + 2, dialog_y + 2);
-    printf("Delete selected item? (y/n)");
-    
-    int ch = _getch();
-    if (ch == 'y' || ch == 'Y') {
-        switch (state->selected_view) {
-            case VIEW_APPOINTMENTS:
-                {
-                    // Find the actual appointment index based on cursor position
-                    int appointment_indices[100];
-                    int appointment_count = find_appointments_by_date(
-                        appointments, 
-                        state->selected_date, 
-                        appointment_indices, 
-                        100
-                    );
-                    
-                    // Calculate which appointment is selected (each appointment takes 2 lines)
-                    int selected_appointment_index = state->cursor_y / 2;
-                    
-                    if (selected_appointment_index >= 0 && selected_appointment_index < appointment_count) {
-                        int actual_index = appointment_indices[selected_appointment_index];
-                        delete_appointment(appointments, actual_index);
-                        
-                        // Adjust cursor if necessary
-                        if (state->cursor_y > 0 && selected_appointment_index >= appointment_count - 1) {
-                            state->cursor_y -= 2;
-                            if (state->cursor_y < 0) state->cursor_y = 0;
-                        }
-                    }
-                }
-                break;
-                
-            case VIEW_TODO:
-                if (state->cursor_y + state->todo_scroll < todos->count) {
-                    delete_todo(todos, state->cursor_y + state->todo_scroll);
-                    // Adjust cursor if at the end
-                    if (state->cursor_y > 0 && state->cursor_y + state->todo_scroll >= todos->count - 1) {
-                        state->cursor_y--;
-                    }
-                }
-                break;
-        }
-    }
-}
-
-void edit_selected_item(UIState *state, AppointmentList *appointments, TodoList *todos) {
+int get_selected_index(UIState *state, AppointmentList *appointments, TodoList *todos) {
     switch (state->selected_view) {
         case VIEW_APPOINTMENTS:
             {
-                // Find the actual appointment index based on cursor position
-                int appointment_indices[100];
-                int appointment_count = find_appointments_by_date(
-                    appointments, 
-                    state->selected_date, 
-                    appointment_indices, 
-                    100
-                );
-                
-                // Calculate which appointment is selected (each appointment takes 2 lines)
-                int selected_appointment_index = state->cursor_y / 2;
-                
-                if (selected_appointment_index >= 0 && selected_appointment_index < appointment_count) {
-                    int actual_index = appointment_indices[selected_appointment_index];
-                    edit_appointment_interactive(appointments, actual_index);
+                // Each appointment takes 2 lines. Only the main calendar can
+                // be changed; the others are read-only files.
+                AppointmentRef ref;
+                if (ui_appointments_on_date(state, appointments, state->selected_date, state->cursor_y / 2,
+                                            &ref, 1) == 0 || ref.calendar != 0) {
+                    return -1;
                 }
+                return ref.index;
             }
-            break;
             
         case VIEW_TODO:
-            if (state->cursor_y + state->todo_scroll < todos->count) {
-                // If space was pressed, just toggle completion
-                if (g_last_key_pressed == KEY_SPACE) {
-                    toggle_todo_completion(todos, state->cursor_y + state->todo_scroll);
-                } else {
-                    // Otherwise, open edit dialog
-                    edit_todo_interactive(todos, state->cursor_y + state->todo_scroll);
-                }
-            }
+            // Row in the filtered view, mapped back to the list
+            return ui_todo_index(state, todos, state->cursor_y + state->todo_scroll);
+            
+        default:
             break;
     }
+    
+    return -1;
+}
+
+void delete_selection(UIState *state, AppointmentList *appointments, TodoList *todos) {
+    int index = get_selected_index(state, appointments, todos);
+    if (index < 0) return;
+    
+    if (state->selected_view == VIEW_APPOINTMENTS) {
+        delete_appointment(appointments, index);
+        clamp_appointment_selection(state, appointments);
+        mark_dirty(state, DIRTY_APPOINTMENTS | DIRTY_CALENDAR);
+    } else if (state->selected_view == VIEW_TODO) {
+        delete_todo(todos, index);
+        // Pull the selection and scroll back inside the shorter list
+        clamp_todo_selection(state, todos);
+        mark_dirty(state, DIRTY_TODO | DIRTY_CALENDAR);    // Due-date markers may change
+    }
+}
+
+void toggle_selected_todo(UIState *state, TodoList *todos) {
+    if (state->selected_view != VIEW_TODO) return;
+    
+    int index = ui_todo_index(state, todos, state->cursor_y + state->todo_scroll);
+    if (index < 0) return;
+    
+    // The item moves to its new place in the order (or out of the overdue
+    // view), so the whole list repaints along with the due-date markers
+    toggle_todo_completion(todos, index);
+    clamp_todo_selection(state, todos);
+    mark_dirty(state, DIRTY_TODO | DIRTY_CALENDAR);
 }
\ No newline at end of file
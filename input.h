@@ -5,20 +5,6 @@
 #include "appointments.h"
 #include "todo.h"
 
-// Key codes
-#define KEY_UP      (72 + 256)
-#define KEY_DOWN    (80 + 256)
-#define KEY_LEFT    (75 + 256)
-#define KEY_RIGHT   (77 + 256)
-#define KEY_PGUP    (73 + 256)
-#define KEY_PGDN    (81 + 256)
-#define KEY_HOME    (71 + 256)
-#define KEY_END     (79 + 256)
-#define KEY_TAB     9
-#define KEY_ENTER   13
-#define KEY_ESC     27
-#define KEY_SPACE   32
-
 // Input actions
 typedef enum {
     ACTION_NONE,
@@ -28,15 +14,45 @@ typedef enum {
     ACTION_ADD_TODO,
     ACTION_DELETE,
     ACTION_EDIT,
+    ACTION_TOGGLE,
     ACTION_HELP
 } InputAction;
 
-// Input handling functions
-InputAction process_input(int key, UIState *state, AppointmentList *appointments, TodoList *todos);
-void navigate_calendar(int key, UIState *state);
-void navigate_appointments(int key, UIState *state, AppointmentList *appointments);
-void navigate_todos(int key, UIState *state, TodoList *todos);
-void delete_selected_item(UIState *state, AppointmentList *appointments, TodoList *todos);
-void edit_selected_item(UIState *state, AppointmentList *appointments, TodoList *todos);
+// Distinct key runs buffered between two frames
+#define KEY_QUEUE_SIZE 64
+
+// A key and how many times in a row it was pressed
+typedef struct {
+    int key;
+    int count;
+} KeyEvent;
+
+// Keys read since the last frame; runs of the same navigation key share one entry
+typedef struct {
+    KeyEvent events[KEY_QUEUE_SIZE];
+    int head;
+    int count;
+} KeyQueue;
+
+// Key queue
+int is_navigation_key(int key);
+void key_queue_clear(KeyQueue *queue);
+int key_queue_push(KeyQueue *queue, int key);
+int key_queue_pop(KeyQueue *queue, KeyEvent *event);
+
+// Input handling functions (count > 1 applies a run of the same navigation key)
+InputAction process_input(int key, int count, UIState *state, AppointmentList *appointments, TodoList *todos);
+void navigate_calendar(int key, int count, UIState *state);
+void navigate_appointments(int key, int count, UIState *state, AppointmentList *appointments);
+void navigate_todos(int key, int count, UIState *state, TodoList *todos);
+void clamp_appointment_selection(UIState *state, AppointmentList *appointments);
+void clamp_todo_selection(UIState *state, TodoList *todos);
+
+// Selection helpers; the index is into the appointment or todo list of the
+// current view, -1 when nothing is selected (or the selected appointment
+// belongs to a read-only calendar)
+int get_selected_index(UIState *state, AppointmentList *appointments, TodoList *todos);
+void delete_selection(UIState *state, AppointmentList *appointments, TodoList *todos);
+void toggle_selected_todo(UIState *state, TodoList *todos);
 
 #endif // INPUT_H
\ No newline at end of file
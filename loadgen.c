@@ -0,0 +1,289 @@
+// Load generator for `wcal --serve`.
+//
+// Opens N client connections, each on its own thread, and drives them in a
+// closed loop: send a request, read the whole response, send the next. The
+// mix is 70% RANGE over one to seven days, 20% FREEBUSY over one day and 10%
+// SEARCH, with start dates spread over a year from --from. Latency is
+// measured per request from send to the last response byte.
+//
+// Usage: wcal_loadgen [--socket PATH] [--clients N] [--requests N] [--from YYYY-MM-DD]
+//
+// --requests is per client. POSIX only, like the server.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define DEFAULT_SOCKET      "wcal.sock"
+#define DEFAULT_CLIENTS     8
+#define DEFAULT_REQUESTS    10000
+#define SPREAD_DAYS         365
+#define READ_BUFFER         65536
+
+typedef enum {
+    REQUEST_RANGE,
+    REQUEST_FREEBUSY,
+    REQUEST_SEARCH,
+    REQUEST_TYPES
+} RequestType;
+
+static const char *g_type_names[] = {"RANGE", "FREEBUSY", "SEARCH"};
+
+// Words the synthetic data sets use, so searches find something
+static const char *g_search_words[] = {"meeting", "review", "task", "call", "lunch", "zzz"};
+
+typedef struct {
+    int id;
+    int requests;
+    double *latencies[REQUEST_TYPES];   // Microseconds
+    int counts[REQUEST_TYPES];
+    long long result_lines;
+    int errors;
+} Worker;
+
+static const char *g_socket_path = DEFAULT_SOCKET;
+static int g_from_year = 2024, g_from_month = 1, g_from_day = 1;
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int connect_server(void) {
+    struct sockaddr_un address;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (fd < 0) return -1;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, g_socket_path, sizeof(address.sun_path) - 1);
+
+    if (connect(fd, (struct sockaddr*)&address, sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Day offset from --from to a calendar date, via mktime's normalisation
+static void offset_date(int offset, int *year, int *month, int *day) {
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    tm.tm_year = g_from_year - 1900;
+    tm.tm_mon = g_from_month - 1;
+    tm.tm_mday = g_from_day + offset;
+    tm.tm_hour = 12;
+    mktime(&tm);
+    *year = tm.tm_year + 1900;
+    *month = tm.tm_mon + 1;
+    *day = tm.tm_mday;
+}
+
+static int build_request(RequestType type, unsigned *seed, char *line, size_t size) {
+    int y1, m1, d1, y2, m2, d2;
+    int start = rand_r(seed) % SPREAD_DAYS;
+
+    switch (type) {
+        case REQUEST_RANGE:
+            offset_date(start, &y1, &m1, &d1);
+            offset_date(start + rand_r(seed) % 7, &y2, &m2, &d2);
+            return snprintf(line, size, "RANGE %04d-%02d-%02d %04d-%02d-%02d\n", y1, m1, d1, y2, m2, d2);
+        case REQUEST_FREEBUSY:
+            offset_date(start, &y1, &m1, &d1);
+            return snprintf(line, size, "FREEBUSY %04d-%02d-%02d %04d-%02d-%02d\n", y1, m1, d1, y1, m1, d1);
+        default:
+            return snprintf(line, size, "SEARCH %s\n",
+                            g_search_words[rand_r(seed) % (sizeof(g_search_words) / sizeof(g_search_words[0]))]);
+    }
+}
+
+// Read one full response; returns its result count, or -1 on error
+static int read_response(int fd, char *buffer) {
+    int length = 0;
+    int expected = -1;
+    int lines = 0;
+    int scanned = 0;
+
+    for (;;) {
+        ssize_t received = read(fd, buffer + length, READ_BUFFER - length);
+        if (received <= 0) return -1;
+        length += (int)received;
+
+        for (; scanned < length; scanned++) {
+            if (buffer[scanned] != '\n') continue;
+
+            if (expected < 0) {
+                if (strncmp(buffer, "OK ", 3) != 0) return -1;
+                expected = atoi(buffer + 3);
+            } else {
+                lines++;
+            }
+            if (lines == expected) return expected;
+        }
+
+        // Keep only the unfinished line once the header has been seen
+        if (expected >= 0) {
+            int tail = length;
+            while (tail > 0 && buffer[tail - 1] != '\n') tail--;
+            memmove(buffer, buffer + tail, length - tail);
+            length -= tail;
+            scanned = length;
+        } else if (length == READ_BUFFER) {
+            return -1;
+        }
+    }
+}
+
+static void *run_worker(void *argument) {
+    Worker *worker = (Worker*)argument;
+    unsigned seed = 0x9e3779b9u * (worker->id + 1);
+    char *buffer = (char*)malloc(READ_BUFFER);
+    char line[128];
+
+    int fd = connect_server();
+    if (fd < 0 || !buffer) {
+        worker->errors = worker->requests;
+        free(buffer);
+        if (fd >= 0) close(fd);
+        return NULL;
+    }
+
+    for (int i = 0; i < worker->requests; i++) {
+        int pick = rand_r(&seed) % 10;
+        RequestType type = pick < 7 ? REQUEST_RANGE : pick < 9 ? REQUEST_FREEBUSY : REQUEST_SEARCH;
+        int length = build_request(type, &seed, line, sizeof(line));
+
+        double start = now_us();
+        if (write(fd, line, length) != length) {
+            worker->errors++;
+            break;
+        }
+        int results = read_response(fd, buffer);
+        double elapsed = now_us() - start;
+
+        if (results < 0) {
+            worker->errors++;
+            break;
+        }
+        worker->latencies[type][worker->counts[type]++] = elapsed;
+        worker->result_lines += results;
+    }
+
+    close(fd);
+    free(buffer);
+    return NULL;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static void print_row(const char *name, double *latencies, int count, double seconds) {
+    if (count == 0) return;
+    qsort(latencies, count, sizeof(double), compare_doubles);
+    printf("%-10s %10d %12.0f %10.1f %10.1f %10.1f\n", name, count, count / seconds,
+           latencies[count / 2], latencies[(int)(count * 0.99)], latencies[count - 1]);
+}
+
+int main(int argc, char *argv[]) {
+    int client_count = DEFAULT_CLIENTS;
+    int requests = DEFAULT_REQUESTS;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+            g_socket_path = argv[++i];
+        } else if (strcmp(argv[i], "--clients") == 0 && i + 1 < argc) {
+            client_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--requests") == 0 && i + 1 < argc) {
+            requests = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--from") == 0 && i + 1 < argc &&
+                   sscanf(argv[i + 1], "%d-%d-%d", &g_from_year, &g_from_month, &g_from_day) == 3) {
+            i++;
+        } else {
+            fprintf(stderr, "Usage: %s [--socket PATH] [--clients N] [--requests N] [--from YYYY-MM-DD]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (client_count < 1 || requests < 1) {
+        fprintf(stderr, "--clients and --requests must be positive\n");
+        return 1;
+    }
+
+    int probe = connect_server();
+    if (probe < 0) {
+        fprintf(stderr, "Cannot connect to %s: %s\n", g_socket_path, strerror(errno));
+        return 1;
+    }
+    close(probe);
+
+    Worker *workers = (Worker*)calloc(client_count, sizeof(Worker));
+    pthread_t *threads = (pthread_t*)calloc(client_count, sizeof(pthread_t));
+    if (!workers || !threads) return 1;
+
+    for (int i = 0; i < client_count; i++) {
+        workers[i].id = i;
+        workers[i].requests = requests;
+        for (int t = 0; t < REQUEST_TYPES; t++) {
+            workers[i].latencies[t] = (double*)malloc(sizeof(double) * requests);
+            if (!workers[i].latencies[t]) return 1;
+        }
+    }
+
+    double start = now_us();
+    for (int i = 0; i < client_count; i++) {
+        pthread_create(&threads[i], NULL, run_worker, &workers[i]);
+    }
+    for (int i = 0; i < client_count; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    double seconds = (now_us() - start) / 1e6;
+
+    // Merge every worker's samples per type and overall
+    int total = 0;
+    int errors = 0;
+    long long result_lines = 0;
+    for (int i = 0; i < client_count; i++) {
+        for (int t = 0; t < REQUEST_TYPES; t++) total += workers[i].counts[t];
+        errors += workers[i].errors;
+        result_lines += workers[i].result_lines;
+    }
+
+    double *all = (double*)malloc(sizeof(double) * (total ? total : 1));
+    int all_count = 0;
+
+    printf("%d clients, %d requests each, %.2f s, %lld result lines, %d errors\n\n",
+           client_count, requests, seconds, result_lines, errors);
+    printf("%-10s %10s %12s %10s %10s %10s\n", "request", "count", "req/s", "p50 us", "p99 us", "max us");
+
+    for (int t = 0; t < REQUEST_TYPES; t++) {
+        int count = 0;
+        for (int i = 0; i < client_count; i++) count += workers[i].counts[t];
+
+        double *merged = (double*)malloc(sizeof(double) * (count ? count : 1));
+        int filled = 0;
+        for (int i = 0; i < client_count; i++) {
+            memcpy(merged + filled, workers[i].latencies[t], sizeof(double) * workers[i].counts[t]);
+            filled += workers[i].counts[t];
+        }
+        memcpy(all + all_count, merged, sizeof(double) * count);
+        all_count += count;
+        print_row(g_type_names[t], merged, count, seconds);
+        free(merged);
+    }
+    print_row("all", all, all_count, seconds);
+
+    free(all);
+    for (int i = 0; i < client_count; i++) {
+        for (int t = 0; t < REQUEST_TYPES; t++) free(workers[i].latencies[t]);
+    }
+    free(workers);
+    free(threads);
+    return errors ? 1 : 0;
+}
\ No newline at end of file
@@ -1,20 +1,39 @@
-#include <windows.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <conio.h>
 #include <time.h>
 #include <string.h>
+#include "compat.h"
 #include "ui.h"
 #include "calendar.h"
 #include "appointments.h"
 #include "todo.h"
 #include "input.h"
 #include "storage.h"
+#include "reminder.h"
+#include "batch.h"
+#include "query.h"
+#include "server.h"
+#include "dialog.h"
+#include "watch.h"
+#include "trace.h"
+#include "wmem.h"
+
+// Edits are saved in the background once no key has come for this long
+#define AUTOSAVE_IDLE_MS 5000
 
 // Global state
 UIState g_ui_state;
 AppointmentList g_appointments;
 TodoList g_todos;
+ReminderWheel g_reminders;
+CalendarSet g_calendars;
+Dialog g_dialog;
+FileWatcher g_watcher;
+unsigned int g_pending_reloads;     // Calendars whose files changed, one bit each
+int g_damage_reported;
+unsigned long long g_saved_generation;      // g_appointments' generation as of the last save started
+unsigned int g_saved_version;               // g_todos' version, likewise
+int g_autosaving;                           // A background save is running
 
 void initialize_app(void) {
     // Initialize console
@@ -26,28 +45,55 @@ void initialize_app(void) {
     g_ui_state.cursor_y = 0;
     
     // Get current date
-    time_t t = time(NULL);
-    struct tm tm_storage;
-    struct tm *tm = &tm_storage;
-    localtime_s(tm, &t);
-    g_ui_state.current_date.year = tm->tm_year + 1900;
-    g_ui_state.current_date.month = tm->tm_mon + 1;
-    g_ui_state.current_date.day = tm->tm_mday;
+    get_today(&g_ui_state.current_date);
     g_ui_state.selected_date = g_ui_state.current_date;
+    update_console_size(&g_ui_state);
+    mark_dirty(&g_ui_state, DIRTY_ALL);
     
     // Initialize data structures
     init_appointments(&g_appointments);
     init_todos(&g_todos);
     
     // Load saved data from ZIP archive
-    load_data_from_zip(&g_appointments, &g_todos);
+    calset_load_main(&g_calendars, &g_todos);
+    
+    // Watch the files behind the calendars; edits made by other programs
+    // are merged in while wcal runs, so saving on exit keeps them
+    watcher_init(&g_watcher);
+    for (int i = 0; i < g_calendars.count; i++) {
+        if (g_calendars.calendars[i].source.path[0]) {
+            watcher_add(&g_watcher, g_calendars.calendars[i].source.path, i);
+        }
+    }
+    term_watch_handles(g_watcher.handles, g_watcher.handle_count);
+    
+    // Schedule reminders from now on; edits keep the wheel up to date
+    DateTime now;
+    get_now(&now);
+    reminder_init(&g_reminders, datetime_to_minutes(now));
+    reminder_attach(&g_reminders, &g_appointments);
+    
+    // What was just loaded needs no saving
+    g_saved_generation = g_appointments.generation;
+    g_saved_version = g_todos.version;
 }
 
 void cleanup_app(void) {
     // Save data to ZIP archive
     save_data_to_zip(&g_appointments, &g_todos);
     
+    // --mem-report describes the footprint with everything still loaded
+    if (g_mem_report) {
+        size_t used[MEM_SUBSYSTEM_COUNT];
+        calset_measure(&g_calendars, &g_todos, used);
+        wmem_report_checkpoint(used);
+    }
+    
     // Clean up memory
+    watcher_close(&g_watcher);
+    calset_free(&g_calendars);
+    g_appointments.reminders = NULL;
+    reminder_free(&g_reminders);
     free_appointments(&g_appointments);
     free_todos(&g_todos);
     
@@ -55,31 +101,258 @@ void cleanup_app(void) {
     restore_console();
 }
 
+// Follow the date across midnight: yesterday's due todos just became overdue
+static void refresh_current_date(void) {
+    Date today;
+    get_today(&today);
+    
+    if (compare_dates(today, g_ui_state.current_date) == 0) {
+        return;
+    }
+    
+    g_ui_state.current_date = today;
+    clamp_todo_selection(&g_ui_state, &g_todos);
+    mark_dirty(&g_ui_state, DIRTY_CALENDAR | DIRTY_TODO);
+}
+
+// Fire reminders that have come due: the newest goes on the status bar
+// and each one runs the reminder command
+static void check_reminders(void) {
+    int fired[MAX_FIRED_REMINDERS];
+    int count;
+    DateTime now;
+    
+    get_now(&now);
+    while ((count = reminder_advance(&g_reminders, &g_appointments, datetime_to_minutes(now),
+                                     fired, MAX_FIRED_REMINDERS)) > 0) {
+        for (int i = 0; i < count; i++) {
+            Appointment *app = &g_appointments.items[fired[i]];
+            reminder_describe(&g_reminders, app, g_ui_state.status_message, sizeof(g_ui_state.status_message));
+            reminder_run_command(app);
+        }
+        mark_dirty(&g_ui_state, DIRTY_STATUS);
+    }
+}
+
+// Anything reaching a cold year or firing a reminder also counts, which
+// costs at most one save that finds no shard to rewrite
+static int has_unsaved_changes(void) {
+    return g_appointments.generation != g_saved_generation || g_todos.version != g_saved_version;
+}
+
+static void report_save_failure(void) {
+    sprintf_s(g_ui_state.status_message, sizeof(g_ui_state.status_message),
+              "Saving to %s failed; it is tried again on exit", ARCHIVE_NAME);
+    mark_dirty(&g_ui_state, DIRTY_STATUS);
+}
+
+// Take a finished background save in; only a failure is worth a word
+static void finish_autosave(int wait) {
+    SaveState state = calset_save_state(&g_calendars, wait);
+    
+    g_autosaving = state == SAVE_RUNNING;
+    if (state == SAVE_FAILED) {
+        report_save_failure();
+    }
+}
+
+// Save what changed, on a thread of its own and from snapshots of the
+// lists, so editing goes on meanwhile. Waits while a dialog is open, since
+// a cold year read in first would move the index it holds.
+static void start_autosave(void) {
+    if (g_autosaving || dialog_is_open(&g_dialog) || !has_unsaved_changes()) return;
+    
+    int count = g_appointments.count;
+    g_autosaving = calset_save_main_in_background(&g_calendars, &g_todos);
+    if (g_autosaving) {
+        g_saved_generation = g_appointments.generation;
+        g_saved_version = g_todos.version;
+    } else {
+        // The edits stay unsaved, so the next idle pass tries again
+        report_save_failure();
+    }
+    
+    if (g_appointments.count != count) {
+        clamp_appointment_selection(&g_ui_state, &g_appointments);
+        mark_dirty(&g_ui_state, DIRTY_ALL);
+    }
+}
+
+// Sleep until the earliest of midnight, the next reminder and, with edits
+// unsaved, the autosave
+static int next_timeout_ms(void) {
+    int timeout = get_ms_until_midnight();
+    int reminder = reminder_timeout_ms(&g_reminders);
+    
+    if (reminder >= 0 && reminder < timeout) timeout = reminder;
+    if (has_unsaved_changes() && AUTOSAVE_IDLE_MS < timeout) timeout = AUTOSAVE_IDLE_MS;
+    return timeout;
+}
+
+// Note which calendars' files changed; they are reloaded by reload_calendars
+static void collect_file_changes(void) {
+    int ids[MAX_WATCHED_FILES];
+    int count = watcher_poll(&g_watcher, ids, MAX_WATCHED_FILES);
+    
+    for (int i = 0; i < count; i++) {
+        g_pending_reloads |= 1u << ids[i];
+    }
+}
+
+// Merge what changed on disk into the calendars. Waits while a dialog is
+// open, since an edit or delete there holds an index into the list.
+static void reload_calendars(void) {
+    if (!g_pending_reloads || dialog_is_open(&g_dialog)) return;
+    
+    // A background save may be writing the archive: the reload must see it
+    // as wcal's own, not someone else's change
+    if ((g_pending_reloads & 1) && g_autosaving) finish_autosave(1);
+    
+    for (int i = 0; i < g_calendars.count; i++) {
+        SyncStats stats;
+        
+        // A file that can't be read now is mid-write; its next change is reported again
+        if (!(g_pending_reloads & (1u << i)) || calset_reload(&g_calendars, i, &stats) <= 0) continue;
+        if (!stats.added && !stats.changed && !stats.removed && !stats.todos_reloaded) continue;
+        
+        sprintf_s(g_ui_state.status_message, sizeof(g_ui_state.status_message),
+                  "Reloaded %s: %d added, %d changed, %d removed%s", g_calendars.calendars[i].name,
+                  stats.added, stats.changed, stats.removed, stats.todos_reloaded ? ", todos replaced" : "");
+    }
+    g_pending_reloads = 0;
+    
+    clamp_appointment_selection(&g_ui_state, &g_appointments);
+    clamp_todo_selection(&g_ui_state, &g_todos);
+    mark_dirty(&g_ui_state, DIRTY_ALL);
+}
+
+// Navigating into a cold year reads it from the archive. Waits while a
+// dialog is open, like reload_calendars.
+static void reach_selected_year(void) {
+    int year = g_ui_state.selected_date.year;
+    
+    if (dialog_is_open(&g_dialog) || storage_reach(&g_appointments, year, year) <= 0) return;
+    
+    clamp_appointment_selection(&g_ui_state, &g_appointments);
+    mark_dirty(&g_ui_state, DIRTY_ALL);
+}
+
+// Once, whether the damage showed up on load, on a reload or in a cold year
+static void report_damage(void) {
+    if (g_damage_reported || !storage_damaged()) return;
+    
+    sprintf_s(g_ui_state.status_message, sizeof(g_ui_state.status_message),
+              "%s is damaged; saving keeps a copy as %s (wcal --verify for details)", ARCHIVE_NAME, DAMAGED_ARCHIVE_NAME);
+    mark_dirty(&g_ui_state, DIRTY_STATUS);
+    g_damage_reported = 1;
+}
+
+static void handle_resize(void) {
+    update_console_size(&g_ui_state);
+    // Page sizes changed; keep the selection inside the visible window
+    if (g_ui_state.selected_view == VIEW_APPOINTMENTS) {
+        clamp_appointment_selection(&g_ui_state, &g_appointments);
+    } else if (g_ui_state.selected_view == VIEW_TODO) {
+        clamp_todo_selection(&g_ui_state, &g_todos);
+    }
+    mark_dirty(&g_ui_state, DIRTY_ALL);
+}
+
+// Queue the key just read plus everything already waiting behind it, so a
+// held arrow key is applied as one move and one frame instead of a backlog.
+// Draining stops after any key that is not plain navigation: it may open a
+// dialog, and whatever was typed after it belongs to that dialog. An open
+// dialog takes its keys one at a time, so nothing is drained for it.
+static void collect_keys(KeyQueue *queue, int first_key) {
+    key_queue_push(queue, first_key);
+    
+    while (is_navigation_key(first_key) && !dialog_is_open(&g_dialog) && queue->count < KEY_QUEUE_SIZE) {
+        TermEvent event;
+        term_wait_event(0, &event);
+        
+        if (event.type == TERM_EVENT_TIMEOUT || event.type == TERM_EVENT_WATCH) break;
+        if (event.type == TERM_EVENT_RESIZE) {
+            handle_resize();
+            continue;
+        }
+        if (event.key == KEY_IGNORED) continue;
+        
+        key_queue_push(queue, event.key);
+        if (!is_navigation_key(event.key)) break;
+    }
+}
+
 void main_loop(void) {
     int running = 1;
-    int needs_redraw = 1;
+    KeyQueue queue;
+    
+    key_queue_clear(&queue);
     
     while (running) {
-        // Update console size
-        update_console_size(&g_ui_state);
+        finish_autosave(0);
+        reload_calendars();
+        reach_selected_year();
+        report_damage();
+        refresh_current_date();
+        check_reminders();
+        
+        // Redraw whatever the last events marked dirty, with an open dialog on top
+        if (ui_needs_redraw(&g_ui_state) || dialog_is_open(&g_dialog)) {
+            unsigned long long span = trace_begin();
+            compose_ui(&g_ui_state, &g_appointments, &g_todos);
+            dialog_draw(&g_dialog, &g_ui_state);
+            fb_flush();
+            trace_end(TRACE_FRAME, span);
+        }
         
-        // Redraw if needed
-        if (needs_redraw) {
-            draw_ui(&g_ui_state, &g_appointments, &g_todos);
-            needs_redraw = 0;
+        // Sleep until a key, a resize, a file change or the next deadline (reminder or midnight rollover)
+        TermEvent event;
+        term_wait_event(next_timeout_ms(), &event);
+        
+        switch (event.type) {
+            case TERM_EVENT_TIMEOUT:
+                // No key since the last pass: a good time to save
+                start_autosave();
+                continue;
+                
+            case TERM_EVENT_RESIZE:
+                handle_resize();
+                continue;
+                
+            case TERM_EVENT_WATCH:
+                collect_file_changes();
+                continue;
+                
+            case TERM_EVENT_KEY:
+                if (event.key == KEY_IGNORED) continue;
+                break;
+        }
+        
+        // A key acknowledges the reminder or reload note on the status bar
+        if (g_ui_state.status_message[0]) {
+            g_ui_state.status_message[0] = '\0';
+            mark_dirty(&g_ui_state, DIRTY_STATUS);
         }
         
-        // Handle input
-        if (_kbhit()) {
-            int key = _getch();
+        collect_keys(&queue, event.key);
+        
+        // Apply every queued key before the next frame
+        KeyEvent key_event;
+        while (running && key_queue_pop(&queue, &key_event)) {
+            // Input closed - quit and save
+            if (key_event.key == KEY_NONE) {
+                running = 0;
+                break;
+            }
             
-            // Special keys (arrows, function keys) send two bytes
-            if (key == 0 || key == 224) {
-                key = _getch();
-                key += 256; // Offset special keys
+            // An open dialog takes every key until it closes
+            if (dialog_is_open(&g_dialog)) {
+                dialog_handle_key(&g_dialog, key_event.key, &g_ui_state, &g_appointments, &g_todos);
+                continue;
             }
             
-            InputAction action = process_input(key, &g_ui_state, &g_appointments, &g_todos);
+            InputAction action = process_input(key_event.key, key_event.count,
+                                               &g_ui_state, &g_appointments, &g_todos);
             
             switch (action) {
                 case ACTION_QUIT:
@@ -87,32 +360,33 @@ void main_loop(void) {
                     break;
                     
                 case ACTION_REDRAW:
-                    needs_redraw = 1;
+                    // process_input already marked what changed
                     break;
                     
                 case ACTION_ADD_APPOINTMENT:
-                    add_appointment_interactive(&g_appointments, (struct UIState*)&g_ui_state);
-                    needs_redraw = 1;
+                    dialog_open(&g_dialog, DIALOG_ADD_APPOINTMENT, &g_ui_state, &g_appointments, &g_todos);
                     break;
                     
                 case ACTION_ADD_TODO:
-                    add_todo_interactive(&g_todos);
-                    needs_redraw = 1;
+                    dialog_open(&g_dialog, DIALOG_ADD_TODO, &g_ui_state, &g_appointments, &g_todos);
                     break;
                     
                 case ACTION_DELETE:
-                    delete_selected_item(&g_ui_state, &g_appointments, &g_todos);
-                    needs_redraw = 1;
+                    dialog_open(&g_dialog, DIALOG_CONFIRM_DELETE, &g_ui_state, &g_appointments, &g_todos);
                     break;
                     
                 case ACTION_EDIT:
-                    edit_selected_item(&g_ui_state, &g_appointments, &g_todos);
-                    needs_redraw = 1;
+                    dialog_open(&g_dialog,
+                                g_ui_state.selected_view == VIEW_TODO ? DIALOG_EDIT_TODO : DIALOG_EDIT_APPOINTMENT,
+                                &g_ui_state, &g_appointments, &g_todos);
+                    break;
+                    
+                case ACTION_TOGGLE:
+                    toggle_selected_todo(&g_ui_state, &g_todos);
                     break;
                     
                 case ACTION_HELP:
-                    draw_help_screen(&g_ui_state);
-                    needs_redraw = 1;
+                    dialog_open(&g_dialog, DIALOG_HELP, &g_ui_state, &g_appointments, &g_todos);
                     break;
                     
                 case ACTION_NONE:
@@ -120,13 +394,97 @@ void main_loop(void) {
                     break;
             }
         }
+        key_queue_clear(&queue);
+    }
+}
+
+// "work=work.ics", or just "work.ics" to name the calendar after the file
+static int add_calendar_argument(const char *argument) {
+    char name[MAX_CALENDAR_NAME];
+    const char *equals = strchr(argument, '=');
+    const char *path = equals ? equals + 1 : argument;
+    
+    if (equals) {
+        int length = (int)(equals - argument);
+        if (length >= MAX_CALENDAR_NAME) length = MAX_CALENDAR_NAME - 1;
+        memcpy(name, argument, length);
+        name[length] = '\0';
+    } else {
+        const char *base = path;
+        for (const char *p = path; *p; p++) {
+            if (*p == '/' || *p == '\\') base = p + 1;
+        }
+        strcpy_s(name, sizeof(name), base);
+        char *extension = strrchr(name, '.');
+        if (extension && extension != name) *extension = '\0';
+    }
+    
+    if (calset_add_file(&g_calendars, name, path) < 0) {
+        fprintf(stderr, "wcal: cannot load calendar %s\n", path);
+        calset_free(&g_calendars);
+        return 0;
+    }
+    return 1;
+}
+
+// Take "--trace FILE" and "--mem-report" out of the arguments, wherever
+// they are, so they work with every mode. Returns 0 if the trace file
+// can't be created.
+static int take_diagnostic_arguments(int *argc, char *argv[]) {
+    for (int i = 1; i < *argc; i++) {
+        int taken;
+        
+        if (strcmp(argv[i], "--mem-report") == 0) {
+            wmem_enable_report();
+            taken = 1;
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < *argc) {
+            if (!trace_open(argv[i + 1])) {
+                fprintf(stderr, "wcal: cannot write trace file %s\n", argv[i + 1]);
+                return 0;
+            }
+            taken = 2;
+        } else {
+            continue;
+        }
         
-        // Small delay to reduce CPU usage
-        Sleep(50);
+        memmove(&argv[i], &argv[i + taken], (*argc - i - taken + 1) * sizeof(argv[0]));
+        *argc -= taken;
+        i--;
     }
+    return 1;
 }
 
-int main(void) {
+int main(int argc, char *argv[]) {
+    if (!take_diagnostic_arguments(&argc, argv)) return 1;
+    
+    if (argc > 1) {
+        if (strcmp(argv[1], "--batch") == 0) {
+            return run_batch(argc > 2 ? argv[2] : NULL);
+        }
+        // Queries print and exit before anything touches the console
+        if (is_query_command(argv[1])) {
+            return run_query(argc - 1, argv + 1);
+        }
+        if (strcmp(argv[1], "--serve") == 0) {
+            return run_server(argc > 2 ? argv[2] : NULL);
+        }
+        if (strcmp(argv[1], "--verify") == 0) {
+            return storage_verify(argc > 2 ? argv[2] : ARCHIVE_NAME, stdout) == 0 ? 0 : 1;
+        }
+    }
+    
+    // Anything else adds read-only calendars to the interactive views
+    calset_init(&g_calendars, &g_appointments, "main");
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--calendar") != 0 || i + 1 >= argc) {
+            fprintf(stderr, "Usage: %s [--trace out.json] [--mem-report] [--calendar [NAME=]FILE.ics]... | --batch [script|-] | "
+                    "--serve [socket] | --verify [archive] | agenda [options] | todos [options]\n", argv[0]);
+            return 1;
+        }
+        if (!add_calendar_argument(argv[++i])) return 1;
+    }
+    g_ui_state.calendars = &g_calendars;
+    
     initialize_app();
     main_loop();
     cleanup_app();
@@ -0,0 +1,260 @@
+#include "psort.h"
+#include <stdlib.h>
+#include <string.h>
+#include "wmem.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#define MAX_PARTS 16
+#define MIN_PART 65536          // Items a thread must have to earn its start-up
+#define SMALL_SORT 32           // Below this an insertion sort beats the byte passes
+#define RADIX 256
+
+// One thread's share of the work
+typedef struct {
+    PsortWork work;
+    void *context;
+    int part;
+    int first;
+    int end;
+} Range;
+
+static int g_cpus;              // 0 until first asked
+
+static int cpu_count(void) {
+    if (g_cpus) return g_cpus;
+
+    const char *setting = getenv("WCAL_SORT_THREADS");
+    if (setting && atoi(setting) > 0) {
+        g_cpus = atoi(setting);
+    } else {
+#ifdef _WIN32
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        g_cpus = (int)info.dwNumberOfProcessors;
+#else
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        g_cpus = cpus > 0 ? (int)cpus : 1;
+#endif
+    }
+    if (g_cpus < 1) g_cpus = 1;
+    if (g_cpus > MAX_PARTS) g_cpus = MAX_PARTS;
+    return g_cpus;
+}
+
+int psort_parts(int count) {
+    int parts = count / MIN_PART;
+    int cpus = cpu_count();
+
+    if (parts > cpus) parts = cpus;
+    return parts > 1 ? parts : 1;
+}
+
+static void run_range(Range *range) {
+    range->work(range->context, range->part, range->first, range->end);
+}
+
+#ifdef _WIN32
+static DWORD WINAPI thread_main(LPVOID argument) {
+    run_range((Range*)argument);
+    return 0;
+}
+#else
+static void *thread_main(void *argument) {
+    run_range((Range*)argument);
+    return NULL;
+}
+#endif
+
+void psort_for(int count, int parts, PsortWork work, void *context) {
+    Range ranges[MAX_PARTS];
+    int started[MAX_PARTS];
+#ifdef _WIN32
+    HANDLE threads[MAX_PARTS];
+#else
+    pthread_t threads[MAX_PARTS];
+#endif
+
+    if (parts < 1) parts = 1;
+    if (parts > MAX_PARTS) parts = MAX_PARTS;
+
+    for (int i = 0; i < parts; i++) {
+        ranges[i].work = work;
+        ranges[i].context = context;
+        ranges[i].part = i;
+        ranges[i].first = (int)((long long)count * i / parts);
+        ranges[i].end = (int)((long long)count * (i + 1) / parts);
+    }
+
+    for (int i = 1; i < parts; i++) {
+#ifdef _WIN32
+        threads[i] = CreateThread(NULL, 0, thread_main, &ranges[i], 0, NULL);
+        started[i] = threads[i] != NULL;
+#else
+        started[i] = pthread_create(&threads[i], NULL, thread_main, &ranges[i]) == 0;
+#endif
+    }
+
+    // A range whose thread couldn't be started runs here instead
+    run_range(&ranges[0]);
+    for (int i = 1; i < parts; i++) {
+        if (!started[i]) {
+            run_range(&ranges[i]);
+            continue;
+        }
+#ifdef _WIN32
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+#else
+        pthread_join(threads[i], NULL);
+#endif
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Radix sort: each pass counts a byte's digits per range, works out where
+// every (digit, range) run starts, and then each range scatters its own
+// pairs. Runs are laid out digit by digit and, within a digit, range by
+// range, so pairs with equal digits keep their order.
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    SortPair *from;
+    SortPair *to;
+    int shift;
+    int offsets[MAX_PARTS][RADIX];      // Digit counts per range, then where each run goes
+    unsigned long long all_and[MAX_PARTS];
+    unsigned long long all_or[MAX_PARTS];
+    int in_order[MAX_PARTS];
+} RadixSort;
+
+// What every key in a range shares, and whether the range is in order
+// (counting the pair before it)
+static void survey_keys(void *context, int part, int first, int end) {
+    RadixSort *sort = (RadixSort*)context;
+    const SortPair *pairs = sort->from;
+    unsigned long long all_and = ~0ULL;
+    unsigned long long all_or = 0;
+    unsigned long long last = first > 0 ? pairs[first - 1].key : 0;
+    int in_order = 1;
+
+    for (int i = first; i < end; i++) {
+        unsigned long long key = pairs[i].key;
+        all_and &= key;
+        all_or |= key;
+        if (key < last) in_order = 0;
+        last = key;
+    }
+
+    sort->all_and[part] = all_and;
+    sort->all_or[part] = all_or;
+    sort->in_order[part] = in_order;
+}
+
+static void count_digits(void *context, int part, int first, int end) {
+    RadixSort *sort = (RadixSort*)context;
+    int *counts = sort->offsets[part];
+
+    memset(counts, 0, sizeof(sort->offsets[part]));
+    for (int i = first; i < end; i++) counts[(sort->from[i].key >> sort->shift) & (RADIX - 1)]++;
+}
+
+static void scatter(void *context, int part, int first, int end) {
+    RadixSort *sort = (RadixSort*)context;
+    int *offsets = sort->offsets[part];
+
+    for (int i = first; i < end; i++) {
+        sort->to[offsets[(sort->from[i].key >> sort->shift) & (RADIX - 1)]++] = sort->from[i];
+    }
+}
+
+static void copy_back(void *context, int part, int first, int end) {
+    RadixSort *sort = (RadixSort*)context;
+    (void)part;
+    memcpy(sort->to + first, sort->from + first, sizeof(SortPair) * (end - first));
+}
+
+static int insertion_sort(SortPair *pairs, int count) {
+    int moved = 0;
+
+    for (int i = 1; i < count; i++) {
+        SortPair pair = pairs[i];
+        int j = i;
+        while (j > 0 && pairs[j - 1].key > pair.key) {
+            pairs[j] = pairs[j - 1];
+            j--;
+        }
+        if (j != i) {
+            pairs[j] = pair;
+            moved = 1;
+        }
+    }
+    return moved;
+}
+
+int psort_pairs(SortPair *pairs, int count) {
+    if (count < SMALL_SORT) return insertion_sort(pairs, count);
+
+    RadixSort *sort = (RadixSort*)wmem_malloc(MEM_INDEXES, sizeof(RadixSort));
+    SortPair *scratch = (SortPair*)wmem_malloc(MEM_INDEXES, sizeof(SortPair) * count);
+    if (!sort || !scratch) {
+        wmem_free(sort);
+        wmem_free(scratch);
+        return -1;
+    }
+
+    int parts = psort_parts(count);
+    unsigned long long all_and = ~0ULL;
+    unsigned long long all_or = 0;
+    int in_order = 1;
+    int passes = 0;
+
+    sort->from = pairs;
+    psort_for(count, parts, survey_keys, sort);
+    for (int part = 0; part < parts; part++) {
+        all_and &= sort->all_and[part];
+        all_or |= sort->all_or[part];
+        in_order &= sort->in_order[part];
+    }
+
+    // A byte every key has the same value in orders nothing; neither does
+    // any byte once the keys are in order already
+    unsigned long long varies = in_order ? 0 : all_and ^ all_or;
+    sort->to = scratch;
+    for (int shift = 0; shift < 64; shift += 8) {
+        if (!((varies >> shift) & (RADIX - 1))) continue;
+
+        sort->shift = shift;
+        psort_for(count, parts, count_digits, sort);
+
+        int next = 0;
+        for (int digit = 0; digit < RADIX; digit++) {
+            for (int part = 0; part < parts; part++) {
+                int run = sort->offsets[part][digit];
+                sort->offsets[part][digit] = next;
+                next += run;
+            }
+        }
+
+        psort_for(count, parts, scatter, sort);
+        SortPair *swap = sort->from;
+        sort->from = sort->to;
+        sort->to = swap;
+        passes++;
+    }
+
+    // An odd number of passes leaves the result in the scratch array
+    if (sort->from != pairs) {
+        sort->to = pairs;
+        psort_for(count, parts, copy_back, sort);
+    }
+
+    wmem_free(scratch);
+    wmem_free(sort);
+    return passes;
+}
\ No newline at end of file
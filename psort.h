@@ -0,0 +1,33 @@
+#ifndef PSORT_H
+#define PSORT_H
+
+// Sorting for bulk loads. The model's arrays are sorted through compact
+// (key, index) pairs instead of by moving whole records around behind a
+// comparator: the caller packs each record's order into one 64-bit key,
+// sorts the pairs here, then moves every record once, to where its pair
+// ended up. Large arrays are split across threads. The threads only run
+// work handed to them; nothing here allocates off the calling thread, so
+// wmem's single-thread rule holds.
+
+typedef struct {
+    unsigned long long key;
+    int index;                      // Of the record the key was taken from
+} SortPair;
+
+// Stable, so pairs with equal keys keep their order: an LSD radix sort a
+// byte at a time, skipping bytes every key shares. Returns the number of
+// byte passes made, 0 when the pairs were already in order; -1 when out of
+// memory, leaving them as they were.
+int psort_pairs(SortPair *pairs, int count);
+
+// Ranges to split count items into: one per thread, as many as pay for
+// themselves, at most one per CPU (WCAL_SORT_THREADS overrides)
+int psort_parts(int count);
+
+// Run work over [0, count) split into parts ranges, the first on this
+// thread and the rest on threads of their own; returns when all are done.
+// Range part is [count * part / parts, count * (part + 1) / parts).
+typedef void (*PsortWork)(void *context, int part, int first, int end);
+void psort_for(int count, int parts, PsortWork work, void *context);
+
+#endif // PSORT_H
\ No newline at end of file
@@ -0,0 +1,258 @@
+#include "query.h"
+#include "calendar.h"
+#include "appointments.h"
+#include "todo.h"
+#include "storage.h"
+#include "wmem.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "compat.h"
+
+// Appointments fetched per search while walking a day
+#define QUERY_BATCH 256
+
+typedef enum {
+    FORMAT_TEXT,
+    FORMAT_JSON,
+    FORMAT_ICS
+} QueryFormat;
+
+typedef struct {
+    Date from, to;
+    QueryFormat format;
+    int pending_only;
+} QueryOptions;
+
+static const char *g_priority_names[] = {"normal", "high", "urgent"};
+
+static void print_json_string(const char *text) {
+    putchar('"');
+    for (const unsigned char *p = (const unsigned char*)text; *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            printf("\\%c", *p);
+        } else if (*p < 0x20) {
+            printf("\\u%04x", *p);
+        } else {
+            putchar(*p);
+        }
+    }
+    putchar('"');
+}
+
+static void print_agenda_line(const Appointment *app, Date day) {
+    DateTime end = get_appointment_end(app);
+    Date start_day = {app->date_time.year, app->date_time.month, app->date_time.day};
+    Date end_day = {end.year, end.month, end.day};
+
+    // Parts of a multi-day appointment that fall outside this day show as ..:..
+    printf("  ");
+    if (compare_dates(start_day, day) < 0) {
+        printf("..:..");
+    } else {
+        printf("%02d:%02d", app->date_time.hour, app->date_time.minute);
+    }
+    if (compare_dates(end_day, day) > 0) {
+        printf("-..:..");
+    } else if (app->duration_minutes > 0) {
+        printf("-%02d:%02d", end.hour, end.minute);
+    } else {
+        printf("      ");
+    }
+    printf("  %s\n", app->description);
+}
+
+static void print_agenda_json(const Appointment *app, int first) {
+    DateTime start = app->date_time;
+    DateTime end = get_appointment_end(app);
+
+    printf("%s\n  {\"start\": \"%04d-%02d-%02dT%02d:%02d\", \"end\": \"%04d-%02d-%02dT%02d:%02d\", "
+           "\"duration_minutes\": %d, \"description\": ",
+           first ? "" : ",",
+           start.year, start.month, start.day, start.hour, start.minute,
+           end.year, end.month, end.day, end.hour, end.minute, app->duration_minutes);
+    print_json_string(app->description);
+    printf("}");
+}
+
+static void run_agenda(AppointmentList *appointments, const QueryOptions *options) {
+    int indices[QUERY_BATCH];
+    int printed = 0;
+
+    if (options->format == FORMAT_ICS) write_ics_header(stdout);
+    if (options->format == FORMAT_JSON) printf("[");
+
+    // Each day is a binary search into the sorted list, so the cost follows
+    // the size of the range, not the size of the calendar
+    for (Date day = options->from; compare_dates(day, options->to) <= 0; add_days_to_date(&day, 1)) {
+        int first = 0;
+        int found;
+        int header = 0;
+
+        do {
+            found = find_appointments_by_date_window(appointments, day, first, indices, QUERY_BATCH);
+            first += found;
+
+            for (int i = 0; i < found; i++) {
+                Appointment *app = &appointments->items[indices[i]];
+                Date start_day = {app->date_time.year, app->date_time.month, app->date_time.day};
+
+                if (options->format == FORMAT_TEXT) {
+                    if (!header) {
+                        printf("%s%04d-%02d-%02d %s\n", printed ? "\n" : "", day.year, day.month, day.day,
+                               get_day_name(get_day_of_week(day.year, day.month, day.day)));
+                        header = 1;
+                    }
+                    print_agenda_line(app, day);
+                    printed++;
+                    continue;
+                }
+
+                // ICS and JSON list each appointment once, on its first day in the range
+                if (compare_dates(start_day, day) != 0 && compare_dates(day, options->from) != 0) continue;
+
+                if (options->format == FORMAT_ICS) {
+                    write_ics_event(stdout, app);
+                } else {
+                    print_agenda_json(app, printed == 0);
+                }
+                printed++;
+            }
+        } while (found == QUERY_BATCH);
+    }
+
+    if (options->format == FORMAT_ICS) write_ics_footer(stdout);
+    if (options->format == FORMAT_JSON) printf("%s]\n", printed ? "\n" : "");
+}
+
+// Todos are printed through todo_walk, in one pass over the tree
+typedef struct {
+    const QueryOptions *options;
+    int printed;
+} TodoPrint;
+
+static int print_todo(void *context, TodoItem *todo) {
+    TodoPrint *print = (TodoPrint*)context;
+    int priority = todo->priority >= 0 && todo->priority <= 2 ? todo->priority : 0;
+    char due[16] = "";
+
+    // Completed todos sort after every open one
+    if (print->options->pending_only && todo->completed) return 0;
+
+    if (todo->due.year) {
+        sprintf_s(due, sizeof(due), "%04d-%02d-%02d", todo->due.year, todo->due.month, todo->due.day);
+    }
+
+    if (print->options->format == FORMAT_TEXT) {
+        printf("[%c] %-6s %-10s %s\n", todo->completed ? 'X' : ' ', g_priority_names[priority], due,
+               todo->description);
+    } else {
+        printf("%s\n  {\"description\": ", print->printed ? "," : "");
+        print_json_string(todo->description);
+        printf(", \"priority\": \"%s\", \"completed\": %s, \"due\": ", g_priority_names[priority],
+               todo->completed ? "true" : "false");
+        if (due[0]) {
+            printf("\"%s\"}", due);
+        } else {
+            printf("null}");
+        }
+    }
+    print->printed++;
+    return 1;
+}
+
+static void run_todos(TodoList *todos, const QueryOptions *options) {
+    TodoPrint print = {options, 0};
+
+    if (options->format == FORMAT_JSON) printf("[");
+    todo_walk(todos, 0, print_todo, &print);
+    if (options->format == FORMAT_JSON) printf("%s]\n", print.printed ? "\n" : "");
+}
+
+int is_query_command(const char *name) {
+    return strcmp(name, "agenda") == 0 || strcmp(name, "todos") == 0;
+}
+
+int run_query(int argc, char *argv[]) {
+    int agenda = strcmp(argv[0], "agenda") == 0;
+    int have_to = 0;
+    QueryOptions options;
+
+    memset(&options, 0, sizeof(options));
+    options.format = FORMAT_TEXT;
+    get_today(&options.from);
+
+    for (int i = 1; i < argc; i++) {
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (agenda && strcmp(argv[i], "--from") == 0 && parse_date(value, &options.from)) {
+            i++;
+        } else if (agenda && strcmp(argv[i], "--to") == 0 && parse_date(value, &options.to)) {
+            have_to = 1;
+            i++;
+        } else if (strcmp(argv[i], "--format") == 0 && value && strcmp(value, "text") == 0) {
+            options.format = FORMAT_TEXT;
+            i++;
+        } else if (strcmp(argv[i], "--format") == 0 && value && strcmp(value, "json") == 0) {
+            options.format = FORMAT_JSON;
+            i++;
+        } else if (agenda && strcmp(argv[i], "--format") == 0 && value && strcmp(value, "ics") == 0) {
+            options.format = FORMAT_ICS;
+            i++;
+        } else if (!agenda && strcmp(argv[i], "--pending") == 0) {
+            options.pending_only = 1;
+        } else {
+            fprintf(stderr, "wcal %s: unexpected argument '%s'\n", argv[0], argv[i]);
+            if (agenda) {
+                fprintf(stderr, "Usage: wcal agenda [--from YYYY-MM-DD] [--to YYYY-MM-DD] [--format text|json|ics]\n");
+            } else {
+                fprintf(stderr, "Usage: wcal todos [--pending] [--format text|json]\n");
+            }
+            return 1;
+        }
+    }
+
+    // A single day unless a range is given
+    if (!have_to) options.to = options.from;
+    if (compare_dates(options.to, options.from) < 0) {
+        fprintf(stderr, "wcal agenda: --to is before --from\n");
+        return 1;
+    }
+
+    AppointmentList appointments;
+    TodoList todos;
+    init_appointments(&appointments);
+    init_todos(&todos);
+    // No archive yet is an empty calendar; one that can't be read is an error
+    int result = 0;
+    FILE *archive;
+    if (!load_data_from_zip(&appointments, &todos) && fopen_s(&archive, ARCHIVE_NAME, "rb") == 0) {
+        fclose(archive);
+        result = 1;
+    } else if (agenda) {
+        if (storage_reach(&appointments, options.from.year, options.to.year) < 0) {
+            result = 1;
+        } else {
+            run_agenda(&appointments, &options);
+        }
+    } else {
+        run_todos(&todos, &options);
+    }
+    if (result) fprintf(stderr, "wcal: %s could not be read\n", ARCHIVE_NAME);
+
+    // A shard that failed its checksum was left out of the answer
+    if (storage_damaged()) {
+        fprintf(stderr, "wcal: %s is damaged; saving keeps a copy as %s\n", ARCHIVE_NAME, DAMAGED_ARCHIVE_NAME);
+        result = 1;
+    }
+
+    if (g_mem_report) {
+        size_t used[MEM_SUBSYSTEM_COUNT] = {0};
+        used[MEM_APPOINTMENTS] = appointments_data_bytes(&appointments);
+        used[MEM_TODOS] = todos_data_bytes(&todos);
+        wmem_report_checkpoint(used);
+    }
+    free_appointments(&appointments);
+    free_todos(&todos);
+    return result;
+}
\ No newline at end of file
@@ -0,0 +1,16 @@
+#ifndef QUERY_H
+#define QUERY_H
+
+// One-shot read-only commands for scripts and status bars:
+//
+//   wcal agenda [--from YYYY-MM-DD] [--to YYYY-MM-DD] [--format text|json|ics]
+//   wcal todos [--pending] [--format text|json]
+//
+// They load the data file, print to stdout and exit without initialising
+// the console or entering the main loop.
+int is_query_command(const char *name);
+
+// argv[0] is the command name; returns the process exit code
+int run_query(int argc, char *argv[]);
+
+#endif // QUERY_H
\ No newline at end of file
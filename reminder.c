@@ -0,0 +1,276 @@
+#include "reminder.h"
+#include "wmem.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "compat.h"
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
+
+#define SLOT_MASK       (REMINDER_SLOTS - 1)
+#define NO_EVENT        LLONG_MAX
+
+// Minutes one bucket of the given level spans
+static long long level_span(int level) {
+    return 1LL << (REMINDER_SLOT_BITS * level);
+}
+
+void reminder_init(ReminderWheel *wheel, long long now) {
+    memset(wheel, 0, sizeof(*wheel));
+    wheel->free_timer = -1;
+    wheel->now = now;
+    for (int i = 0; i < REMINDER_LEVELS * REMINDER_SLOTS; i++) {
+        wheel->buckets[i] = -1;
+    }
+}
+
+void reminder_free(ReminderWheel *wheel) {
+    wmem_free(wheel->timers);
+    reminder_init(wheel, wheel->now);
+}
+
+static void link_timer(ReminderWheel *wheel, int t, int bucket) {
+    ReminderTimer *timer = &wheel->timers[t];
+
+    timer->bucket = bucket;
+    timer->prev = -1;
+    timer->next = wheel->buckets[bucket];
+    if (timer->next >= 0) wheel->timers[timer->next].prev = t;
+    wheel->buckets[bucket] = t;
+    wheel->occupied[bucket / REMINDER_SLOTS] |= 1ULL << (bucket % REMINDER_SLOTS);
+}
+
+static void unlink_timer(ReminderWheel *wheel, int t) {
+    ReminderTimer *timer = &wheel->timers[t];
+    int bucket = timer->bucket;
+
+    if (timer->prev >= 0) wheel->timers[timer->prev].next = timer->next;
+    else wheel->buckets[bucket] = timer->next;
+    if (timer->next >= 0) wheel->timers[timer->next].prev = timer->prev;
+
+    if (wheel->buckets[bucket] < 0) {
+        wheel->occupied[bucket / REMINDER_SLOTS] &= ~(1ULL << (bucket % REMINDER_SLOTS));
+    }
+    timer->bucket = -1;
+}
+
+// File a timer in the lowest level whose range reaches it
+static void insert_timer(ReminderWheel *wheel, int t) {
+    long long expires = wheel->timers[t].expires;
+    int level = 0;
+
+    // Overdue reminders go in the current bucket, which every advance drains first
+    if (expires < wheel->now) expires = wheel->now;
+
+    long long delta = expires - wheel->now;
+    if (delta >= level_span(REMINDER_LEVELS)) {
+        // Beyond the wheel: park at its far end until a cascade brings it closer
+        expires = wheel->now + level_span(REMINDER_LEVELS) - 1;
+        delta = expires - wheel->now;
+    }
+    while (level < REMINDER_LEVELS - 1 && delta >= level_span(level + 1)) level++;
+
+    int slot = (int)((expires >> (REMINDER_SLOT_BITS * level)) & SLOT_MASK);
+    link_timer(wheel, t, level * REMINDER_SLOTS + slot);
+}
+
+void reminder_schedule(ReminderWheel *wheel, Appointment *app) {
+    app->reminder_timer = 0;
+    if (app->reminder_minutes <= 0) return;
+
+    // Nothing to remind about once the appointment has started
+    long long start = datetime_to_minutes(app->date_time);
+    if (start <= wheel->now) return;
+
+    if (wheel->free_timer < 0) {
+        int capacity = wheel->capacity ? wheel->capacity * 2 : 64;
+        ReminderTimer *timers = (ReminderTimer*)wmem_realloc(MEM_INDEXES, wheel->timers,
+                                                             sizeof(ReminderTimer) * capacity);
+        if (!timers) return;
+
+        // Chain the new timers onto the free list, lowest first
+        for (int i = capacity - 1; i >= wheel->capacity; i--) {
+            timers[i].next = wheel->free_timer;
+            timers[i].bucket = -1;
+            wheel->free_timer = i;
+        }
+        wheel->timers = timers;
+        wheel->capacity = capacity;
+    }
+
+    int t = wheel->free_timer;
+    ReminderTimer *timer = &wheel->timers[t];
+    wheel->free_timer = timer->next;
+
+    timer->expires = start - app->reminder_minutes;
+    timer->start = app->date_time;
+    insert_timer(wheel, t);
+    wheel->count++;
+
+    app->reminder_timer = t + 1;
+}
+
+static void release_timer(ReminderWheel *wheel, int t) {
+    unlink_timer(wheel, t);
+    wheel->timers[t].next = wheel->free_timer;
+    wheel->free_timer = t;
+    wheel->count--;
+}
+
+void reminder_cancel(ReminderWheel *wheel, Appointment *app) {
+    int t = app->reminder_timer - 1;
+
+    app->reminder_timer = 0;
+    if (t < 0 || t >= wheel->capacity || wheel->timers[t].bucket < 0) return;
+    release_timer(wheel, t);
+}
+
+void reminder_attach(ReminderWheel *wheel, AppointmentList *list) {
+    if (!reserve_appointments(list, list->count)) return;
+
+    list->reminders = wheel;
+    for (int i = 0; i < list->count; i++) {
+        reminder_schedule(wheel, &list->items[i]);
+    }
+}
+
+// Entering a new block of a level: spread its bucket over the levels below
+static void cascade(ReminderWheel *wheel) {
+    for (int level = 1; level < REMINDER_LEVELS; level++) {
+        if (wheel->now & (level_span(level) - 1)) break;
+
+        int bucket = level * REMINDER_SLOTS + (int)((wheel->now >> (REMINDER_SLOT_BITS * level)) & SLOT_MASK);
+        int t = wheel->buckets[bucket];
+
+        wheel->buckets[bucket] = -1;
+        wheel->occupied[level] &= ~(1ULL << (bucket % REMINDER_SLOTS));
+        while (t >= 0) {
+            int next = wheel->timers[t].next;
+            insert_timer(wheel, t);
+            t = next;
+        }
+    }
+}
+
+// Next minute at which the wheel has work: a filled bucket in the first
+// level or, while later levels hold timers, the next cascade
+static long long next_event(const ReminderWheel *wheel) {
+    long long event = NO_EVENT;
+
+    if (wheel->count == 0) return NO_EVENT;
+
+    for (int level = 1; level < REMINDER_LEVELS; level++) {
+        if (wheel->occupied[level]) {
+            event = ((wheel->now >> REMINDER_SLOT_BITS) + 1) << REMINDER_SLOT_BITS;
+            break;
+        }
+    }
+
+    for (int ahead = 0; ahead < REMINDER_SLOTS && wheel->now + ahead < event; ahead++) {
+        if (wheel->occupied[0] & (1ULL << ((wheel->now + ahead) & SLOT_MASK))) return wheel->now + ahead;
+    }
+    return event;
+}
+
+int reminder_advance(ReminderWheel *wheel, AppointmentList *list, long long now, int *fired, int max_fired) {
+    int count = 0;
+
+    for (;;) {
+        // Everything in the current minute's bucket is due
+        int *head = &wheel->buckets[wheel->now & SLOT_MASK];
+        while (*head >= 0 && count < max_fired) {
+            int t = *head;
+            int index = find_appointment_by_timer(list, wheel->timers[t].start, t + 1);
+
+            // Clearing the fired appointment's timer writes to the list;
+            // when out of memory the timer stays due for the next call
+            if (index >= 0 && !reserve_appointments(list, list->count)) return count;
+            release_timer(wheel, t);
+            if (index >= 0) {
+                list->items[index].reminder_timer = 0;
+                fired[count++] = index;
+            }
+        }
+        if (*head >= 0 || wheel->now >= now) break;
+
+        // Skip straight to the next minute that has anything in it
+        long long next = next_event(wheel);
+        if (next > now) {
+            wheel->now = now;
+            break;
+        }
+        wheel->now = next;
+        cascade(wheel);
+    }
+
+    return count;
+}
+
+int reminder_timeout_ms(const ReminderWheel *wheel) {
+    long long event = next_event(wheel);
+    if (event == NO_EVENT) return -1;
+
+    DateTime now;
+    get_now(&now);
+    long long minutes = event - datetime_to_minutes(now);
+    if (minutes <= 0) return 0;
+
+    // Wake at the start of the due minute
+    long long ms = (minutes - 1) * 60 * 1000 + get_ms_until_next_minute();
+    return ms > INT_MAX ? INT_MAX : (int)ms;
+}
+
+void reminder_describe(const ReminderWheel *wheel, const Appointment *app, char *buffer, int buffer_size) {
+    long long minutes = datetime_to_minutes(app->date_time) - wheel->now;
+    char until[32];
+
+    if (minutes > 0) {
+        format_duration_compact((int)minutes, until, sizeof(until));
+        sprintf_s(buffer, buffer_size, "Reminder: %02d:%02d %s (in %s)",
+                  app->date_time.hour, app->date_time.minute, app->description, until);
+    } else {
+        sprintf_s(buffer, buffer_size, "Reminder: %02d:%02d %s (now)",
+                  app->date_time.hour, app->date_time.minute, app->description);
+    }
+}
+
+void reminder_run_command(const Appointment *app) {
+    const char *command = getenv("WCAL_REMINDER_COMMAND");
+    char start[32];
+
+    if (!command || !*command) return;
+
+    // Passed through the environment so the text never meets the shell's parser
+    sprintf_s(start, sizeof(start), "%04d-%02d-%02d %02d:%02d", app->date_time.year, app->date_time.month,
+              app->date_time.day, app->date_time.hour, app->date_time.minute);
+    _putenv_s("WCAL_REMINDER_TEXT", app->description);
+    _putenv_s("WCAL_REMINDER_START", start);
+
+#ifdef _WIN32
+    // Detached, so it neither blocks the UI nor writes over the console
+    _spawnlp(_P_DETACH, "cmd.exe", "cmd.exe", "/c", command, NULL);
+#else
+    // Double fork: the grandchild is reparented, so nothing is left to reap
+    pid_t child = fork();
+    if (child == 0) {
+        if (fork() == 0) {
+            int null_fd = open("/dev/null", O_RDWR);
+            if (null_fd >= 0) {
+                dup2(null_fd, STDIN_FILENO);
+                dup2(null_fd, STDOUT_FILENO);
+                dup2(null_fd, STDERR_FILENO);
+            }
+            execl("/bin/sh", "sh", "-c", command, (char*)NULL);
+        }
+        _exit(0);
+    }
+    if (child > 0) waitpid(child, NULL, 0);
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#ifndef REMINDER_H
+#define REMINDER_H
+
+#include "calendar.h"
+#include "appointments.h"
+
+// Hierarchical timer wheel for appointment reminders, in whole minutes.
+// Each level has REMINDER_SLOTS buckets; level n covers 64^(n+1) minutes
+// ahead, so four levels reach about 31 years. Timers further out park in
+// the last level and are re-filed when it cascades.
+#define REMINDER_LEVELS     4
+#define REMINDER_SLOT_BITS  6
+#define REMINDER_SLOTS      (1 << REMINDER_SLOT_BITS)
+
+// Reminders handed out by one reminder_advance call
+#define MAX_FIRED_REMINDERS 16
+
+typedef struct {
+    long long expires;      // Minute the reminder is due
+    DateTime start;         // Appointment start, to find the appointment again
+    int next, prev;         // Bucket links (-1 ends); next also chains free timers
+    int bucket;             // Bucket holding the timer, -1 while free
+} ReminderTimer;
+
+typedef struct ReminderWheel {
+    ReminderTimer *timers;
+    int capacity;
+    int count;                              // Timers scheduled
+    int free_timer;                         // Head of the free list, -1 when empty
+    long long now;                          // Last minute processed
+    int buckets[REMINDER_LEVELS * REMINDER_SLOTS];      // First timer of each bucket, -1 when empty
+    unsigned long long occupied[REMINDER_LEVELS];       // One bit per non-empty bucket
+} ReminderWheel;
+
+void reminder_init(ReminderWheel *wheel, long long now);
+void reminder_free(ReminderWheel *wheel);
+
+// Schedule every pending reminder in the list and keep following its edits
+void reminder_attach(ReminderWheel *wheel, AppointmentList *list);
+
+// O(1): file or drop one appointment's timer (appointments.c calls these)
+void reminder_schedule(ReminderWheel *wheel, Appointment *app);
+void reminder_cancel(ReminderWheel *wheel, Appointment *app);
+
+// Move the wheel to minute `now` and collect the appointments whose
+// reminders came due, at most max_fired per call. The indices are valid
+// until the list next changes.
+int reminder_advance(ReminderWheel *wheel, AppointmentList *list, long long now, int *fired, int max_fired);
+
+// Milliseconds until reminder_advance has something to do; -1 when idle
+int reminder_timeout_ms(const ReminderWheel *wheel);
+
+// "Reminder: 14:00 Team sync (in 15m)"
+void reminder_describe(const ReminderWheel *wheel, const Appointment *app, char *buffer, int buffer_size);
+
+// Start $WCAL_REMINDER_COMMAND in the background, if set, with the
+// appointment in WCAL_REMINDER_TEXT and WCAL_REMINDER_START
+void reminder_run_command(const Appointment *app);
+
+#endif // REMINDER_H
\ No newline at end of file
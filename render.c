@@ -0,0 +1,177 @@
+#include "render.h"
+#include "term.h"
+#include "trace.h"
+#include "wmem.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+// Unchanged cells shorter than this between two changes are re-sent rather
+// than splitting the run, since a cursor jump costs more than a few cells
+#define RUN_MERGE_GAP 4
+
+static FrameBuffer g_fb;
+
+static void fill_cells(Cell *cells, int count, char ch, unsigned char attr) {
+    for (int i = 0; i < count; i++) {
+        cells[i].ch = ch;
+        cells[i].attr = attr;
+    }
+}
+
+int fb_resize(int width, int height) {
+    if (width < 1) width = 1;
+    if (height < 1) height = 1;
+    if (g_fb.cells && width == g_fb.width && height == g_fb.height) return 0;
+
+    // Both buffers are repainted anyway, so new ones are allocated rather
+    // than resized; when either can't be had, the frame keeps its old size
+    int count = width * height;
+    Cell *cells = (Cell*)wmem_malloc(MEM_RENDER, sizeof(Cell) * count);
+    Cell *shadow = (Cell*)wmem_malloc(MEM_RENDER, sizeof(Cell) * count);
+    if (!cells || !shadow) {
+        wmem_free(cells);
+        wmem_free(shadow);
+        return 0;
+    }
+
+    wmem_free(g_fb.cells);
+    wmem_free(g_fb.shadow);
+    g_fb.cells = cells;
+    g_fb.shadow = shadow;
+    g_fb.width = width;
+    g_fb.height = height;
+
+    fill_cells(g_fb.cells, count, ' ', FB_DEFAULT_ATTR);
+    // Impossible contents force the next flush to repaint everything
+    fill_cells(g_fb.shadow, count, '\0', 0xFF);
+
+    term_resize_frame(width, height);
+    return 1;
+}
+
+void fb_free(void) {
+    wmem_free(g_fb.cells);
+    wmem_free(g_fb.shadow);
+    memset(&g_fb, 0, sizeof(g_fb));
+    term_resize_frame(0, 0);
+}
+
+int fb_width(void) {
+    return g_fb.width;
+}
+
+int fb_height(void) {
+    return g_fb.height;
+}
+
+const FrameBuffer *fb_get(void) {
+    return &g_fb;
+}
+
+void fb_clear(void) {
+    fill_cells(g_fb.cells, g_fb.width * g_fb.height, ' ', FB_DEFAULT_ATTR);
+    g_fb.cells_drawn += g_fb.width * g_fb.height;
+    g_fb.cursor_x = 0;
+    g_fb.cursor_y = 0;
+}
+
+void fb_fill(int x, int y, int width, int height, char ch, unsigned char attr) {
+    // Clip to the frame
+    if (x < 0) { width += x; x = 0; }
+    if (y < 0) { height += y; y = 0; }
+    if (x + width > g_fb.width) width = g_fb.width - x;
+    if (y + height > g_fb.height) height = g_fb.height - y;
+    if (width <= 0 || height <= 0) return;
+
+    for (int row = 0; row < height; row++) {
+        fill_cells(g_fb.cells + (y + row) * g_fb.width + x, width, ch, attr);
+    }
+    g_fb.cells_drawn += width * height;
+}
+
+void fb_move(int x, int y) {
+    g_fb.cursor_x = x;
+    g_fb.cursor_y = y;
+}
+
+void fb_set_attr(unsigned char attr) {
+    g_fb.attr = attr;
+}
+
+void fb_putc(char ch) {
+    if (g_fb.cursor_y >= 0 && g_fb.cursor_y < g_fb.height &&
+        g_fb.cursor_x >= 0 && g_fb.cursor_x < g_fb.width) {
+        Cell *cell = &g_fb.cells[g_fb.cursor_y * g_fb.width + g_fb.cursor_x];
+        cell->ch = ch;
+        cell->attr = g_fb.attr;
+        g_fb.cells_drawn++;
+    }
+    g_fb.cursor_x++;
+}
+
+void fb_puts(const char *text) {
+    while (*text) {
+        fb_putc(*text++);
+    }
+}
+
+void fb_printf(const char *format, ...) {
+    char buffer[512];
+    va_list args;
+
+    va_start(args, format);
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+
+    fb_puts(buffer);
+}
+
+void fb_show_cursor(int visible) {
+    g_fb.cursor_visible = visible;
+}
+
+static int cells_equal(const Cell *a, const Cell *b) {
+    return a->ch == b->ch && a->attr == b->attr;
+}
+
+size_t fb_flush(void) {
+    unsigned long long span = trace_begin();
+    int emitted = 0;
+
+    for (int y = 0; y < g_fb.height; y++) {
+        Cell *row = g_fb.cells + y * g_fb.width;
+        Cell *prev = g_fb.shadow + y * g_fb.width;
+        int x = 0;
+
+        while (x < g_fb.width) {
+            if (cells_equal(&row[x], &prev[x])) {
+                x++;
+                continue;
+            }
+
+            // Extend the run over later changes, bridging short unchanged gaps
+            int start = x;
+            int last = x;
+            for (int i = x + 1; i < g_fb.width && i - last <= RUN_MERGE_GAP; i++) {
+                if (!cells_equal(&row[i], &prev[i])) {
+                    last = i;
+                }
+            }
+
+            int count = last - start + 1;
+            term_draw_run(start, y, row + start, count);
+            memcpy(prev + start, row + start, sizeof(Cell) * count);
+            emitted += count;
+            x = last + 1;
+        }
+    }
+
+    g_fb.last_frame_cells_drawn = g_fb.cells_drawn;
+    g_fb.cells_drawn = 0;
+    g_fb.last_flush_cells = emitted;
+    g_fb.last_flush_bytes = term_present(g_fb.cursor_visible, g_fb.cursor_x, g_fb.cursor_y);
+    trace_end(TRACE_FLUSH, span);
+    return g_fb.last_flush_bytes;
+}
\ No newline at end of file
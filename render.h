@@ -0,0 +1,50 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <stddef.h>
+
+// Attribute used for blank cells (white on black, console attribute layout)
+#define FB_DEFAULT_ATTR 0x07
+
+// A single screen cell: character plus console attribute (foreground | background << 4)
+typedef struct {
+    char ch;
+    unsigned char attr;
+} Cell;
+
+// In-memory frame. All drawing goes into `cells`; `shadow` holds what the
+// console currently shows, so a flush only has to emit the cells that differ.
+typedef struct {
+    int width, height;
+    Cell *cells;
+    Cell *shadow;
+    int cursor_x, cursor_y;
+    unsigned char attr;
+    int cursor_visible;
+    int cells_drawn;            // Cells written since the last flush
+    int last_frame_cells_drawn; // Cells written for the last flushed frame
+    int last_flush_cells;       // Cells sent to the terminal by the last flush
+    size_t last_flush_bytes;
+} FrameBuffer;
+
+// Frame management (fb_resize returns 1 when the size changed)
+int fb_resize(int width, int height);
+void fb_free(void);
+int fb_width(void);
+int fb_height(void);
+const FrameBuffer *fb_get(void);
+
+// Drawing (clipped to the frame, never wraps)
+void fb_clear(void);
+void fb_fill(int x, int y, int width, int height, char ch, unsigned char attr);
+void fb_move(int x, int y);
+void fb_set_attr(unsigned char attr);
+void fb_putc(char ch);
+void fb_puts(const char *text);
+void fb_printf(const char *format, ...);
+void fb_show_cursor(int visible);
+
+// Send changed cells to the console; returns the number of bytes written
+size_t fb_flush(void);
+
+#endif // RENDER_H
\ No newline at end of file
@@ -0,0 +1,527 @@
+#include "server.h"
+#include "calendar.h"
+#include "appointments.h"
+#include "todo.h"
+#include "storage.h"
+#include "wmem.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <limits.h>
+#include "compat.h"
+
+#ifdef _WIN32
+
+int run_server(const char *socket_path) {
+    (void)socket_path;
+    fprintf(stderr, "wcal --serve: not available on Windows builds\n");
+    return 1;
+}
+
+#else
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// Longest request line accepted
+#define SERVER_MAX_REQUEST 1024
+
+// Appointments fetched per search while answering a range
+#define SERVER_BATCH 256
+
+typedef struct {
+    int fd;
+    char in[SERVER_MAX_REQUEST];
+    int in_length;
+    char *out;                  // Pending response bytes
+    size_t out_length;
+    size_t out_sent;
+    size_t out_capacity;
+    int closing;                // Drop the connection once out is flushed
+} Client;
+
+typedef struct {
+    AppointmentList appointments;
+    TodoList todos;
+    int all_reached;            // Every cold year has been read in since the last load
+    Client *clients;
+    int client_count;
+    int client_capacity;
+} Server;
+
+static volatile sig_atomic_t g_stop = 0;
+
+static void handle_stop(int signal_number) {
+    (void)signal_number;
+    g_stop = 1;
+}
+
+static const char *g_priority_names[] = {"normal", "high", "urgent"};
+
+// ---------------------------------------------------------------------------
+// Responses
+// ---------------------------------------------------------------------------
+
+static int reserve(Client *client, size_t extra) {
+    if (client->out_length + extra <= client->out_capacity) return 1;
+
+    size_t capacity = client->out_capacity ? client->out_capacity : 4096;
+    while (capacity < client->out_length + extra) capacity *= 2;
+
+    char *out = (char*)realloc(client->out, capacity);
+    if (!out) return 0;
+    client->out = out;
+    client->out_capacity = capacity;
+    return 1;
+}
+
+static void reply(Client *client, const char *format, ...) {
+    va_list args;
+    char line[SERVER_MAX_REQUEST + MAX_DESCRIPTION_LENGTH + 64];
+
+    va_start(args, format);
+    int length = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+
+    if (length < 0) return;
+    if (length >= (int)sizeof(line)) length = sizeof(line) - 1;
+    if (!reserve(client, length)) {
+        client->closing = 1;
+        return;
+    }
+    memcpy(client->out + client->out_length, line, length);
+    client->out_length += length;
+}
+
+// Results are appended first and the "OK <n>" header slotted in front of
+// them afterwards, so nothing has to be counted in advance
+static size_t begin_results(Client *client) {
+    return client->out_length;
+}
+
+static void end_results(Client *client, size_t start, int count) {
+    char header[32];
+    int length = snprintf(header, sizeof(header), "OK %d\n", count);
+
+    if (!reserve(client, length)) {
+        client->closing = 1;
+        return;
+    }
+    memmove(client->out + start + length, client->out + start, client->out_length - start);
+    memcpy(client->out + start, header, length);
+    client->out_length += length;
+}
+
+static void reply_appointment(Client *client, const Appointment *app) {
+    reply(client, "A %04d-%02d-%02dT%02d:%02d %d %s\n",
+          app->date_time.year, app->date_time.month, app->date_time.day,
+          app->date_time.hour, app->date_time.minute, app->duration_minutes, app->description);
+}
+
+static void reply_todo(Client *client, const TodoItem *todo) {
+    int priority = todo->priority >= 0 && todo->priority <= 2 ? todo->priority : 0;
+
+    if (todo->due.year) {
+        reply(client, "T %d %s %04d-%02d-%02d %s\n", todo->completed ? 1 : 0, g_priority_names[priority],
+              todo->due.year, todo->due.month, todo->due.day, todo->description);
+    } else {
+        reply(client, "T %d %s - %s\n", todo->completed ? 1 : 0, g_priority_names[priority], todo->description);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Requests
+// ---------------------------------------------------------------------------
+
+static int parse_range(char *arguments, Date *from, Date *to) {
+    char *second = strchr(arguments, ' ');
+    if (!second) return 0;
+    *second++ = '\0';
+
+    if (!parse_date(arguments, from) || !parse_date(second, to)) return 0;
+    return compare_dates(*from, *to) <= 0;
+}
+
+static void answer_range(Server *server, Client *client, Date from, Date to) {
+    int indices[SERVER_BATCH];
+    int first = 0;
+    int found;
+    size_t start = begin_results(client);
+
+    storage_reach(&server->appointments, from.year, to.year);
+    do {
+        found = find_appointments_in_range(&server->appointments, from, to, first, indices, SERVER_BATCH);
+        for (int i = 0; i < found; i++) {
+            reply_appointment(client, &server->appointments.items[indices[i]]);
+        }
+        first += found;
+    } while (found == SERVER_BATCH);
+
+    end_results(client, start, first);
+}
+
+static void answer_freebusy(Server *server, Client *client, Date from, Date to) {
+    int indices[SERVER_BATCH];
+    int first = 0;
+    int found;
+    int spans = 0;
+    int open = 0;
+    DateTime span_start = {0}, span_end = {0};
+    size_t start = begin_results(client);
+
+    storage_reach(&server->appointments, from.year, to.year);
+
+    // Busy time is clipped to [from 00:00, to + 1 day 00:00)
+    Date after = to;
+    add_days_to_date(&after, 1);
+    DateTime range_start = {from.year, from.month, from.day, 0, 0};
+    DateTime range_end = {after.year, after.month, after.day, 0, 0};
+
+    // Appointments arrive in start order, so overlapping ones merge in one pass
+    do {
+        found = find_appointments_in_range(&server->appointments, from, to, first, indices, SERVER_BATCH);
+        for (int i = 0; i < found; i++) {
+            Appointment *app = &server->appointments.items[indices[i]];
+            DateTime app_start = app->date_time;
+            DateTime app_end = get_appointment_end(app);
+
+            if (compare_datetimes(app_start, range_start) < 0) app_start = range_start;
+            if (compare_datetimes(app_end, range_end) > 0) app_end = range_end;
+            if (compare_datetimes(app_start, app_end) >= 0) continue;
+
+            if (open && compare_datetimes(app_start, span_end) <= 0) {
+                if (compare_datetimes(app_end, span_end) > 0) span_end = app_end;
+                continue;
+            }
+            if (open) {
+                reply(client, "B %04d-%02d-%02dT%02d:%02d %04d-%02d-%02dT%02d:%02d\n",
+                      span_start.year, span_start.month, span_start.day, span_start.hour, span_start.minute,
+                      span_end.year, span_end.month, span_end.day, span_end.hour, span_end.minute);
+                spans++;
+            }
+            span_start = app_start;
+            span_end = app_end;
+            open = 1;
+        }
+        first += found;
+    } while (found == SERVER_BATCH);
+
+    if (open) {
+        reply(client, "B %04d-%02d-%02dT%02d:%02d %04d-%02d-%02dT%02d:%02d\n",
+              span_start.year, span_start.month, span_start.day, span_start.hour, span_start.minute,
+              span_end.year, span_end.month, span_end.day, span_end.hour, span_end.minute);
+        spans++;
+    }
+
+    end_results(client, start, spans);
+}
+
+// needle must already be lower case
+static int contains_ignore_case(const char *text, const char *needle) {
+    size_t length = strlen(needle);
+
+    for (; *text; text++) {
+        size_t i = 0;
+        while (i < length && tolower((unsigned char)text[i]) == needle[i]) i++;
+        if (i == length) return 1;
+    }
+    return length == 0;
+}
+
+// Todos are answered through todo_walk, in one pass over the tree
+typedef struct {
+    Client *client;
+    const char *text;           // Search text, or NULL to answer every todo
+    int pending_only;
+    int count;
+} TodoAnswer;
+
+static int answer_todo(void *context, TodoItem *todo) {
+    TodoAnswer *answer = (TodoAnswer*)context;
+
+    if (answer->pending_only && todo->completed) return 0;     // Completed todos sort last
+    if (answer->text && !contains_ignore_case(todo->description, answer->text)) return 1;
+    reply_todo(answer->client, todo);
+    answer->count++;
+    return 1;
+}
+
+static void answer_search(Server *server, Client *client, char *text) {
+    int count = 0;
+    size_t start = begin_results(client);
+
+    for (char *p = text; *p; p++) *p = (char)tolower((unsigned char)*p);
+
+    // A search covers every year, so the first one reads the cold years in;
+    // one that fails is tried again by the next
+    if (!server->all_reached) server->all_reached = storage_reach(&server->appointments, 0, INT_MAX) >= 0;
+
+    for (int i = 0; i < server->appointments.count; i++) {
+        if (contains_ignore_case(server->appointments.items[i].description, text)) {
+            reply_appointment(client, &server->appointments.items[i]);
+            count++;
+        }
+    }
+
+    TodoAnswer answer = {client, text, 0, 0};
+    todo_walk(&server->todos, 0, answer_todo, &answer);
+
+    end_results(client, start, count + answer.count);
+}
+
+static void answer_todos(Server *server, Client *client, int pending_only) {
+    size_t start = begin_results(client);
+    TodoAnswer answer = {client, NULL, pending_only, 0};
+
+    todo_walk(&server->todos, 0, answer_todo, &answer);
+    end_results(client, start, answer.count);
+}
+
+static void load_data(Server *server) {
+    init_appointments(&server->appointments);
+    init_todos(&server->todos);
+    server->all_reached = 0;
+    load_data_from_zip(&server->appointments, &server->todos);
+}
+
+static void unload_data(Server *server) {
+    // The last unload, at shutdown, is what --mem-report shows
+    if (g_mem_report) {
+        size_t used[MEM_SUBSYSTEM_COUNT] = {0};
+        used[MEM_APPOINTMENTS] = appointments_data_bytes(&server->appointments);
+        used[MEM_TODOS] = todos_data_bytes(&server->todos);
+        wmem_report_checkpoint(used);
+    }
+    free_appointments(&server->appointments);
+    free_todos(&server->todos);
+}
+
+static void handle_request(Server *server, Client *client, char *line) {
+    Date from, to;
+    char *arguments = strchr(line, ' ');
+
+    if (arguments) {
+        *arguments++ = '\0';
+    } else {
+        arguments = line + strlen(line);
+    }
+
+    if (strcmp(line, "PING") == 0) {
+        reply(client, "OK 0\n");
+    } else if (strcmp(line, "RANGE") == 0) {
+        if (parse_range(arguments, &from, &to)) answer_range(server, client, from, to);
+        else reply(client, "ERR expected RANGE YYYY-MM-DD YYYY-MM-DD\n");
+    } else if (strcmp(line, "FREEBUSY") == 0) {
+        if (parse_range(arguments, &from, &to)) answer_freebusy(server, client, from, to);
+        else reply(client, "ERR expected FREEBUSY YYYY-MM-DD YYYY-MM-DD\n");
+    } else if (strcmp(line, "SEARCH") == 0) {
+        if (*arguments) answer_search(server, client, arguments);
+        else reply(client, "ERR expected SEARCH TEXT\n");
+    } else if (strcmp(line, "TODOS") == 0) {
+        answer_todos(server, client, strcmp(arguments, "pending") == 0);
+    } else if (strcmp(line, "RELOAD") == 0) {
+        unload_data(server);
+        load_data(server);
+        reply(client, "OK 0\n");
+    } else if (strcmp(line, "QUIT") == 0) {
+        reply(client, "OK 0\n");
+        client->closing = 1;
+    } else {
+        reply(client, "ERR unknown command\n");
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Connections
+// ---------------------------------------------------------------------------
+
+static int set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+static void add_client(Server *server, int fd) {
+    if (server->client_count >= server->client_capacity) {
+        int capacity = server->client_capacity ? server->client_capacity * 2 : 16;
+        Client *clients = (Client*)realloc(server->clients, sizeof(Client) * capacity);
+        if (!clients) {
+            close(fd);
+            return;
+        }
+        server->clients = clients;
+        server->client_capacity = capacity;
+    }
+
+    Client *client = &server->clients[server->client_count++];
+    memset(client, 0, sizeof(*client));
+    client->fd = fd;
+}
+
+static void remove_client(Server *server, int index) {
+    close(server->clients[index].fd);
+    free(server->clients[index].out);
+    server->clients[index] = server->clients[--server->client_count];
+}
+
+// Read what has arrived and answer every complete line; 0 drops the client
+static int read_client(Server *server, Client *client) {
+    ssize_t received = read(client->fd, client->in + client->in_length, sizeof(client->in) - client->in_length);
+
+    if (received == 0) return 0;
+    if (received < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    client->in_length += (int)received;
+
+    int consumed = 0;
+    for (int i = 0; i < client->in_length && !client->closing; i++) {
+        if (client->in[i] != '\n') continue;
+
+        char *line = client->in + consumed;
+        client->in[i] = '\0';
+        if (i > consumed && client->in[i - 1] == '\r') client->in[i - 1] = '\0';
+        handle_request(server, client, line);
+        consumed = i + 1;
+    }
+
+    memmove(client->in, client->in + consumed, client->in_length - consumed);
+    client->in_length -= consumed;
+
+    if (client->in_length == (int)sizeof(client->in)) {
+        reply(client, "ERR request too long\n");
+        client->closing = 1;
+    }
+    return 1;
+}
+
+// Send as much pending output as the socket takes; 0 drops the client
+static int write_client(Client *client) {
+    while (client->out_sent < client->out_length) {
+        ssize_t sent = write(client->fd, client->out + client->out_sent, client->out_length - client->out_sent);
+        if (sent < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        client->out_sent += sent;
+    }
+
+    client->out_length = 0;
+    client->out_sent = 0;
+    return !client->closing;
+}
+
+static int open_listener(const char *socket_path) {
+    struct sockaddr_un address;
+
+    if (strlen(socket_path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "wcal --serve: socket path too long\n");
+        return -1;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socket_path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("wcal --serve: socket");
+        return -1;
+    }
+
+    // A socket file left by a server that died is reused; a live one is not
+    if (connect(fd, (struct sockaddr*)&address, sizeof(address)) == 0) {
+        fprintf(stderr, "wcal --serve: already running on %s\n", socket_path);
+        close(fd);
+        return -1;
+    }
+    unlink(socket_path);
+
+    if (bind(fd, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(fd, 64) != 0 ||
+        !set_nonblocking(fd)) {
+        perror("wcal --serve");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int run_server(const char *socket_path) {
+    Server server;
+    struct pollfd *fds = NULL;
+    int fd_capacity = 0;
+
+    if (!socket_path) socket_path = SERVER_DEFAULT_SOCKET;
+
+    memset(&server, 0, sizeof(server));
+    int listener = open_listener(socket_path);
+    if (listener < 0) return 1;
+
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, handle_stop);
+    signal(SIGTERM, handle_stop);
+
+    load_data(&server);
+    fprintf(stderr, "wcal: serving %d appointments and %d todos on %s\n",
+            server.appointments.count, server.todos.count, socket_path);
+
+    while (!g_stop) {
+        if (fd_capacity < server.client_count + 1) {
+            fd_capacity = (server.client_count + 1) * 2;
+            struct pollfd *grown = (struct pollfd*)realloc(fds, sizeof(struct pollfd) * fd_capacity);
+            if (!grown) break;
+            fds = grown;
+        }
+
+        fds[0].fd = listener;
+        fds[0].events = POLLIN;
+        for (int i = 0; i < server.client_count; i++) {
+            fds[i + 1].fd = server.clients[i].fd;
+            fds[i + 1].events = server.clients[i].out_length > 0 ? POLLOUT : POLLIN;
+        }
+
+        int polled = server.client_count + 1;
+        if (poll(fds, polled, -1) < 0) {
+            if (errno == EINTR) continue;
+            perror("wcal --serve: poll");
+            break;
+        }
+
+        // Walk backwards so removing a client doesn't shift unvisited entries
+        for (int i = polled - 2; i >= 0; i--) {
+            Client *client = &server.clients[i];
+            short revents = fds[i + 1].revents;
+            int keep = 1;
+
+            if (revents & (POLLERR | POLLNVAL)) {
+                keep = 0;
+            } else if (revents & POLLOUT) {
+                keep = write_client(client);
+            } else if (revents & (POLLIN | POLLHUP)) {
+                keep = read_client(&server, client);
+                // Most answers fit in the socket buffer; send them right away
+                if (keep && client->out_length > 0) keep = write_client(client);
+            }
+
+            if (!keep) remove_client(&server, i);
+        }
+
+        if (fds[0].revents & POLLIN) {
+            int fd;
+            while ((fd = accept(listener, NULL, NULL)) >= 0) {
+                if (set_nonblocking(fd)) add_client(&server, fd);
+                else close(fd);
+            }
+        }
+    }
+
+    while (server.client_count > 0) remove_client(&server, server.client_count - 1);
+    free(server.clients);
+    free(fds);
+    close(listener);
+    unlink(socket_path);
+    unload_data(&server);
+    return 0;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,24 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#define SERVER_DEFAULT_SOCKET "wcal.sock"
+
+// Query daemon: `wcal --serve [socket]`. Loads the data once and answers
+// requests from any number of local clients over a Unix socket, one
+// single-threaded poll() loop for all of them.
+//
+// Requests are single lines; every response starts with "OK <n>" followed
+// by n result lines, or is a single "ERR <message>" line.
+//
+//   PING
+//   RANGE YYYY-MM-DD YYYY-MM-DD     A <start> <minutes> <description>
+//   FREEBUSY YYYY-MM-DD YYYY-MM-DD  B <start> <end>  (merged busy spans)
+//   SEARCH TEXT                     A ... and T ... lines, case-insensitive
+//   TODOS [pending]                 T <done 0|1> <priority> <due|-> <description>
+//   RELOAD                          re-read the data file
+//   QUIT                            close this connection
+//
+// Times are YYYY-MM-DDTHH:MM. Returns the process exit code.
+int run_server(const char *socket_path);
+
+#endif // SERVER_H
\ No newline at end of file
@@ -1,11 +1,30 @@
 #include "storage.h"
+#include "archive.h"
+#include "trace.h"
+#include "crc32c.h"
+#include "wmem.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <limits.h>
+#include "compat.h"
 
-// For ZIP functionality - using Windows native ZIP API through PowerShell commands
-// This is a simple approach that works cross-platform
+#ifdef _WIN32
+#include <windows.h>
+#define FINISH(flag) InterlockedExchange((flag), 1)
+#define FINISHED(flag) InterlockedCompareExchange((flag), 0, 0)
+#else
+#include <pthread.h>
+#define FINISH(flag) __atomic_store_n((flag), 1, __ATOMIC_RELEASE)
+#define FINISHED(flag) __atomic_load_n((flag), __ATOMIC_ACQUIRE)
+#endif
+
+// Room for the archive command with every shard on it
+#define COMMAND_LENGTH 8192
+
+// For ZIP functionality - using Windows native ZIP API through PowerShell commands,
+// or the zip/unzip tools on other platforms
 
 // Helper function to execute PowerShell commands for ZIP operations
 static int execute_powershell_command(const char *command) {
@@ -36,6 +55,52 @@ static void format_ics_datetime(DateTime dt, char *buffer, size_t buffer_size) {
              dt.year, dt.month, dt.day, dt.hour, dt.minute);
 }
 
+// Parse the YYYYMMDDTHHMM prefix of an ICS date-time. Done by hand because
+// sscanf dominated load time for large calendars.
+static int parse_ics_datetime(const char *text, DateTime *dt) {
+    for (int i = 0; i < 13; i++) {
+        if (i == 8 ? text[i] != 'T' : (text[i] < '0' || text[i] > '9')) return 0;
+    }
+    
+    dt->year = (text[0] - '0') * 1000 + (text[1] - '0') * 100 + (text[2] - '0') * 10 + (text[3] - '0');
+    dt->month = (text[4] - '0') * 10 + (text[5] - '0');
+    dt->day = (text[6] - '0') * 10 + (text[7] - '0');
+    dt->hour = (text[9] - '0') * 10 + (text[10] - '0');
+    dt->minute = (text[11] - '0') * 10 + (text[12] - '0');
+    return 1;
+}
+
+// Minutes before the start for an ICS TRIGGER duration such as -PT15M or
+// -P1DT2H; 0 for triggers after the start, which wcal has no use for
+static int parse_ics_trigger(const char *text) {
+    int minutes = 0;
+    int in_time = 0;
+    
+    if (*text++ != '-' || *text++ != 'P') return 0;
+    
+    while (*text) {
+        if (*text == 'T') {
+            in_time = 1;
+            text++;
+            continue;
+        }
+        
+        int value = 0;
+        if (*text < '0' || *text > '9') return 0;
+        while (*text >= '0' && *text <= '9') value = value * 10 + (*text++ - '0');
+        
+        switch (*text++) {
+            case 'W': minutes += value * 7 * 24 * 60; break;
+            case 'D': minutes += value * 24 * 60; break;
+            case 'H': minutes += value * 60; break;
+            case 'M': minutes += in_time ? value : 0; break;
+            case 'S': break;
+            default: return 0;
+        }
+    }
+    return minutes;
+}
+
 // Helper function to generate ICS UID
 static void generate_ics_uid(const Appointment *appt, char *uid, size_t uid_size) {
     snprintf(uid, uid_size, "%04d%02d%02d%02d%02d-%s@wcal.local",
@@ -51,163 +116,270 @@ static void generate_ics_uid(const Appointment *appt, char *uid, size_t uid_size
     }
 }
 
-int save_appointments_as_ics(AppointmentList *list, const char *filename) {
+char *read_text_file(const char *filename) {
     FILE *file;
-    if (fopen_s(&file, filename, "w") != 0) return 0;
+    if (fopen_s(&file, filename, "rb") != 0) return NULL;
+    
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    
+    char *text = size >= 0 ? (char*)malloc(size + 1) : NULL;
+    if (text) {
+        size_t length = fread(text, 1, size, file);
+        text[length] = '\0';
+    }
     
-    // Write ICS header
+    fclose(file);
+    return text;
+}
+
+// Split the next line off a text buffer in place; NULL at the end
+static char *next_line(char **cursor) {
+    char *line = *cursor;
+    if (!*line) return NULL;
+    
+    char *end = strchr(line, '\n');
+    if (end) {
+        *end = '\0';
+        *cursor = end + 1;
+    } else {
+        *cursor = line + strlen(line);
+    }
+    return line;
+}
+
+void write_ics_header(FILE *file) {
     fprintf(file, "BEGIN:VCALENDAR\r\n");
     fprintf(file, "VERSION:2.0\r\n");
     fprintf(file, "PRODID:-//WCAL//Calendar Application//EN\r\n");
     fprintf(file, "CALSCALE:GREGORIAN\r\n");
+}
+
+void write_ics_footer(FILE *file) {
+    fprintf(file, "END:VCALENDAR\r\n");
+}
+
+void write_ics_event(FILE *file, const Appointment *appointment) {
+    char start_time[64], end_time[64], uid[512];   // Room for any int in every date-time field
+    DateTime end_dt = appointment->date_time;
+    
+    // Calculate end time
+    end_dt.minute += appointment->duration_minutes;
+    while (end_dt.minute >= 60) {
+        end_dt.hour++;
+        end_dt.minute -= 60;
+    }
+    while (end_dt.hour >= 24) {
+        end_dt.day++;
+        end_dt.hour -= 24;
+        // Note: This is simplified - proper date arithmetic would handle month/year rollover
+    }
+    
+    format_ics_datetime(appointment->date_time, start_time, sizeof(start_time));
+    format_ics_datetime(end_dt, end_time, sizeof(end_time));
+    generate_ics_uid(appointment, uid, sizeof(uid));
+    
+    fprintf(file, "BEGIN:VEVENT\r\n");
+    fprintf(file, "UID:%s\r\n", uid);
+    fprintf(file, "DTSTART:%s\r\n", start_time);
+    fprintf(file, "DTEND:%s\r\n", end_time);
+    fprintf(file, "SUMMARY:%s\r\n", appointment->description);
+    fprintf(file, "DESCRIPTION:Duration: %d minutes\r\n", appointment->duration_minutes);
+    if (appointment->reminder_minutes > 0) {
+        fprintf(file, "BEGIN:VALARM\r\n");
+        fprintf(file, "ACTION:DISPLAY\r\n");
+        fprintf(file, "DESCRIPTION:%s\r\n", appointment->description);
+        fprintf(file, "TRIGGER:-PT%dM\r\n", appointment->reminder_minutes);
+        fprintf(file, "END:VALARM\r\n");
+    }
+    fprintf(file, "END:VEVENT\r\n");
+}
+
+static int write_ics_file(const char *filename, const Appointment *items, int count) {
+    FILE *file;
+    if (fopen_s(&file, filename, "w") != 0) return 0;
+    
+    write_ics_header(file);
     
     // Write appointments as VEVENT entries
-    for (int i = 0; i < list->count; i++) {
-        char start_time[32], end_time[32], uid[512];
-        DateTime end_dt = list->items[i].date_time;
-        
-        // Calculate end time
-        end_dt.minute += list->items[i].duration_minutes;
-        while (end_dt.minute >= 60) {
-            end_dt.hour++;
-            end_dt.minute -= 60;
-        }
-        while (end_dt.hour >= 24) {
-            end_dt.day++;
-            end_dt.hour -= 24;
-            // Note: This is simplified - proper date arithmetic would handle month/year rollover
-        }
-        
-        format_ics_datetime(list->items[i].date_time, start_time, sizeof(start_time));
-        format_ics_datetime(end_dt, end_time, sizeof(end_time));
-        generate_ics_uid(&list->items[i], uid, sizeof(uid));
-        
-        fprintf(file, "BEGIN:VEVENT\r\n");
-        fprintf(file, "UID:%s\r\n", uid);
-        fprintf(file, "DTSTART:%s\r\n", start_time);
-        fprintf(file, "DTEND:%s\r\n", end_time);
-        fprintf(file, "SUMMARY:%s\r\n", list->items[i].description);
-        fprintf(file, "DESCRIPTION:Duration: %d minutes\r\n", list->items[i].duration_minutes);
-        fprintf(file, "END:VEVENT\r\n");
+    for (int i = 0; i < count; i++) {
+        write_ics_event(file, &items[i]);
     }
     
-    // Write ICS footer
-    fprintf(file, "END:VCALENDAR\r\n");
+    write_ics_footer(file);
     
     fclose(file);
     return 1;
 }
 
+int save_appointments_as_ics(AppointmentList *list, const char *filename) {
+    return write_ics_file(filename, list->items, list->count);
+}
+
+// One CSV row per todo, written through todo_walk
+static int write_todo_row(void *context, TodoItem *todo) {
+    FILE *file = (FILE*)context;
+    char escaped_desc[MAX_TODO_DESCRIPTION * 2 + 4];
+    escape_csv_field(todo->description, escaped_desc, sizeof(escaped_desc));
+    
+    const char *priority_str;
+    switch (todo->priority) {
+        case 1: priority_str = "High"; break;
+        case 2: priority_str = "Urgent"; break;
+        default: priority_str = "Normal"; break;
+    }
+    
+    // Due date is empty when there is none
+    char due[16] = "";
+    if (todo->due.year) {
+        snprintf(due, sizeof(due), "%04d-%02d-%02d", todo->due.year, todo->due.month, todo->due.day);
+    }
+    
+    fprintf(file, "%s,%s,%s,%s\n", 
+            escaped_desc, 
+            priority_str,
+            todo->completed ? "Yes" : "No",
+            due);
+    return 1;
+}
+
 int save_todos_as_csv(TodoList *list, const char *filename) {
     FILE *file;
     if (fopen_s(&file, filename, "w") != 0) return 0;
     
     // Write CSV header
-    fprintf(file, "Description,Priority,Completed\n");
+    fprintf(file, "Description,Priority,Completed,Due\n");
     
     // Write todo items
-    for (int i = 0; i < list->count; i++) {
-        char escaped_desc[MAX_TODO_DESCRIPTION * 2 + 4];
-        escape_csv_field(list->items[i].description, escaped_desc, sizeof(escaped_desc));
-        
-        const char *priority_str;
-        switch (list->items[i].priority) {
-            case 1: priority_str = "High"; break;
-            case 2: priority_str = "Urgent"; break;
-            default: priority_str = "Normal"; break;
-        }
-        
-        fprintf(file, "%s,%s,%s\n", 
-                escaped_desc, 
-                priority_str,
-                list->items[i].completed ? "Yes" : "No");
-    }
+    todo_walk(list, 0, write_todo_row, file);
     
     fclose(file);
     return 1;
 }
 
-int load_appointments_from_ics(AppointmentList *list, const char *filename) {
-    FILE *file;
-    if (fopen_s(&file, filename, "r") != 0) return 0;
+// Remove trailing whitespace
+static void trim_line_end(char *line) {
+    char *end = line + strlen(line) - 1;
+    while (end > line && (*end == '\n' || *end == '\r' || *end == ' ' || *end == '\t')) {
+        *end-- = '\0';
+    }
+}
+
+// Apply one line from inside a VEVENT to the appointment. Returns 1 for the
+// SUMMARY, which is what makes the event complete.
+static int parse_ics_event_line(char *line, Appointment *appt, int *in_alarm) {
+    if (strcmp(line, "BEGIN:VALARM") == 0) {
+        *in_alarm = 1;
+    } else if (*in_alarm) {
+        // Only the first alarm's trigger is kept; its other lines are not ours
+        if (strcmp(line, "END:VALARM") == 0) {
+            *in_alarm = 0;
+        } else if (strncmp(line, "TRIGGER", 7) == 0 && (line[7] == ':' || line[7] == ';') &&
+                   appt->reminder_minutes == 0) {
+            // Parameters such as ;RELATED=START come before the value
+            appt->reminder_minutes = parse_ics_trigger(strchr(line, ':') ? strchr(line, ':') + 1 : "");
+        }
+    } else if (strncmp(line, "DTSTART:", 8) == 0) {
+        // Parse DTSTART: YYYYMMDDTHHMMSS
+        char *datetime_str = line + 8;
+        if (strlen(datetime_str) >= 15) {
+            parse_ics_datetime(datetime_str, &appt->date_time);
+        }
+    } else if (strncmp(line, "DTEND:", 6) == 0) {
+        // Parse DTEND to calculate duration
+        char *datetime_str = line + 6;
+        if (strlen(datetime_str) >= 15) {
+            DateTime end_dt = appt->date_time;
+            parse_ics_datetime(datetime_str, &end_dt);
+            
+            // Simple duration calculation (assumes same day)
+            int start_minutes = appt->date_time.hour * 60 + appt->date_time.minute;
+            int end_minutes = end_dt.hour * 60 + end_dt.minute;
+            appt->duration_minutes = end_minutes - start_minutes;
+            if (appt->duration_minutes <= 0) {
+                appt->duration_minutes = 60; // Default to 1 hour
+            }
+        }
+    } else if (strncmp(line, "SUMMARY:", 8) == 0) {
+        strncpy(appt->description, line + 8, MAX_DESCRIPTION_LENGTH - 1);
+        appt->description[MAX_DESCRIPTION_LENGTH - 1] = '\0';
+        return 1;
+    }
+    return 0;
+}
+
+int parse_ics_event(char *text, Appointment *appointment) {
+    char *cursor = text;
+    char *line;
+    int in_alarm = 0;
+    int complete = 0;
     
-    char line[512];
+    memset(appointment, 0, sizeof(*appointment));
+    while ((line = next_line(&cursor)) != NULL) {
+        trim_line_end(line);
+        complete |= parse_ics_event_line(line, appointment, &in_alarm);
+    }
+    return complete;
+}
+
+// Parse ICS text (modified in place) into the list
+static int parse_appointments_ics(AppointmentList *list, char *text) {
+    char *cursor = text;
+    char *line;
     Appointment current_appt;
     int in_event = 0;
+    int in_alarm = 0;
     int event_complete = 0;
     
     // Clear the list
     list->count = 0;
     
-    while (fgets(line, sizeof(line), file)) {
-        // Remove trailing whitespace
-        char *end = line + strlen(line) - 1;
-        while (end > line && (*end == '\n' || *end == '\r' || *end == ' ' || *end == '\t')) {
-            *end-- = '\0';
-        }
+    while ((line = next_line(&cursor)) != NULL) {
+        trim_line_end(line);
         
         if (strcmp(line, "BEGIN:VEVENT") == 0) {
             in_event = 1;
+            in_alarm = 0;
             event_complete = 0;
             memset(&current_appt, 0, sizeof(current_appt));
         } else if (strcmp(line, "END:VEVENT") == 0 && in_event) {
             if (event_complete) {
-                if (list->count < list->capacity) {
+                if (reserve_appointments(list, list->count + 1)) {
                     list->items[list->count++] = current_appt;
                 }
             }
             in_event = 0;
-        } else if (in_event && strncmp(line, "DTSTART:", 8) == 0) {
-            // Parse DTSTART: YYYYMMDDTHHMMSS
-            char *datetime_str = line + 8;
-            if (strlen(datetime_str) >= 15) {
-                sscanf(datetime_str, "%4d%2d%2dT%2d%2d",
-                       &current_appt.date_time.year,
-                       &current_appt.date_time.month,
-                       &current_appt.date_time.day,
-                       &current_appt.date_time.hour,
-                       &current_appt.date_time.minute);
-            }
-        } else if (in_event && strncmp(line, "DTEND:", 6) == 0) {
-            // Parse DTEND to calculate duration
-            char *datetime_str = line + 6;
-            if (strlen(datetime_str) >= 15) {
-                DateTime end_dt;
-                sscanf(datetime_str, "%4d%2d%2dT%2d%2d",
-                       &end_dt.year, &end_dt.month, &end_dt.day,
-                       &end_dt.hour, &end_dt.minute);
-                
-                // Simple duration calculation (assumes same day)
-                int start_minutes = current_appt.date_time.hour * 60 + current_appt.date_time.minute;
-                int end_minutes = end_dt.hour * 60 + end_dt.minute;
-                current_appt.duration_minutes = end_minutes - start_minutes;
-                if (current_appt.duration_minutes <= 0) {
-                    current_appt.duration_minutes = 60; // Default to 1 hour
-                }
-            }
-        } else if (in_event && strncmp(line, "SUMMARY:", 8) == 0) {
-            strncpy(current_appt.description, line + 8, MAX_DESCRIPTION_LENGTH - 1);
-            current_appt.description[MAX_DESCRIPTION_LENGTH - 1] = '\0';
-            event_complete = 1;
+        } else if (in_event) {
+            event_complete |= parse_ics_event_line(line, &current_appt, &in_alarm);
         }
     }
     
-    fclose(file);
     sort_appointments(list);
     return 1;
 }
 
-int load_todos_from_csv(TodoList *list, const char *filename) {
-    FILE *file;
-    if (fopen_s(&file, filename, "r") != 0) return 0;
+int load_appointments_from_ics(AppointmentList *list, const char *filename) {
+    char *text = read_text_file(filename);
+    if (!text) return 0;
     
-    char line[512];
+    int result = parse_appointments_ics(list, text);
+    free(text);
+    return result;
+}
+
+int parse_todos_csv(TodoList *list, char *text) {
+    char *cursor = text;
+    char *line;
     int first_line = 1;
+    TodoItem *parsed = NULL;
+    int parsed_count = 0;
+    int parsed_capacity = 0;
     
     // Clear the list
-    list->count = 0;
+    clear_todos(list);
     
-    while (fgets(line, sizeof(line), file)) {
+    while ((line = next_line(&cursor)) != NULL) {
         if (first_line) {
             first_line = 0;
             continue; // Skip header
@@ -245,58 +417,857 @@ int load_todos_from_csv(TodoList *list, const char *filename) {
                         todo.priority = 0;
                     }
                     
-                    char *completed_start = strrchr(rest, ',');
+                    char *completed_start = strchr(rest, ',');
                     if (completed_start) {
                         completed_start++;
                         todo.completed = (strncmp(completed_start, "Yes", 3) == 0) ? 1 : 0;
+                        
+                        // Files written before due dates existed stop here
+                        char *due_start = strchr(completed_start, ',');
+                        if (due_start) {
+                            parse_date(due_start + 1, &todo.due);
+                        }
                     }
                     
-                    if (list->count < list->capacity) {
-                        list->items[list->count++] = todo;
+                    // Added together at the end, so the tree is built once
+                    if (parsed_count == parsed_capacity) {
+                        int capacity = parsed_capacity ? parsed_capacity * 2 : 64;
+                        TodoItem *grown = (TodoItem*)wmem_realloc(MEM_TODOS, parsed, sizeof(TodoItem) * capacity);
+                        if (grown) {
+                            parsed = grown;
+                            parsed_capacity = capacity;
+                        }
+                    }
+                    if (parsed_count < parsed_capacity) {
+                        parsed[parsed_count++] = todo;
+                    } else {
+                        add_todos(list, parsed, parsed_count);
+                        parsed_count = 0;
+                        add_todo(list, &todo);
                     }
                 }
             }
         }
     }
     
+    add_todos(list, parsed, parsed_count);
+    wmem_free(parsed);
+    return 1;
+}
+
+int load_todos_from_csv(TodoList *list, const char *filename) {
+    char *text = read_text_file(filename);
+    if (!text) return 0;
+    
+    int result = parse_todos_csv(list, text);
+    free(text);
+    return result;
+}
+
+// ---------------------------------------------------------------------------
+// Shards
+// ---------------------------------------------------------------------------
+
+typedef enum {
+    SHARD_COLD,                     // Not read yet
+    SHARD_HOT,                      // Read with the loose member on every load and reload
+    SHARD_REACHED                   // Read once, by storage_reach
+} ShardState;
+
+// A year the archive keeps in a member of its own, as its manifest lists it
+typedef struct {
+    int year;
+    int count;                      // -1, with no hash, until a shard from before the manifest is read
+    unsigned long long hash;        // Of the appointments the member holds
+    unsigned long long base;        // Of the year's appointments as this process last read or wrote them
+    unsigned int crc;               // CRC-32C of the member's bytes
+    int checked;                    // The manifest gave crc
+    int damaged;                    // Its bytes didn't match crc; the member is left as it is
+    ShardState state;
+} Shard;
+
+// A shard member to write: the year's appointments are items[first, end)
+typedef struct {
+    int shard;                      // In g_shards, or -1 for a year without one yet
+    int year;
+    int first;
+    int end;
+    unsigned long long hash;
+    unsigned int crc;
+} ShardWrite;
+
+// A checksummed member read back: damaged if its bytes don't match
+typedef enum {
+    MEMBER_READ,
+    MEMBER_UNREADABLE,
+    MEMBER_DAMAGED
+} MemberResult;
+
+// The data archive's shards, as of its last load or save
+static Shard g_shards[MAX_SHARDS];
+static int g_shard_count;
+
+// The loose and todo members' checksums, when the manifest has them
+static unsigned int g_loose_crc;
+static unsigned int g_todos_crc;
+static int g_members_checked;
+
+// Set when a checksum didn't match; the next save keeps a copy of the
+// archive as it was before replacing anything
+static int g_damaged;
+
+// A background save reads the shards and the archive until it is taken in;
+// whatever reads the archive or changes the shards waits for it first
+static void wait_for_background_save(void);
+
+static unsigned long long mix_hash(unsigned long long h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// A sum of per-appointment hashes, so appointments that start together hash
+// the same in either order
+static unsigned long long hash_appointments(const Appointment *items, int count) {
+    unsigned long long sum = 0;
+    
+    for (int i = 0; i < count; i++) {
+        unsigned long long h = 14695981039346656037ULL;
+        for (const unsigned char *p = (const unsigned char*)items[i].description; *p; p++) {
+            h = (h ^ *p) * 1099511628211ULL;
+        }
+        h ^= mix_hash((unsigned long long)datetime_to_minutes(items[i].date_time));
+        h ^= mix_hash(((unsigned long long)(unsigned int)items[i].duration_minutes << 32) |
+                      (unsigned int)items[i].reminder_minutes);
+        sum += mix_hash(h);
+    }
+    return sum;
+}
+
+static int find_shard(int year) {
+    for (int i = 0; i < g_shard_count; i++) {
+        if (g_shards[i].year == year) return i;
+    }
+    return -1;
+}
+
+// A year the manifest lists; what was already read of it stays read. A
+// reload brings hot shards in line with the archive, but not reached ones:
+// they keep the checksum of what was read, so a save doesn't put that back
+// over another writer's change unless this one changed the year too.
+static void note_shard(int year, int count, unsigned long long hash, int checked, unsigned int crc) {
+    int i = find_shard(year);
+    
+    if (i < 0) {
+        if (g_shard_count == MAX_SHARDS) return;
+        i = g_shard_count++;
+        g_shards[i].year = year;
+        g_shards[i].state = SHARD_COLD;
+    }
+    g_shards[i].count = count;
+    g_shards[i].hash = hash;
+    g_shards[i].checked = checked;
+    g_shards[i].crc = crc;
+    if (g_shards[i].state != SHARD_REACHED) {
+        g_shards[i].base = hash;
+        g_shards[i].damaged = 0;
+    }
+}
+
+// Index of the year's first appointment, or where it would go
+static int year_first(AppointmentList *list, int year) {
+    DateTime start = {year, 1, 1, 0, 0};
+    return find_first_appointment_at(list, start);
+}
+
+int storage_horizon_year(void) {
+    const char *setting = getenv("WCAL_HORIZON_DAYS");
+    int days = setting ? atoi(setting) : DEFAULT_HORIZON_DAYS;
+    Date horizon;
+    
+    if (days <= 0) return 0;
+    get_today(&horizon);
+    add_days_to_date(&horizon, -days);
+    return horizon.year;
+}
+
+void storage_forget_shards(void) {
+    wait_for_background_save();
+    g_shard_count = 0;
+    g_members_checked = 0;
+}
+
+int storage_damaged(void) {
+    return g_damaged;
+}
+
+// From the archive, or from the working directory once the external tools
+// have unpacked it. crc is set to the bytes' CRC-32C; with check, it holds
+// the manifest's and a mismatch is damage.
+static MemberResult read_member(Archive *archive, const char *name, int check, unsigned int *crc, char **text) {
+    unsigned int actual = 0;
+    
+    if (archive) {
+        *text = archive_extract_crc(archive, name, NULL, &actual);
+    } else {
+        *text = read_text_file(name);
+        if (*text) actual = crc32c(0, *text, strlen(*text));
+    }
+    if (!*text) return MEMBER_UNREADABLE;
+    
+    if (check && actual != *crc) {
+        free(*text);
+        *text = NULL;
+        g_damaged = 1;
+        return MEMBER_DAMAGED;
+    }
+    *crc = actual;
+    return MEMBER_READ;
+}
+
+// A manifest as written: the header, then "loose CRC" and "todos CRC", a
+// line per shard of year, count, hash and CRC, and last "check CRC" over
+// every byte before it. Version 1 has no CRCs.
+typedef struct {
+    int version;
+    int checked;                    // Version 2 or later, and the check line matched
+    unsigned int loose_crc;
+    unsigned int todos_crc;
+    Shard shards[MAX_SHARDS];       // year, count, hash, crc and checked
+    int shard_count;
+} Manifest;
+
+// Returns 0 if the text isn't a manifest this version reads, or if it fails
+// its own check; nothing in it is believed until that passes
+static int parse_manifest(const char *text, Manifest *manifest) {
+    size_t length = strlen(MANIFEST_HEADER);
+    const char *line = text;
+    
+    memset(manifest, 0, sizeof(*manifest));
+    if (strncmp(text, MANIFEST_HEADER, length) != 0 || sscanf(text + length, " %d", &manifest->version) != 1) return 0;
+    if (manifest->version > MANIFEST_VERSION) return 0;
+    
+    while ((line = strchr(line, '\n')) != NULL && *++line) {
+        char buffer[128];
+        int year, count;
+        unsigned long long hash;
+        unsigned int crc;
+        
+        // One line at a time, so a short one can't borrow from the next
+        size_t line_length = strcspn(line, "\r\n");
+        if (line_length >= sizeof(buffer)) continue;
+        memcpy(buffer, line, line_length);
+        buffer[line_length] = '\0';
+        
+        if (sscanf(buffer, "check %x", &crc) == 1) {
+            manifest->checked = manifest->version >= 2 && crc32c(0, text, line - text) == crc;
+            break;
+        }
+        if (sscanf(buffer, "loose %x", &manifest->loose_crc) == 1) continue;
+        if (sscanf(buffer, "todos %x", &manifest->todos_crc) == 1) continue;
+        
+        int fields = sscanf(buffer, "%d %d %llx %x", &year, &count, &hash, &crc);
+        if (fields < 3 || manifest->shard_count == MAX_SHARDS) continue;
+        
+        Shard *shard = &manifest->shards[manifest->shard_count++];
+        shard->year = year;
+        shard->count = count;
+        shard->hash = hash;
+        shard->checked = fields == 4;
+        shard->crc = fields == 4 ? crc : 0;
+    }
+    
+    return manifest->version < 2 || manifest->checked;
+}
+
+static int read_manifest(const char *text) {
+    Manifest *manifest = (Manifest*)malloc(sizeof(Manifest));
+    if (!manifest) return 0;
+    
+    int ok = parse_manifest(text, manifest);
+    if (ok) {
+        g_members_checked = manifest->checked;
+        g_loose_crc = manifest->loose_crc;
+        g_todos_crc = manifest->todos_crc;
+        for (int i = 0; i < manifest->shard_count; i++) {
+            const Shard *shard = &manifest->shards[i];
+            note_shard(shard->year, shard->count, shard->hash, shard->checked, shard->crc);
+        }
+    } else if (manifest->version >= 2) {
+        g_damaged = 1;
+    }
+    
+    free(manifest);
+    return ok;
+}
+
+// Archives written before the manifest list their cold years in the loose
+// member's header instead, with no checksums: each is rewritten the first
+// time it is read and saved
+static void read_cold_years(const char *ics) {
+    size_t length = strlen(COLD_YEARS_PROPERTY);
+    const char *line = ics;
+    
+    while (*line && strncmp(line, COLD_YEARS_PROPERTY, length) != 0) {
+        if (strncmp(line, "BEGIN:VEVENT", 12) == 0) return;
+        line = strchr(line, '\n');
+        if (!line) return;
+        line++;
+    }
+    if (!*line) return;
+    
+    for (const char *p = line + length; *p >= '0' && *p <= '9'; ) {
+        int year = 0;
+        while (*p >= '0' && *p <= '9') year = year * 10 + (*p++ - '0');
+        if (*p == ',') p++;
+        note_shard(year, -1, 0, 0, 0);
+    }
+}
+
+char *storage_read_hot(Archive *archive, char **todos) {
+    int horizon = storage_horizon_year();
+    char *texts[MAX_SHARDS + 1];
+    size_t lengths[MAX_SHARDS + 1];
+    int hot[MAX_SHARDS];
+    int text_count = 0;
+    int hot_count = 0;
+    size_t total = 0;
+    char *manifest;
+    char *result = NULL;
+    unsigned int crc = 0;
+    int ok = 1;
+    
+    // The manifest checks itself. One that is there but can't be decoded is
+    // a failure, not an archive from before the manifest.
+    wait_for_background_save();
+    *todos = NULL;
+    read_member(archive, MANIFEST_FILE, 0, &crc, &manifest);
+    int legacy = !manifest && !(archive && archive_contains(archive, MANIFEST_FILE));
+    if (manifest) ok = read_manifest(manifest);
+    free(manifest);
+    if (!legacy && (!manifest || !ok)) return NULL;
+    
+    if (read_member(archive, TEMP_ICS_FILE, g_members_checked, &g_loose_crc, &texts[0]) != MEMBER_READ ||
+        read_member(archive, TEMP_CSV_FILE, g_members_checked, &g_todos_crc, todos) != MEMBER_READ) {
+        free(texts[0]);
+        return NULL;
+    }
+    if (legacy) read_cold_years(texts[0]);
+    lengths[text_count] = strlen(texts[0]);
+    total += lengths[text_count++];
+    
+    // Years from the horizon on, and ones already read this way even if the
+    // horizon has since passed them, so a reload diffs the same years. Ones
+    // storage_reach brought in aren't the reload's to diff.
+    for (int i = 0; i < g_shard_count && ok; i++) {
+        Shard *shard = &g_shards[i];
+        char name[64];
+        
+        if (shard->state == SHARD_REACHED) continue;
+        if (shard->state == SHARD_COLD && shard->year < horizon) continue;
+        hot[hot_count++] = i;
+        if (shard->count == 0) continue;
+        
+        snprintf(name, sizeof(name), SHARD_FORMAT, shard->year);
+        MemberResult read = read_member(archive, name, shard->checked, &shard->crc, &texts[text_count]);
+        
+        // A damaged year is left out; the rest of the calendar still loads
+        if (read == MEMBER_DAMAGED) {
+            shard->damaged = 1;
+            continue;
+        }
+        ok = read == MEMBER_READ;
+        if (ok) {
+            shard->checked = 1;
+            lengths[text_count] = strlen(texts[text_count]);
+            total += lengths[text_count++];
+        }
+    }
+    
+    // The members are whole calendars; the parsers only look at the events,
+    // so they read as one
+    if (ok) result = (char*)malloc(total + 1);
+    if (result) {
+        total = 0;
+        for (int i = 0; i < text_count; i++) {
+            memcpy(result + total, texts[i], lengths[i]);
+            total += lengths[i];
+        }
+        result[total] = '\0';
+        
+        for (int i = 0; i < hot_count; i++) g_shards[hot[i]].state = SHARD_HOT;
+    } else {
+        free(*todos);
+        *todos = NULL;
+    }
+    
+    for (int i = 0; i < text_count; i++) free(texts[i]);
+    return result;
+}
+
+// Read from the archive, or from the members the external tools unpacked
+static int reach_shards(AppointmentList *list, int from_year, int to_year, int from_files) {
+    Archive archive;
+    int opened = 0;
+    int added = 0;
+    
+    for (int i = 0; i < g_shard_count && added >= 0; i++) {
+        Shard *shard = &g_shards[i];
+        AppointmentList incoming;
+        char name[64];
+        char *text;
+        
+        if (shard->state != SHARD_COLD || shard->year < from_year || shard->year > to_year) continue;
+        wait_for_background_save();
+        
+        // Nothing to read, but it counts as read
+        if (shard->count == 0) {
+            shard->state = SHARD_REACHED;
+            continue;
+        }
+        
+        if (!from_files && !opened) {
+            if (!archive_open(&archive, ARCHIVE_NAME)) return -1;
+            opened = 1;
+        }
+        
+        snprintf(name, sizeof(name), SHARD_FORMAT, shard->year);
+        MemberResult read = read_member(from_files ? NULL : &archive, name, shard->checked, &shard->crc, &text);
+        if (read == MEMBER_UNREADABLE) {
+            added = -1;
+            break;
+        }
+        
+        // Damaged: read as empty
+        if (read == MEMBER_DAMAGED) {
+            shard->damaged = 1;
+            shard->state = SHARD_REACHED;
+            continue;
+        }
+        
+        init_appointments(&incoming);
+        parse_appointments_ics(&incoming, text);
+        if (add_appointments(list, incoming.items, incoming.count)) {
+            shard->base = hash_appointments(incoming.items, incoming.count);
+            shard->checked = 1;
+            
+            // What the manifest couldn't say is known now
+            if (shard->count < 0) {
+                shard->count = incoming.count;
+                shard->hash = shard->base;
+            }
+            shard->state = SHARD_REACHED;
+            added += incoming.count;
+        } else {
+            added = -1;
+        }
+        free_appointments(&incoming);
+        free(text);
+    }
+    
+    if (opened) archive_close(&archive);
+    return added;
+}
+
+int storage_reach(AppointmentList *list, int from_year, int to_year) {
+    return reach_shards(list, from_year, to_year, 0);
+}
+
+// The loose member: whatever has no shard, which is nothing unless the
+// calendar spans more years than MAX_SHARDS, or a shard is damaged and its
+// year has appointments added since
+static int write_loose_member(AppointmentList *list, const ShardWrite *writes, int write_count) {
+    FILE *file;
+    if (fopen_s(&file, TEMP_ICS_FILE, "w") != 0) return 0;
+    
+    write_ics_header(file);
+    for (int i = 0; i < list->count; ) {
+        int year = list->items[i].date_time.year;
+        int end = year_first(list, year + 1);
+        int shard = find_shard(year);
+        int sharded = shard >= 0 && !g_shards[shard].damaged;
+        
+        for (int w = 0; w < write_count && !sharded; w++) sharded = writes[w].year == year;
+        if (!sharded) {
+            for (; i < end; i++) write_ics_event(file, &list->items[i]);
+        }
+        i = end;
+    }
+    write_ics_footer(file);
+    
     fclose(file);
-    sort_todos(list);
     return 1;
 }
 
-int save_data_to_zip(AppointmentList *appointments, TodoList *todos) {
-    char command[1024];
+// The CRC-32C of a member just written, as the archive will hold it
+static int file_crc(const char *name, unsigned int *crc) {
+    char *text = read_text_file(name);
+    if (!text) return 0;
     
-    // Save appointments as ICS
-    if (!save_appointments_as_ics(appointments, TEMP_ICS_FILE)) {
-        return 0;
+    *crc = crc32c(0, text, strlen(text));
+    free(text);
+    return 1;
+}
+
+// Every shard, as it will be once the writes are in. Written in binary so
+// the bytes are the ones the check line covers.
+static int write_manifest(const ShardWrite *writes, int write_count, unsigned int loose_crc, unsigned int todos_crc) {
+    size_t size = (MAX_SHARDS + 8) * 64;
+    char *text = (char*)malloc(size);
+    FILE *file;
+    
+    if (!text) return 0;
+    
+    int length = snprintf(text, size, "%s %d\nloose %08x\ntodos %08x\n",
+                          MANIFEST_HEADER, MANIFEST_VERSION, loose_crc, todos_crc);
+    for (int i = 0; i < g_shard_count; i++) {
+        const Shard *shard = &g_shards[i];
+        int count = shard->count;
+        unsigned long long hash = shard->hash;
+        unsigned int crc = shard->crc;
+        int checked = shard->checked;
+        
+        for (int w = 0; w < write_count; w++) {
+            if (writes[w].shard != i) continue;
+            count = writes[w].end - writes[w].first;
+            hash = writes[w].hash;
+            crc = writes[w].crc;
+            checked = 1;
+        }
+        length += checked ? snprintf(text + length, size - length, "%d %d %016llx %08x\n", shard->year, count, hash, crc)
+                          : snprintf(text + length, size - length, "%d %d %016llx\n", shard->year, count, hash);
+    }
+    for (int w = 0; w < write_count; w++) {
+        if (writes[w].shard >= 0) continue;
+        length += snprintf(text + length, size - length, "%d %d %016llx %08x\n",
+                           writes[w].year, writes[w].end - writes[w].first, writes[w].hash, writes[w].crc);
+    }
+    length += snprintf(text + length, size - length, "check %08x\n", crc32c(0, text, length));
+    
+    int written = fopen_s(&file, MANIFEST_FILE, "wb") == 0;
+    if (written) {
+        written = fwrite(text, 1, length, file) == (size_t)length;
+        fclose(file);
+    }
+    free(text);
+    return written;
+}
+
+// The archive as it was, damage and all, for whatever can still be got out
+// of it by hand
+static void keep_damaged_archive(void) {
+    char buffer[65536];
+    FILE *in, *out;
+    size_t length;
+    
+    if (fopen_s(&in, ARCHIVE_NAME, "rb") != 0) return;
+    if (fopen_s(&out, DAMAGED_ARCHIVE_NAME, "wb") != 0) {
+        fclose(in);
+        return;
+    }
+    while ((length = fread(buffer, 1, sizeof(buffer), in)) > 0) fwrite(buffer, 1, length, out);
+    fclose(in);
+    fclose(out);
+}
+
+static void remove_shard_files(const ShardWrite *writes, int count) {
+    char name[64];
+    
+    for (int i = 0; i < count; i++) {
+        snprintf(name, sizeof(name), SHARD_FORMAT, writes[i].year);
+        remove(name);
+    }
+}
+
+// A save: the members to write, and their checksums once written. Only the
+// lists and the shards are read; nothing is changed until commit_save, so a
+// background save can run this far on its own thread.
+typedef struct {
+    AppointmentList *appointments;
+    TodoList *todos;
+    ShardWrite writes[MAX_SHARDS];
+    int write_count;
+    unsigned int loose_crc;
+    unsigned int todos_crc;
+} SaveJob;
+
+// A shard that is rewritten must hold its whole year, so one not read yet
+// is brought in first if its year has appointments here now, or if the
+// horizon has moved past it
+static int reach_for_save(AppointmentList *appointments) {
+    int horizon = storage_horizon_year();
+    
+    for (int i = 0; i < g_shard_count; i++) {
+        int year = g_shards[i].year;
+        if (g_shards[i].state != SHARD_COLD) continue;
+        if (year < horizon && year_first(appointments, year) == year_first(appointments, year + 1)) continue;
+        if (reach_shards(appointments, year, year, 0) < 0) return 0;
+    }
+    return 1;
+}
+
+// Write the members to the working directory, the manifest last
+static int write_members(SaveJob *job) {
+    AppointmentList *appointments = job->appointments;
+    char name[64];
+    
+    // Shards that were read are rewritten only if their appointments
+    // changed; ones never read are left as they are, and so are damaged ones
+    job->write_count = 0;
+    for (int i = 0; i < g_shard_count; i++) {
+        int year = g_shards[i].year;
+        int first = year_first(appointments, year);
+        int end = year_first(appointments, year + 1);
+        
+        if (g_shards[i].state == SHARD_COLD || g_shards[i].damaged) continue;
+        
+        unsigned long long hash = hash_appointments(&appointments->items[first], end - first);
+        if (hash == g_shards[i].base && g_shards[i].count >= 0) continue;
+        
+        ShardWrite write = {i, year, first, end, hash, 0};
+        job->writes[job->write_count++] = write;
     }
     
-    // Save todos as CSV
-    if (!save_todos_as_csv(todos, TEMP_CSV_FILE)) {
+    // Years without a shard get one while there is room
+    for (int i = 0; i < appointments->count && g_shard_count + job->write_count < MAX_SHARDS; ) {
+        int year = appointments->items[i].date_time.year;
+        int end = year_first(appointments, year + 1);
+        
+        if (find_shard(year) < 0) {
+            ShardWrite write = {-1, year, i, end, hash_appointments(&appointments->items[i], end - i), 0};
+            job->writes[job->write_count++] = write;
+        }
+        i = end;
+    }
+    
+    // Save appointments as ICS and todos as CSV, then the manifest with
+    // their checksums
+    int written = write_loose_member(appointments, job->writes, job->write_count) &&
+                  file_crc(TEMP_ICS_FILE, &job->loose_crc);
+    for (int i = 0; i < job->write_count && written; i++) {
+        ShardWrite *write = &job->writes[i];
+        snprintf(name, sizeof(name), SHARD_FORMAT, write->year);
+        written = write_ics_file(name, &appointments->items[write->first], write->end - write->first) &&
+                  file_crc(name, &write->crc);
+    }
+    written = written && save_todos_as_csv(job->todos, TEMP_CSV_FILE) && file_crc(TEMP_CSV_FILE, &job->todos_crc) &&
+              write_manifest(job->writes, job->write_count, job->loose_crc, job->todos_crc);
+    
+    if (!written) {
         remove(TEMP_ICS_FILE);
-        return 0;
+        remove(TEMP_CSV_FILE);
+        remove(MANIFEST_FILE);
+        remove_shard_files(job->writes, job->write_count);
     }
+    return written;
+}
+
+// Put the members written into the archive, and remove them
+static int pack_members(const SaveJob *job) {
+    char command[COMMAND_LENGTH];
+    char name[64];
     
-    // Remove existing archive if it exists
-    remove(ARCHIVE_NAME);
+    if (g_damaged) keep_damaged_archive();
+    
+    // With no shards to keep the archive is made afresh; otherwise only
+    // these members are replaced and the others are copied over as they are
+    if (g_shard_count == 0) remove(ARCHIVE_NAME);
     
     // Create ZIP archive using PowerShell
-    snprintf(command, sizeof(command),
-             "powershell -Command \"Compress-Archive -Path '%s','%s' -DestinationPath '%s' -Force\"",
-             TEMP_ICS_FILE, TEMP_CSV_FILE, ARCHIVE_NAME);
+#ifdef _WIN32
+    int length = snprintf(command, sizeof(command), "powershell -Command \"Compress-Archive -Path '%s','%s','%s'",
+                          TEMP_ICS_FILE, TEMP_CSV_FILE, MANIFEST_FILE);
+    for (int i = 0; i < job->write_count; i++) {
+        snprintf(name, sizeof(name), SHARD_FORMAT, job->writes[i].year);
+        length += snprintf(command + length, sizeof(command) - length, ",'%s'", name);
+    }
+    snprintf(command + length, sizeof(command) - length, " -DestinationPath '%s' -Update\"", ARCHIVE_NAME);
+#else
+    int length = snprintf(command, sizeof(command), "zip -q -j '%s' '%s' '%s' '%s'",
+                          ARCHIVE_NAME, TEMP_ICS_FILE, TEMP_CSV_FILE, MANIFEST_FILE);
+    for (int i = 0; i < job->write_count; i++) {
+        snprintf(name, sizeof(name), SHARD_FORMAT, job->writes[i].year);
+        length += snprintf(command + length, sizeof(command) - length, " '%s'", name);
+    }
+#endif
     
     int result = execute_powershell_command(command);
     
     // Clean up temporary files
     remove(TEMP_ICS_FILE);
     remove(TEMP_CSV_FILE);
+    remove(MANIFEST_FILE);
+    remove_shard_files(job->writes, job->write_count);
     
-    return (result == 0);
+    return result == 0;
 }
 
-int load_data_from_zip(AppointmentList *appointments, TodoList *todos) {
+// The archive now holds what was written
+static void commit_save(const SaveJob *job) {
+    int horizon = storage_horizon_year();
+    
+    for (int i = 0; i < job->write_count; i++) {
+        const ShardWrite *write = &job->writes[i];
+        int shard = write->shard;
+        if (shard < 0) {
+            shard = g_shard_count++;
+            g_shards[shard].year = write->year;
+            g_shards[shard].state = write->year < horizon ? SHARD_REACHED : SHARD_HOT;
+        }
+        g_shards[shard].count = write->end - write->first;
+        g_shards[shard].hash = write->hash;
+        g_shards[shard].base = write->hash;
+        g_shards[shard].crc = write->crc;
+        g_shards[shard].checked = 1;
+        g_shards[shard].damaged = 0;
+    }
+    g_loose_crc = job->loose_crc;
+    g_todos_crc = job->todos_crc;
+    g_members_checked = 1;
+    g_damaged = 0;
+}
+
+static int write_data_archive(AppointmentList *appointments, TodoList *todos) {
+    SaveJob job;
+    
+    wait_for_background_save();
+    
+    job.appointments = appointments;
+    job.todos = todos;
+    if (!reach_for_save(appointments) || !write_members(&job) || !pack_members(&job)) return 0;
+    commit_save(&job);
+    return 1;
+}
+
+// ---------------------------------------------------------------------------
+// Background save: the job reads snapshots of the lists, which it lets go
+// of as soon as the members are written, before the slow part, packing.
+// The shards stay as they are until the owning thread takes the result in.
+// ---------------------------------------------------------------------------
+
+static struct {
+    SaveJob job;
+    AppointmentList appointments;   // The snapshots job points to
+    TodoList todos;
+    int running;                    // Started and not yet taken in
+    SaveState report;               // How the last one ended, until storage_save_state says so
+    volatile long finished;         // Set by the save's thread as its last act
+    unsigned long long span;
+#ifdef _WIN32
+    HANDLE thread;
+#else
+    pthread_t thread;
+#endif
+} g_background;
+
+static void run_background_save(void) {
+    int saved = write_members(&g_background.job);
+    
+    release_appointments_snapshot(&g_background.appointments);
+    release_todos_snapshot(&g_background.todos);
+    
+    saved = saved && pack_members(&g_background.job);
+    g_background.report = saved ? SAVE_DONE : SAVE_FAILED;
+    FINISH(&g_background.finished);
+}
+
+#ifdef _WIN32
+static DWORD WINAPI background_main(LPVOID argument) {
+    (void)argument;
+    run_background_save();
+    return 0;
+}
+#else
+static void *background_main(void *argument) {
+    (void)argument;
+    run_background_save();
+    return NULL;
+}
+#endif
+
+// Take a finished save's result in; with wait, wait for a running one
+static void take_background_save(int wait) {
+    if (!g_background.running || (!wait && !FINISHED(&g_background.finished))) return;
+    
+#ifdef _WIN32
+    WaitForSingleObject(g_background.thread, INFINITE);
+    CloseHandle(g_background.thread);
+#else
+    pthread_join(g_background.thread, NULL);
+#endif
+    g_background.running = 0;
+    if (g_background.report == SAVE_DONE) commit_save(&g_background.job);
+    trace_end(TRACE_SAVE, g_background.span);
+}
+
+static void wait_for_background_save(void) {
+    take_background_save(1);
+}
+
+int save_data_in_background(AppointmentList *appointments, TodoList *todos) {
+    wait_for_background_save();
+    if (!reach_for_save(appointments)) return 0;
+    
+    // The checksum tables are built on first use; not on the save's thread
+    crc32c(0, NULL, 0);
+    
+    snapshot_appointments(appointments, &g_background.appointments);
+    snapshot_todos(todos, &g_background.todos);
+    g_background.job.appointments = &g_background.appointments;
+    g_background.job.todos = &g_background.todos;
+    g_background.finished = 0;
+    g_background.span = trace_begin();
+    
+#ifdef _WIN32
+    g_background.thread = CreateThread(NULL, 0, background_main, NULL, 0, NULL);
+    int started = g_background.thread != NULL;
+#else
+    int started = pthread_create(&g_background.thread, NULL, background_main, NULL) == 0;
+#endif
+    if (!started) {
+        release_appointments_snapshot(&g_background.appointments);
+        release_todos_snapshot(&g_background.todos);
+        return 0;
+    }
+    g_background.running = 1;
+    return 1;
+}
+
+SaveState storage_save_state(int wait) {
+    take_background_save(wait);
+    if (g_background.running) return SAVE_RUNNING;
+    
+    SaveState report = g_background.report;
+    g_background.report = SAVE_IDLE;
+    return report;
+}
+
+static int read_data_archive(AppointmentList *appointments, TodoList *todos) {
     char command[1024];
+    Archive archive;
+    
+    storage_forget_shards();
+    
+    // Fast path: decode the members in memory, with no helper process and
+    // no temporary files. Anything the reader can't handle falls through to
+    // the external tools below.
+    if (archive_open(&archive, ARCHIVE_NAME)) {
+        char *csv;
+        char *ics = storage_read_hot(&archive, &csv);
+        archive_close(&archive);
+        
+        if (ics) {
+            int appt_result = parse_appointments_ics(appointments, ics);
+            int todo_result = parse_todos_csv(todos, csv);
+            free(ics);
+            free(csv);
+            return (appt_result && todo_result);
+        }
+        storage_forget_shards();
+    }
     
     // Check if archive exists
     FILE *test_file;
@@ -306,27 +1277,63 @@ int load_data_from_zip(AppointmentList *appointments, TodoList *todos) {
     fclose(test_file);
     
     // Extract files from ZIP using PowerShell
+#ifdef _WIN32
     snprintf(command, sizeof(command),
              "powershell -Command \"Expand-Archive -Path '%s' -DestinationPath '.' -Force\"",
              ARCHIVE_NAME);
+#else
+    snprintf(command, sizeof(command),
+             "unzip -o -q '%s' -d .",
+             ARCHIVE_NAME);
+#endif
     
     if (execute_powershell_command(command) != 0) {
         return 0;
     }
     
-    // Load appointments from ICS
-    int appt_result = load_appointments_from_ics(appointments, TEMP_ICS_FILE);
+    // Load appointments from ICS and todos from CSV
+    int appt_result = 0;
+    int todo_result = 0;
+    char *csv;
+    char *ics = storage_read_hot(NULL, &csv);
+    if (ics) {
+        appt_result = parse_appointments_ics(appointments, ics);
+        todo_result = parse_todos_csv(todos, csv);
+        free(ics);
+        free(csv);
+    }
     
-    // Load todos from CSV
-    int todo_result = load_todos_from_csv(todos, TEMP_CSV_FILE);
+    // Every member was unpacked and there is no archive to come back to for
+    // the cold years, so they are all read now
+    if (appt_result && reach_shards(appointments, 0, INT_MAX, 1) < 0) appt_result = 0;
     
     // Clean up extracted files
     remove(TEMP_ICS_FILE);
     remove(TEMP_CSV_FILE);
+    remove(MANIFEST_FILE);
+    for (int i = 0; i < g_shard_count; i++) {
+        char name[64];
+        snprintf(name, sizeof(name), SHARD_FORMAT, g_shards[i].year);
+        remove(name);
+    }
     
     return (appt_result && todo_result);
 }
 
+int save_data_to_zip(AppointmentList *appointments, TodoList *todos) {
+    unsigned long long span = trace_begin();
+    int result = write_data_archive(appointments, todos);
+    trace_end(TRACE_SAVE, span);
+    return result;
+}
+
+int load_data_from_zip(AppointmentList *appointments, TodoList *todos) {
+    unsigned long long span = trace_begin();
+    int result = read_data_archive(appointments, todos);
+    trace_end(TRACE_LOAD, span);
+    return result;
+}
+
 // Keep original functions for backward compatibility
 int save_appointments(AppointmentList *list, const char *filename) {
     return save_appointments_as_ics(list, filename);
@@ -342,4 +1349,85 @@ int save_todos(TodoList *list, const char *filename) {
 
 int load_todos(TodoList *list, const char *filename) {
     return load_todos_from_csv(list, filename);
+}
+// One member for storage_verify: decoded, then its CRC-32C against the
+// manifest's when there is one
+static int verify_member(Archive *archive, const char *name, int checked, unsigned int crc, FILE *out,
+                         unsigned long long *bytes) {
+    unsigned int actual = 0;
+    size_t size = 0;
+    char *text = archive_extract_crc(archive, name, &size, &actual);
+    const char *verdict;
+    int failed = 1;
+    
+    if (!text) {
+        verdict = archive_contains(archive, name) ? "unreadable" : "missing";
+    } else if (!checked) {
+        verdict = "no checksum";
+        failed = 0;
+    } else {
+        failed = actual != crc;
+        verdict = failed ? "DAMAGED" : "ok";
+    }
+    
+    fprintf(out, "%-32s %-12s %12zu bytes\n", name, verdict, size);
+    free(text);
+    *bytes += size;
+    return failed;
+}
+
+int storage_verify(const char *path, FILE *out) {
+    unsigned long long start = trace_now();
+    unsigned long long bytes = 0;
+    Archive archive;
+    Manifest *manifest;
+    size_t size = 0;
+    int members = 1;
+    int failed = 0;
+    
+    if (!archive_open(&archive, path)) {
+        fprintf(out, "%s: not an archive wcal can read\n", path);
+        return -1;
+    }
+    
+    manifest = (Manifest*)malloc(sizeof(Manifest));
+    if (!manifest) {
+        archive_close(&archive);
+        return -1;
+    }
+    
+    // The manifest first: without a good one there is nothing to check the
+    // rest against. Archives from before the manifest, or with one that has
+    // no checksums, are only decoded.
+    memset(manifest, 0, sizeof(*manifest));
+    char *text = archive_extract(&archive, MANIFEST_FILE, &size);
+    int parsed = text && parse_manifest(text, manifest);
+    const char *verdict = manifest->checked ? "ok" : parsed ? "no checksum" :
+                          text ? "DAMAGED" : archive_contains(&archive, MANIFEST_FILE) ? "unreadable" : "missing";
+    fprintf(out, "%-32s %-12s %12zu bytes\n", MANIFEST_FILE, verdict, size);
+    bytes += size;
+    free(text);
+    
+    if (parsed || !archive_contains(&archive, MANIFEST_FILE)) {
+        failed += verify_member(&archive, TEMP_ICS_FILE, manifest->checked, manifest->loose_crc, out, &bytes);
+        failed += verify_member(&archive, TEMP_CSV_FILE, manifest->checked, manifest->todos_crc, out, &bytes);
+        members += 2;
+        
+        for (int i = 0; i < manifest->shard_count; i++) {
+            char name[64];
+            snprintf(name, sizeof(name), SHARD_FORMAT, manifest->shards[i].year);
+            failed += verify_member(&archive, name, manifest->shards[i].checked, manifest->shards[i].crc, out, &bytes);
+            members++;
+        }
+    } else {
+        failed++;
+    }
+    
+    free(manifest);
+    archive_close(&archive);
+    
+    double seconds = (trace_now() - start) / 1e9;
+    fprintf(out, "%s: %d members, %.1f MB in %.2f s (%.0f MB/s, CRC-32C by %s): %s\n", path, members,
+            bytes / 1e6, seconds, seconds > 0 ? bytes / 1e6 / seconds : 0.0, crc32c_method(), failed ? "FAILED" : "ok");
+    return failed;
 }
\ No newline at end of file
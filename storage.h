@@ -1,8 +1,10 @@
 #ifndef STORAGE_H
 #define STORAGE_H
 
+#include <stdio.h>
 #include "appointments.h"
 #include "todo.h"
+#include "archive.h"
 
 // File formats version
 #define STORAGE_VERSION 1
@@ -14,6 +16,27 @@
 #define ICS_FILE_IN_ZIP "appointments.ics"
 #define CSV_FILE_IN_ZIP "todos.csv"
 
+// Sharded storage. Each year's appointments are an archive member of their
+// own, a shard, and the manifest member lists every shard with its count, a
+// checksum of its appointments and the CRC-32C of its bytes, along with the
+// CRC-32C of the other members and of the manifest itself. A save rewrites
+// only the shards whose checksum changed, and never a damaged one. A load
+// reads the years from the horizon on, WCAL_HORIZON_DAYS (default 365)
+// before today; an older, cold year is read when storage_reach asks for it.
+// A horizon of 0 reads every year. The loose member, temp_appointments.ics,
+// holds what has no shard.
+#define SHARD_FORMAT "temp_appointments_%04d.ics"
+#define MANIFEST_FILE "temp_manifest.txt"
+#define MANIFEST_HEADER "wcal shards"
+#define MANIFEST_VERSION 2
+#define DAMAGED_ARCHIVE_NAME "wcal_data.damaged.zip"
+#define DEFAULT_HORIZON_DAYS 365
+#define MAX_SHARDS 200
+
+// Archives written before the manifest list their cold years in the loose
+// member's header
+#define COLD_YEARS_PROPERTY "X-WCAL-COLD-YEARS:"
+
 // Storage functions
 int save_appointments(AppointmentList *list, const char *filename);
 int load_appointments(AppointmentList *list, const char *filename);
@@ -24,10 +47,63 @@ int load_todos(TodoList *list, const char *filename);
 int save_data_to_zip(AppointmentList *appointments, TodoList *todos);
 int load_data_from_zip(AppointmentList *appointments, TodoList *todos);
 
+// Save on a thread of its own, from snapshots of the lists, so the caller
+// goes on editing them meanwhile. One runs at a time; the other functions
+// here that read the archive wait for it, save_data_to_zip included.
+// Returns 0 if it couldn't be started.
+int save_data_in_background(AppointmentList *appointments, TodoList *todos);
+
+typedef enum {
+    SAVE_IDLE,
+    SAVE_RUNNING,
+    SAVE_DONE,
+    SAVE_FAILED
+} SaveState;
+
+// How the background save is doing. How it ended is told once, by the
+// first call after; with wait, a running one is waited for.
+SaveState storage_save_state(int wait);
+
+// Years before this one are cold; 0 when every year is read on load
+int storage_horizon_year(void);
+// Bring the cold shards of years from..to into the list, each once per
+// load. Returns the number of appointments added, -1 if a shard couldn't be
+// read.
+int storage_reach(AppointmentList *list, int from_year, int to_year);
+// Archive loads start over with storage_forget_shards. storage_read_hot
+// reads the manifest, then returns the loose member and the hot shards as
+// one ICS text, and the todo member in todos, for the caller to parse and
+// free; NULL if a member is missing or damaged. A damaged shard only leaves
+// its year out. A NULL archive reads the members unpacked in the working
+// directory.
+void storage_forget_shards(void);
+char *storage_read_hot(Archive *archive, char **todos);
+
+// 1 once a checksum hasn't matched; the next save first copies the archive
+// to DAMAGED_ARCHIVE_NAME
+int storage_damaged(void);
+
+// Check every member the archive's manifest lists against its CRC-32C,
+// reporting each to out. Returns the number of members that failed, -1 if
+// the archive can't be read at all.
+int storage_verify(const char *path, FILE *out);
+
 // Helper functions for format conversion
 int save_appointments_as_ics(AppointmentList *list, const char *filename);
 int load_appointments_from_ics(AppointmentList *list, const char *filename);
 int save_todos_as_csv(TodoList *list, const char *filename);
 int load_todos_from_csv(TodoList *list, const char *filename);
 
+// Text-level helpers, shared with the incremental reload in sync.c. The
+// parsers modify the text in place; parse_ics_event takes the lines between
+// one BEGIN:VEVENT and its END:VEVENT and returns 1 if they had a SUMMARY.
+char *read_text_file(const char *filename);
+int parse_ics_event(char *text, Appointment *appointment);
+int parse_todos_csv(TodoList *list, char *text);
+
+// ICS output, shared with `wcal agenda --format ics`
+void write_ics_header(FILE *file);
+void write_ics_event(FILE *file, const Appointment *appointment);
+void write_ics_footer(FILE *file);
+
 #endif // STORAGE_H
\ No newline at end of file
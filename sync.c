@@ -0,0 +1,513 @@
+#include "sync.h"
+#include "storage.h"
+#include "archive.h"
+#include "trace.h"
+#include "wmem.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "compat.h"
+
+#define HASH_MULTIPLIER 0x9E3779B97F4A7C15ULL
+
+// Read size when streaming an ICS file through a diff
+#define SYNC_CHUNK (256 * 1024)
+
+// Work collected while walking the new text, applied to the list at the end
+typedef struct {
+    Appointment *adds;
+    int add_count;
+    int add_capacity;
+    int *removes;                   // List indices, in the order found
+    int remove_count;
+    int remove_capacity;
+    unsigned char *taken;           // Per list index: already queued for removal
+} SyncBatch;
+
+static unsigned long long mix64(unsigned long long h) {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// Eight bytes a step, so hashing every event of a large file stays cheap.
+// Only used to notice changes, never trusted with anything adversarial.
+static unsigned long long hash_bytes(const char *data, size_t length, unsigned long long seed) {
+    unsigned long long h = seed ^ (length * HASH_MULTIPLIER);
+    unsigned long long word;
+
+    while (length >= 8) {
+        memcpy(&word, data, 8);
+        h = (h ^ word) * HASH_MULTIPLIER;
+        h ^= h >> 29;
+        data += 8;
+        length -= 8;
+    }
+    word = 0;
+    memcpy(&word, data, length);
+    return mix64((h ^ word) * HASH_MULTIPLIER);
+}
+
+// Identifies an appointment in the list once its start has narrowed it down
+static unsigned long long appointment_hash(const Appointment *app) {
+    unsigned long long seed = ((unsigned long long)(unsigned int)app->duration_minutes << 32) |
+                              (unsigned int)app->reminder_minutes;
+    return hash_bytes(app->description, strlen(app->description), seed);
+}
+
+void ics_index_init(IcsIndex *index) {
+    memset(index, 0, sizeof(*index));
+}
+
+void ics_index_free(IcsIndex *index) {
+    wmem_free(index->events);
+    wmem_free(index->slots);
+    ics_index_init(index);
+}
+
+// The slot holding key, or the free slot where it would go
+static int find_slot(const IcsIndex *index, unsigned long long key) {
+    int mask = index->slot_capacity - 1;
+    int slot = (int)(key & mask);
+
+    while (index->slots[slot] >= 0 && index->events[index->slots[slot]].key != key) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+// Make room for one more event
+static int reserve_event(IcsIndex *index) {
+    if (index->count >= index->capacity) {
+        int capacity = index->capacity ? index->capacity * 2 : 64;
+        SyncEvent *events = (SyncEvent*)wmem_realloc(MEM_INDEXES, index->events, sizeof(SyncEvent) * capacity);
+        if (!events) return 0;
+        index->events = events;
+        index->capacity = capacity;
+    }
+
+    if ((index->count + 1) * 2 > index->slot_capacity) {
+        int capacity = index->slot_capacity ? index->slot_capacity * 2 : 128;
+        int *slots = (int*)wmem_malloc(MEM_INDEXES, sizeof(int) * capacity);
+        if (!slots) return 0;
+
+        wmem_free(index->slots);
+        index->slots = slots;
+        index->slot_capacity = capacity;
+        memset(slots, -1, sizeof(int) * capacity);
+        for (int i = 0; i < index->count; i++) {
+            slots[find_slot(index, index->events[i].key)] = i;
+        }
+    }
+    return 1;
+}
+
+// Backward-shift deletion: later entries of the probe run move into the
+// hole, so lookups never need tombstones
+static void remove_slot(IcsIndex *index, int slot) {
+    int mask = index->slot_capacity - 1;
+    int hole = slot;
+
+    for (int next = (hole + 1) & mask; index->slots[next] >= 0; next = (next + 1) & mask) {
+        int home = (int)(index->events[index->slots[next]].key & mask);
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            index->slots[hole] = index->slots[next];
+            hole = next;
+        }
+    }
+    index->slots[hole] = -1;
+}
+
+// The last event takes the removed one's place
+static void remove_event(IcsIndex *index, int e) {
+    int last = index->count - 1;
+
+    remove_slot(index, find_slot(index, index->events[e].key));
+    if (e != last) {
+        index->slots[find_slot(index, index->events[last].key)] = e;
+        index->events[e] = index->events[last];
+    }
+    index->count--;
+}
+
+// One VEVENT found by scan_event
+typedef struct {
+    char *body;                     // Its lines, after BEGIN:VEVENT
+    char *end;                      // Its END:VEVENT line
+    unsigned long long key;         // UID plus RECURRENCE-ID, 0 without a UID
+} EventSpan;
+
+static int line_is(const char *line, const char *marker, size_t length) {
+    return strncmp(line, marker, length) == 0 && (line[length] == '\r' || line[length] == '\n' || line[length] == '\0');
+}
+
+// Hash of a property's value, which follows any parameters
+static unsigned long long property_hash(const char *line, const char *next) {
+    const char *value = (const char*)memchr(line, ':', next - line);
+    if (!value) return 0;
+
+    const char *value_end = next;
+    while (value_end > value + 1 && (value_end[-1] == '\n' || value_end[-1] == '\r' || value_end[-1] == ' ')) value_end--;
+    return hash_bytes(value + 1, value_end - value - 1, 0) | 1;
+}
+
+// Find the next VEVENT in one pass over the lines, picking up its key on the
+// way. The RECURRENCE-ID tells the occurrences of a recurring event apart.
+// Unless the text is final, a last line without its newline is unfinished;
+// at the end *cursor is left where the unfinished part starts.
+static int scan_event(char **cursor, EventSpan *span, int final) {
+    char *line = *cursor;
+    unsigned long long uid = 0;
+    unsigned long long recurrence = 0;
+    char *begin = NULL;
+
+    span->body = NULL;
+    while (*line) {
+        char *next = strchr(line, '\n');
+        if (!next && !final) break;
+        next = next ? next + 1 : line + strlen(line);
+
+        if (!span->body) {
+            if (line[0] == 'B' && line_is(line, "BEGIN:VEVENT", 12)) {
+                begin = line;
+                span->body = next;
+            }
+        } else if (line[0] == 'E' && line_is(line, "END:VEVENT", 10)) {
+            span->end = line;
+            span->key = uid ? mix64(uid ^ (recurrence * HASH_MULTIPLIER)) : 0;
+            *cursor = next;
+            return 1;
+        } else if (line[0] == 'U' && !uid && strncmp(line, "UID", 3) == 0 && (line[3] == ':' || line[3] == ';')) {
+            uid = property_hash(line, next);
+        } else if (line[0] == 'R' && strncmp(line, "RECURRENCE-ID", 13) == 0 && (line[13] == ':' || line[13] == ';')) {
+            recurrence = property_hash(line, next);
+        }
+        line = next;
+    }
+
+    // An event cut short starts again from its BEGIN line next time
+    *cursor = span->body ? begin : line;
+    return 0;
+}
+
+static int queue_add(SyncBatch *batch, const Appointment *app) {
+    if (batch->add_count >= batch->add_capacity) {
+        int capacity = batch->add_capacity ? batch->add_capacity * 2 : 64;
+        Appointment *adds = (Appointment*)wmem_realloc(MEM_INDEXES, batch->adds, sizeof(Appointment) * capacity);
+        if (!adds) return 0;
+        batch->adds = adds;
+        batch->add_capacity = capacity;
+    }
+    batch->adds[batch->add_count++] = *app;
+    return 1;
+}
+
+// Queue the list entry an event produced last time. Entries edited in wcal
+// since no longer match, and stay.
+static int queue_removal(SyncBatch *batch, AppointmentList *list, const SyncEvent *event) {
+    if (!batch->taken) {
+        batch->taken = (unsigned char*)wmem_calloc(MEM_INDEXES, list->count + 1, 1);
+        if (!batch->taken) return 0;
+    }
+
+    for (int i = find_first_appointment_at(list, event->start); i < list->count; i++) {
+        if (compare_datetimes(list->items[i].date_time, event->start) != 0) break;
+        if (batch->taken[i] || appointment_hash(&list->items[i]) != event->app_hash) continue;
+
+        if (batch->remove_count >= batch->remove_capacity) {
+            int capacity = batch->remove_capacity ? batch->remove_capacity * 2 : 64;
+            int *removes = (int*)wmem_realloc(MEM_INDEXES, batch->removes, sizeof(int) * capacity);
+            if (!removes) return 0;
+            batch->removes = removes;
+            batch->remove_capacity = capacity;
+        }
+        batch->removes[batch->remove_count++] = i;
+        batch->taken[i] = 1;
+        break;
+    }
+    return 1;
+}
+
+static int compare_indices(const void *a, const void *b) {
+    return *(const int*)a - *(const int*)b;
+}
+
+// A diff in progress; the new text may arrive in several pieces
+typedef struct {
+    IcsIndex *index;
+    AppointmentList *list;
+    SyncStats *stats;
+    SyncBatch batch;
+    unsigned int generation;
+    int old_count;                  // Events indexed before this diff
+    int matched;                    // Of those, seen again so far
+    int expected;                   // The event predicted to come next
+    int apply;                      // 0: only bring the index up to date
+    int failed;                     // Out of memory
+} SyncDiff;
+
+static void diff_begin(SyncDiff *diff, IcsIndex *index, AppointmentList *list, SyncStats *stats, int apply) {
+    memset(diff, 0, sizeof(*diff));
+    memset(stats, 0, sizeof(*stats));
+    diff->index = index;
+    diff->list = list;
+    diff->stats = stats;
+    diff->generation = index->generation + 1;
+    diff->old_count = index->count;
+    diff->apply = apply;
+}
+
+// The indexed event a key belongs to, -1 for a new one
+static int match_event(SyncDiff *diff, unsigned long long *key) {
+    IcsIndex *index = diff->index;
+    int e = diff->expected;
+
+    // Unchanged stretches of the file arrive in the order they were indexed
+    if (e < index->count && index->events[e].key == *key && index->events[e].seen != diff->generation) return e;
+
+    // A repeated key (the same event exported twice) gets a key of its own
+    // per repeat, so repeats match up in order
+    for (;;) {
+        e = index->slots[find_slot(index, *key)];
+        if (e < 0 || index->events[e].seen != diff->generation) return e;
+        *key = mix64(*key + 1);
+        if (!*key) *key = 1;
+    }
+}
+
+static void diff_event(SyncDiff *diff, const EventSpan *span) {
+    IcsIndex *index = diff->index;
+    unsigned long long block_hash = hash_bytes(span->body, span->end - span->body, 0);
+    unsigned long long key = span->key ? span->key : block_hash;
+
+    if (!key) key = 1;
+    if (!reserve_event(index)) {
+        diff->failed = 1;
+        return;
+    }
+
+    int e = match_event(diff, &key);
+    SyncEvent *event = e >= 0 ? &index->events[e] : NULL;
+    if (event) {
+        diff->matched++;
+        diff->expected = e + 1;
+        if (event->block_hash == block_hash) {
+            event->seen = diff->generation;
+            return;
+        }
+    }
+
+    // New or changed: only now is the event parsed. Its END line has been
+    // found, so the parser may end the text there.
+    Appointment app;
+    *span->end = '\0';
+    int parsed = parse_ics_event(span->body, &app);
+    unsigned long long app_hash = parsed ? appointment_hash(&app) : 0;
+
+    // Only the text moved (a new DTSTAMP, say); the appointment is the same
+    if (event && parsed == event->parsed &&
+        (!parsed || (app_hash == event->app_hash && compare_datetimes(app.date_time, event->start) == 0))) {
+        event->block_hash = block_hash;
+        event->seen = diff->generation;
+        return;
+    }
+
+    // The list changes are queued before the index records the new version
+    if (diff->apply && ((event && event->parsed && !queue_removal(&diff->batch, diff->list, event)) ||
+                        (parsed && !queue_add(&diff->batch, &app)))) {
+        diff->failed = 1;
+        return;
+    }
+
+    if (event) {
+        diff->stats->changed++;
+    } else {
+        e = index->count++;
+        index->slots[find_slot(index, key)] = e;
+        event = &index->events[e];
+        event->key = key;
+        diff->expected = e + 1;
+        diff->stats->added++;
+    }
+
+    event->block_hash = block_hash;
+    event->app_hash = app_hash;
+    event->start = app.date_time;
+    event->parsed = parsed;
+    event->seen = diff->generation;
+}
+
+// Diff every complete event in the text; returns where the unfinished rest starts
+static char *diff_feed(SyncDiff *diff, char *text, int final) {
+    char *cursor = text;
+    EventSpan span;
+
+    while (!diff->failed && scan_event(&cursor, &span, final)) {
+        diff_event(diff, &span);
+    }
+    return cursor;
+}
+
+// Apply the collected changes. Only a diff that saw all of the new text
+// may conclude that the events it didn't see are gone.
+static int diff_finish(SyncDiff *diff, int complete) {
+    IcsIndex *index = diff->index;
+    SyncBatch *batch = &diff->batch;
+    int result = 0;
+
+    if (complete && !diff->failed && diff->matched < diff->old_count) {
+        for (int e = 0; e < index->count; ) {
+            SyncEvent *event = &index->events[e];
+            if (event->seen == diff->generation) {
+                e++;
+                continue;
+            }
+            if (diff->apply && event->parsed && !queue_removal(batch, diff->list, event)) {
+                diff->failed = 1;
+                break;
+            }
+            diff->stats->removed++;
+
+            // The last event moves into this place; look again
+            remove_event(index, e);
+        }
+    }
+
+    // Removal indices refer to the list as it is now, so they go first.
+    // Running out of memory part way can leave the index describing an
+    // appointment the list doesn't have (or no longer has).
+    if (batch->remove_count > 1) qsort(batch->removes, batch->remove_count, sizeof(int), compare_indices);
+    result = delete_appointments(diff->list, batch->removes, batch->remove_count) &&
+             add_appointments(diff->list, batch->adds, batch->add_count) && !diff->failed;
+
+    index->generation = diff->generation;
+    wmem_free(batch->adds);
+    wmem_free(batch->removes);
+    wmem_free(batch->taken);
+    return result;
+}
+
+int sync_ics(IcsIndex *index, AppointmentList *list, char *text, SyncStats *stats) {
+    SyncDiff diff;
+
+    diff_begin(&diff, index, list, stats, 1);
+    diff_feed(&diff, text, 1);
+    return diff_finish(&diff, 1);
+}
+
+// Feed a file through the diff a chunk at a time. The buffer is small
+// enough to stay in cache while it is scanned, which a copy of a large
+// file would not; it only grows for an event longer than a chunk.
+static int diff_file(SyncDiff *diff, FILE *file) {
+    size_t capacity = SYNC_CHUNK;
+    size_t used = 0;
+    int final = 0;
+    char *buffer = (char*)malloc(capacity + 1);
+
+    while (buffer && !final && !diff->failed) {
+        if (used == capacity) {
+            char *grown = (char*)realloc(buffer, capacity * 2 + 1);
+            if (!grown) {
+                diff->failed = 1;
+                break;
+            }
+            buffer = grown;
+            capacity *= 2;
+        }
+
+        size_t length = fread(buffer + used, 1, capacity - used, file);
+        final = length < capacity - used;
+        used += length;
+        buffer[used] = '\0';
+
+        char *rest = diff_feed(diff, buffer, final);
+        used -= rest - buffer;
+        memmove(buffer, rest, used);
+    }
+
+    free(buffer);
+    return final && !ferror(file);
+}
+
+// Diff the source's current contents against the index
+static int diff_source(SyncSource *source, SyncStats *stats, int apply) {
+    SyncDiff diff;
+    Archive archive;
+    FILE *file;
+    int result = 0;
+
+    memset(stats, 0, sizeof(*stats));
+    if (!source->path[0]) return 0;
+
+    if (!source->todos) {
+        if (fopen_s(&file, source->path, "rb") != 0) return 0;
+        diff_begin(&diff, &source->index, source->appointments, stats, apply);
+        int complete = diff_file(&diff, file);
+        fclose(file);
+        return diff_finish(&diff, complete) && complete;
+    }
+
+    // The archive's hot members are decoded whole; cold shards are left to
+    // storage_reach
+    if (!archive_open(&archive, source->path)) return 0;
+    char *csv;
+    char *ics = storage_read_hot(&archive, &csv);
+    archive_close(&archive);
+
+    if (ics) {
+        diff_begin(&diff, &source->index, source->appointments, stats, apply);
+        diff_feed(&diff, ics, 1);
+        result = diff_finish(&diff, 1);
+
+        // Todos carry no identity to diff on and the list is small, so it is
+        // replaced whole whenever its text changed
+        unsigned long long todo_hash = hash_bytes(csv, strlen(csv), 0);
+        if (result && todo_hash != source->todo_hash) {
+            if (apply) {
+                result = parse_todos_csv(source->todos, csv);
+                stats->todos_reloaded = 1;
+            }
+            source->todo_hash = todo_hash;
+        }
+    }
+
+    free(ics);
+    free(csv);
+    return result;
+}
+
+static int load_source(SyncSource *source, SyncStats *stats, int apply) {
+    unsigned long long span = trace_begin();
+    int result = diff_source(source, stats, apply);
+    trace_end(TRACE_SYNC, span);
+    return result;
+}
+
+int sync_open(SyncSource *source, const char *path, AppointmentList *appointments, TodoList *todos) {
+    SyncStats stats;
+
+    memset(source, 0, sizeof(*source));
+    strcpy_s(source->path, sizeof(source->path), path);
+    source->appointments = appointments;
+    source->todos = todos;
+    ics_index_init(&source->index);
+    if (todos) storage_forget_shards();
+    return load_source(source, &stats, 1);
+}
+
+int sync_reload(SyncSource *source, SyncStats *stats) {
+    return load_source(source, stats, 1);
+}
+
+int sync_rebase(SyncSource *source) {
+    SyncStats stats;
+    return load_source(source, &stats, 0);
+}
+
+void sync_close(SyncSource *source) {
+    ics_index_free(&source->index);
+    memset(source, 0, sizeof(*source));
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+#ifndef SYNC_H
+#define SYNC_H
+
+#include "calendar.h"
+#include "appointments.h"
+#include "todo.h"
+
+#define MAX_SYNC_PATH 260
+
+// One VEVENT as it was when last applied to the list
+typedef struct {
+    unsigned long long key;         // Hash of the UID (and RECURRENCE-ID), never 0
+    unsigned long long block_hash;  // Hash of the event's whole text
+    unsigned long long app_hash;    // Hash of the appointment it produced, to find it again
+    DateTime start;
+    unsigned int seen;              // Generation of the last sync that saw the event
+    int parsed;                     // The event produced an appointment (it had a SUMMARY)
+} SyncEvent;
+
+// The events of one ICS source. They are kept densely, in the order the file
+// had them, so an unchanged stretch of file is matched by walking forward;
+// slots (open addressing by key, -1 for free, at most half full) find the
+// rest.
+typedef struct {
+    SyncEvent *events;
+    int count;
+    int capacity;
+    int *slots;
+    int slot_capacity;              // A power of two
+    unsigned int generation;
+} IcsIndex;
+
+typedef struct {
+    int added;
+    int changed;
+    int removed;
+    int todos_reloaded;             // Archive sources: the todos were replaced
+} SyncStats;
+
+// A file mirrored in memory: an ICS calendar, or the data archive with its
+// appointments and todos. The appointment list may also hold entries that
+// never came from the file (the user's own edits); syncing leaves those be.
+typedef struct {
+    char path[MAX_SYNC_PATH];       // Empty when the source isn't being tracked
+    AppointmentList *appointments;
+    TodoList *todos;                // Set for the data archive
+    IcsIndex index;
+    unsigned long long todo_hash;
+} SyncSource;
+
+void ics_index_init(IcsIndex *index);
+void ics_index_free(IcsIndex *index);
+
+// Bring the list in line with new ICS text (modified in place). Only events
+// whose UID is new or gone, or whose text changed, are parsed and touched in
+// the list; into an empty index this is a plain load. Appointments the user
+// edited since no longer match their event and are left alone. Returns 0
+// when out of memory.
+int sync_ics(IcsIndex *index, AppointmentList *list, char *text, SyncStats *stats);
+
+// Load a source. todos is NULL for an ICS file; otherwise path is an archive
+// holding both. Returns 0 if it couldn't be read; the path is kept either
+// way, so a file that appears later is picked up by sync_reload.
+int sync_open(SyncSource *source, const char *path, AppointmentList *appointments, TodoList *todos);
+// Re-read the file and apply what changed. Returns 0 while the file can't
+// be read (it may be mid-write); nothing is touched if it couldn't be opened,
+// and nothing is taken as removed unless it was read to the end.
+int sync_reload(SyncSource *source, SyncStats *stats);
+// The file was just written from the list: index it as it now is, without
+// touching the list, so the next reload doesn't see wcal's own changes
+int sync_rebase(SyncSource *source);
+void sync_close(SyncSource *source);
+
+#endif // SYNC_H
\ No newline at end of file
@@ -0,0 +1,61 @@
+#ifndef TERM_H
+#define TERM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "render.h"
+
+// Key codes returned by term_read_key (special keys are offset by 256)
+#define KEY_UP      (72 + 256)
+#define KEY_DOWN    (80 + 256)
+#define KEY_LEFT    (75 + 256)
+#define KEY_RIGHT   (77 + 256)
+#define KEY_PGUP    (73 + 256)
+#define KEY_PGDN    (81 + 256)
+#define KEY_HOME    (71 + 256)
+#define KEY_END     (79 + 256)
+#define KEY_TAB     9
+#define KEY_ENTER   13
+#define KEY_ESC     27
+#define KEY_SPACE   32
+#define KEY_BACKSPACE 8
+#define KEY_NONE    (-1)    // Input closed
+#define KEY_IGNORED (-2)    // A key wcal has no use for (F1, Insert, ...)
+
+// Events delivered by term_wait_event
+typedef enum {
+    TERM_EVENT_TIMEOUT,
+    TERM_EVENT_KEY,
+    TERM_EVENT_RESIZE,
+    TERM_EVENT_WATCH    // One of the handles given to term_watch_handles is ready
+} TermEventType;
+
+// Most extra handles term_wait_event can wait on
+#define TERM_MAX_WATCH_HANDLES 8
+
+typedef struct {
+    TermEventType type;
+    int key;            // Key code for TERM_EVENT_KEY
+} TermEvent;
+
+// Terminal backend. Implemented by term_win32.c (Windows console) and
+// term_ansi.c (termios + ANSI escape sequences) - exactly one is compiled in.
+int term_init(void);
+void term_restore(void);
+void term_get_size(int *width, int *height);
+
+// Output: runs are queued by the frame buffer flush and sent by term_present
+void term_resize_frame(int width, int height);
+void term_draw_run(int x, int y, const Cell *cells, int count);
+size_t term_present(int cursor_visible, int cursor_x, int cursor_y);
+
+// Input. term_wait_event blocks until a key press, a resize or until
+// timeout_ms elapses (-1 waits forever); term_read_key blocks for a key.
+void term_wait_event(int timeout_ms, TermEvent *event);
+int term_read_key(void);
+
+// Extra handles that wake term_wait_event: file descriptors on POSIX,
+// HANDLEs on Windows. Reading or re-arming them is up to the caller.
+void term_watch_handles(const intptr_t *handles, int count);
+
+#endif // TERM_H
\ No newline at end of file
@@ -0,0 +1,417 @@
+#ifndef _WIN32
+#include "term.h"
+#include "wmem.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+// How long to wait for the rest of an escape sequence before treating ESC as a key
+#define ESCAPE_TIMEOUT_MS 25
+
+// Default size when stdout is not a terminal
+#define FALLBACK_WIDTH  140
+#define FALLBACK_HEIGHT 30
+
+static struct termios g_saved_termios;
+static int g_termios_saved = 0;
+
+// Whole frame is encoded here and sent with one write() in term_present
+static char *g_out = NULL;
+static size_t g_out_len = 0;
+static size_t g_out_capacity = 0;
+
+// SIGWINCH writes a byte here so resizes wake up poll() like input does
+static int g_resize_pipe[2] = {-1, -1};
+
+// Descriptors from term_watch_handles, polled alongside the input
+static int g_watch_fds[TERM_MAX_WATCH_HANDLES];
+static int g_watch_count = 0;
+
+static int g_current_attr = -1;     // SGR state the terminal is in, -1 = unknown
+static int g_cursor_visible = -1;
+static int g_pushed_byte = -1;      // Read after an ESC it didn't belong to; the next key
+
+// Console attributes use the Windows bit order (blue = 1, red = 4); ANSI is the reverse
+static const int ansi_colors[8] = {0, 4, 2, 6, 1, 5, 3, 7};
+
+static void out_append(const char *data, size_t len) {
+    if (g_out_len + len > g_out_capacity) {
+        size_t capacity = g_out_capacity ? g_out_capacity : 4096;
+        while (capacity < g_out_len + len) capacity *= 2;
+        char *out = (char*)wmem_realloc(MEM_RENDER, g_out, capacity);
+        if (!out) return;
+        g_out = out;
+        g_out_capacity = capacity;
+    }
+    memcpy(g_out + g_out_len, data, len);
+    g_out_len += len;
+}
+
+static void out_string(const char *text) {
+    out_append(text, strlen(text));
+}
+
+static void out_write(void) {
+    size_t written = 0;
+    while (written < g_out_len) {
+        ssize_t n = write(STDOUT_FILENO, g_out + written, g_out_len - written);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        written += (size_t)n;
+    }
+    g_out_len = 0;
+}
+
+static void out_attr(unsigned char attr) {
+    char sequence[32];
+    int fg = attr & 0x0F;
+    int bg = (attr >> 4) & 0x0F;
+
+    snprintf(sequence, sizeof(sequence), "\x1b[0;%d;%dm",
+             (fg & 8 ? 90 : 30) + ansi_colors[fg & 7],
+             (bg & 8 ? 100 : 40) + ansi_colors[bg & 7]);
+    out_string(sequence);
+    g_current_attr = attr;
+}
+
+// Cells hold code page 437 characters; translate the box drawing ones to UTF-8
+static void out_char(char ch) {
+    switch ((unsigned char)ch) {
+        case 0xB3: out_string("\xE2\x94\x82"); break;  // vertical
+        case 0xC4: out_string("\xE2\x94\x80"); break;  // horizontal
+        case 0xDA: out_string("\xE2\x94\x8C"); break;  // top left
+        case 0xBF: out_string("\xE2\x94\x90"); break;  // top right
+        case 0xC0: out_string("\xE2\x94\x94"); break;  // bottom left
+        case 0xD9: out_string("\xE2\x94\x98"); break;  // bottom right
+        case 0xC5: out_string("\xE2\x94\xBC"); break;  // cross
+        case 0xC2: out_string("\xE2\x94\xAC"); break;  // T down
+        case 0xC1: out_string("\xE2\x94\xB4"); break;  // T up
+        case 0xC3: out_string("\xE2\x94\x9C"); break;  // T right
+        case 0xB4: out_string("\xE2\x94\xA4"); break;  // T left
+        default:
+            if ((unsigned char)ch < 32 || (unsigned char)ch >= 127) ch = '?';
+            out_append(&ch, 1);
+            break;
+    }
+}
+
+static void handle_resize_signal(int signal_number) {
+    char byte = 1;
+    int saved_errno = errno;
+    if (write(g_resize_pipe[1], &byte, 1) < 0) {
+        // Pipe full - a resize is already pending
+    }
+    errno = saved_errno;
+}
+
+int term_init(void) {
+    if (tcgetattr(STDIN_FILENO, &g_saved_termios) == 0) {
+        struct termios raw = g_saved_termios;
+
+        // Byte-at-a-time input without echo; keep ISIG so Ctrl+C still works
+        raw.c_iflag &= ~(ICRNL | IXON | INLCR | ISTRIP);
+        raw.c_lflag &= ~(ICANON | ECHO | IEXTEN);
+        raw.c_cc[VMIN] = 1;
+        raw.c_cc[VTIME] = 0;
+        tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw);
+        g_termios_saved = 1;
+    }
+
+    if (pipe(g_resize_pipe) == 0) {
+        fcntl(g_resize_pipe[0], F_SETFL, O_NONBLOCK);
+        fcntl(g_resize_pipe[1], F_SETFL, O_NONBLOCK);
+
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_handler = handle_resize_signal;
+        action.sa_flags = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGWINCH, &action, NULL);
+    }
+
+    // Alternate screen so the shell's scrollback survives
+    out_string("\x1b[?1049h\x1b[2J");
+    out_write();
+    g_current_attr = -1;
+    g_cursor_visible = -1;
+
+    return 1;
+}
+
+void term_restore(void) {
+    out_string("\x1b[0m\x1b[?25h\x1b[?1049l");
+    out_write();
+
+    if (g_termios_saved) {
+        tcsetattr(STDIN_FILENO, TCSAFLUSH, &g_saved_termios);
+        g_termios_saved = 0;
+    }
+
+    if (g_resize_pipe[0] >= 0) {
+        signal(SIGWINCH, SIG_DFL);
+        close(g_resize_pipe[0]);
+        close(g_resize_pipe[1]);
+        g_resize_pipe[0] = g_resize_pipe[1] = -1;
+    }
+
+    wmem_free(g_out);
+    g_out = NULL;
+    g_out_len = 0;
+    g_out_capacity = 0;
+}
+
+void term_get_size(int *width, int *height) {
+    struct winsize ws;
+
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0 && ws.ws_row > 0) {
+        *width = ws.ws_col;
+        *height = ws.ws_row;
+    } else {
+        *width = FALLBACK_WIDTH;
+        *height = FALLBACK_HEIGHT;
+    }
+}
+
+void term_resize_frame(int width, int height) {
+    // The terminal keeps no mirror; just forget the SGR state after a resize
+    g_current_attr = -1;
+}
+
+void term_draw_run(int x, int y, const Cell *cells, int count) {
+    char sequence[32];
+
+    snprintf(sequence, sizeof(sequence), "\x1b[%d;%dH", y + 1, x + 1);
+    out_string(sequence);
+
+    for (int i = 0; i < count; i++) {
+        if (cells[i].attr != g_current_attr) {
+            out_attr(cells[i].attr);
+        }
+        out_char(cells[i].ch);
+    }
+}
+
+size_t term_present(int cursor_visible, int cursor_x, int cursor_y) {
+    if (cursor_visible) {
+        char sequence[32];
+        snprintf(sequence, sizeof(sequence), "\x1b[%d;%dH", cursor_y + 1, cursor_x + 1);
+        out_string(sequence);
+    }
+
+    if (cursor_visible != g_cursor_visible) {
+        out_string(cursor_visible ? "\x1b[?25h" : "\x1b[?25l");
+        g_cursor_visible = cursor_visible;
+    }
+
+    size_t bytes = g_out_len;
+    out_write();
+    return bytes;
+}
+
+static int wait_for_input(int timeout_ms) {
+    struct pollfd pfd;
+    pfd.fd = STDIN_FILENO;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    int result;
+    do {
+        result = poll(&pfd, 1, timeout_ms);
+    } while (result < 0 && errno == EINTR);
+
+    return result > 0;
+}
+
+static int read_byte(void) {
+    unsigned char ch;
+    ssize_t n;
+
+    if (g_pushed_byte >= 0) {
+        int pushed = g_pushed_byte;
+        g_pushed_byte = -1;
+        return pushed;
+    }
+
+    do {
+        n = read(STDIN_FILENO, &ch, 1);
+    } while (n < 0 && errno == EINTR);
+
+    return n == 1 ? ch : -1;
+}
+
+// A sequence arrives in one piece; a pause means it was cut short
+static int read_sequence_byte(void) {
+    return wait_for_input(ESCAPE_TIMEOUT_MS) ? read_byte() : -1;
+}
+
+// Decode the tail of an ESC [ or ESC O sequence: parameter and intermediate
+// bytes up to the final byte, which names the key. Modifiers come as further
+// ;-separated parameters (ESC [1;5C is Ctrl+Right) and are ignored, so only
+// the first parameter counts. Returns 0, with the sequence consumed, for
+// keys wcal doesn't use; a byte that can't belong to one is pushed back.
+static int read_escape_sequence(void) {
+    int ch = read_sequence_byte();
+    int number = 0;
+    int first = 1;
+
+    while (ch >= 0x20 && ch <= 0x3F) {
+        if (ch >= '0' && ch <= '9' && first) {
+            number = number * 10 + (ch - '0');
+        } else {
+            first = 0;
+        }
+        ch = read_sequence_byte();
+    }
+
+    if (ch < 0x40 || ch > 0x7E) {
+        if (ch >= 0) g_pushed_byte = ch;
+        return 0;
+    }
+
+    switch (ch) {
+        case 'A': return KEY_UP;
+        case 'B': return KEY_DOWN;
+        case 'C': return KEY_RIGHT;
+        case 'D': return KEY_LEFT;
+        case 'H': return KEY_HOME;
+        case 'F': return KEY_END;
+        case '~':
+            switch (number) {
+                case 1: case 7: return KEY_HOME;
+                case 4: case 8: return KEY_END;
+                case 5: return KEY_PGUP;
+                case 6: return KEY_PGDN;
+            }
+            break;
+    }
+
+    return 0;
+}
+
+int term_read_key(void) {
+    while (1) {
+        int ch = read_byte();
+
+        if (ch < 0) return KEY_NONE;
+        if (ch == 127) return KEY_BACKSPACE;
+        if (ch == '\n') return KEY_ENTER;
+        if (ch != KEY_ESC) return ch;
+
+        // Lone ESC or the start of an escape sequence
+        if (!wait_for_input(ESCAPE_TIMEOUT_MS)) return KEY_ESC;
+
+        int next = read_byte();
+        if (next == '[' || next == 'O') {
+            int key = read_escape_sequence();
+            if (key) return key;
+            // Unknown sequence: read on only if another key is already here,
+            // so the caller never blocks outside its poll
+            if (g_pushed_byte >= 0 || wait_for_input(0)) continue;
+            return KEY_IGNORED;
+        }
+
+        // Not a sequence: the byte after ESC is the next key
+        if (next >= 0) g_pushed_byte = next;
+        return KEY_ESC;
+    }
+}
+static long long monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+void term_watch_handles(const intptr_t *handles, int count) {
+    if (count > TERM_MAX_WATCH_HANDLES) count = TERM_MAX_WATCH_HANDLES;
+    for (int i = 0; i < count; i++) {
+        g_watch_fds[i] = (int)handles[i];
+    }
+    g_watch_count = count;
+}
+
+void term_wait_event(int timeout_ms, TermEvent *event) {
+    long long deadline = timeout_ms >= 0 ? monotonic_ms() + timeout_ms : -1;
+    struct pollfd fds[2 + TERM_MAX_WATCH_HANDLES];
+    int resize = -1;
+    int watch;
+    int count = 1;
+
+    fds[0].fd = STDIN_FILENO;
+    fds[0].events = POLLIN;
+    if (g_resize_pipe[0] >= 0) {
+        resize = count;
+        fds[count].fd = g_resize_pipe[0];
+        fds[count++].events = POLLIN;
+    }
+    watch = count;
+    for (int i = 0; i < g_watch_count; i++) {
+        fds[count].fd = g_watch_fds[i];
+        fds[count++].events = POLLIN;
+    }
+
+    event->key = 0;
+
+    // A byte pushed back is already waiting; poll wouldn't say so
+    if (g_pushed_byte >= 0) {
+        event->type = TERM_EVENT_KEY;
+        event->key = term_read_key();
+        return;
+    }
+
+    while (1) {
+        int wait = -1;
+        if (deadline >= 0) {
+            long long remaining = deadline - monotonic_ms();
+            wait = remaining > 0 ? (int)remaining : 0;
+        }
+
+        for (int i = 0; i < count; i++) {
+            fds[i].revents = 0;
+        }
+        int result = poll(fds, count, wait);
+
+        if (result < 0) {
+            if (errno == EINTR) continue;
+            event->type = TERM_EVENT_KEY;
+            event->key = KEY_NONE;
+            return;
+        }
+
+        if (result == 0) {
+            event->type = TERM_EVENT_TIMEOUT;
+            return;
+        }
+
+        if (resize >= 0 && (fds[resize].revents & POLLIN)) {
+            char drain[64];
+            while (read(g_resize_pipe[0], drain, sizeof(drain)) > 0) {
+            }
+            event->type = TERM_EVENT_RESIZE;
+            return;
+        }
+
+        if (fds[0].revents) {
+            event->type = TERM_EVENT_KEY;
+            event->key = term_read_key();
+            return;
+        }
+
+        for (int i = watch; i < count; i++) {
+            if (fds[i].revents) {
+                event->type = TERM_EVENT_WATCH;
+                return;
+            }
+        }
+    }
+}
+#endif // _WIN32
\ No newline at end of file
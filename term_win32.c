@@ -0,0 +1,244 @@
+#ifdef _WIN32
+#include "term.h"
+#include "wmem.h"
+#include <windows.h>
+#include <stdlib.h>
+
+// Off-screen copy of the console contents; changed runs are copied in here
+// and the dirty rectangle is written back with a single WriteConsoleOutput
+static CHAR_INFO *g_console_cells = NULL;
+static int g_console_width = 0;
+static int g_console_height = 0;
+static SMALL_RECT g_console_dirty;
+static int g_console_has_dirty = 0;
+static int g_console_cursor_visible = -1;
+
+// Auto-repeat key events carry a count; the extra presses are handed out here
+static int g_pending_key = 0;
+static int g_pending_repeats = 0;
+
+// Handles from term_watch_handles, waited on after the input handle
+static HANDLE g_watch_handles[TERM_MAX_WATCH_HANDLES];
+static int g_watch_count = 0;
+
+int term_init(void) {
+    // Get console handles
+    HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
+    HANDLE hIn = GetStdHandle(STD_INPUT_HANDLE);
+
+    // First, set window size smaller to allow buffer resize
+    SMALL_RECT tempWindowSize = {0, 0, 79, 24};
+    SetConsoleWindowInfo(hOut, TRUE, &tempWindowSize);
+
+    // Set console buffer size to match desired window exactly (no scrollbars)
+    COORD bufferSize = {140, 30};
+    SetConsoleScreenBufferSize(hOut, bufferSize);
+
+    // Now set the window size to match buffer exactly
+    SMALL_RECT windowSize = {0, 0, 139, 29};  // 140x30 window
+    SetConsoleWindowInfo(hOut, TRUE, &windowSize);
+
+    // Set console mode
+    DWORD mode;
+    GetConsoleMode(hIn, &mode);
+    mode &= ~ENABLE_QUICK_EDIT_MODE; // Disable quick edit
+    mode |= ENABLE_EXTENDED_FLAGS;
+    mode |= ENABLE_WINDOW_INPUT;     // Report resizes as input events
+    SetConsoleMode(hIn, mode);
+
+    // Set console code page for box drawing characters
+    SetConsoleOutputCP(437);
+
+    return 1;
+}
+
+void term_restore(void) {
+    term_resize_frame(0, 0);
+}
+
+void term_get_size(int *width, int *height) {
+    CONSOLE_SCREEN_BUFFER_INFO csbi;
+    GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &csbi);
+    *width = csbi.srWindow.Right - csbi.srWindow.Left + 1;
+    *height = csbi.srWindow.Bottom - csbi.srWindow.Top + 1;
+}
+
+void term_resize_frame(int width, int height) {
+    wmem_free(g_console_cells);
+    g_console_cells = NULL;
+    g_console_width = 0;
+    g_console_height = 0;
+    g_console_has_dirty = 0;
+
+    if (width > 0 && height > 0) {
+        g_console_cells = (CHAR_INFO*)wmem_calloc(MEM_RENDER, width * height, sizeof(CHAR_INFO));
+        if (g_console_cells) {
+            g_console_width = width;
+            g_console_height = height;
+        }
+    }
+}
+
+void term_draw_run(int x, int y, const Cell *cells, int count) {
+    if (!g_console_cells || y >= g_console_height || x + count > g_console_width) return;
+
+    CHAR_INFO *dst = g_console_cells + y * g_console_width + x;
+    for (int i = 0; i < count; i++) {
+        dst[i].Char.AsciiChar = cells[i].ch;
+        dst[i].Attributes = cells[i].attr;
+    }
+
+    // Grow the dirty rectangle to cover this run
+    if (!g_console_has_dirty) {
+        g_console_dirty.Left = (SHORT)x;
+        g_console_dirty.Top = (SHORT)y;
+        g_console_dirty.Right = (SHORT)(x + count - 1);
+        g_console_dirty.Bottom = (SHORT)y;
+        g_console_has_dirty = 1;
+    } else {
+        if (x < g_console_dirty.Left) g_console_dirty.Left = (SHORT)x;
+        if (y < g_console_dirty.Top) g_console_dirty.Top = (SHORT)y;
+        if (x + count - 1 > g_console_dirty.Right) g_console_dirty.Right = (SHORT)(x + count - 1);
+        if (y > g_console_dirty.Bottom) g_console_dirty.Bottom = (SHORT)y;
+    }
+}
+
+size_t term_present(int cursor_visible, int cursor_x, int cursor_y) {
+    HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
+    size_t bytes = 0;
+
+    if (g_console_has_dirty) {
+        COORD buffer_size = {(SHORT)g_console_width, (SHORT)g_console_height};
+        COORD buffer_origin = {g_console_dirty.Left, g_console_dirty.Top};
+        SMALL_RECT region = g_console_dirty;
+
+        WriteConsoleOutputA(hOut, g_console_cells, buffer_size, buffer_origin, &region);
+        bytes = (size_t)(g_console_dirty.Right - g_console_dirty.Left + 1) *
+                (size_t)(g_console_dirty.Bottom - g_console_dirty.Top + 1) * sizeof(CHAR_INFO);
+        g_console_has_dirty = 0;
+    }
+
+    if (cursor_visible) {
+        COORD coord = {(SHORT)cursor_x, (SHORT)cursor_y};
+        SetConsoleCursorPosition(hOut, coord);
+    }
+
+    // Only touch cursor visibility when it actually changes
+    if (cursor_visible != g_console_cursor_visible) {
+        CONSOLE_CURSOR_INFO cursorInfo;
+        GetConsoleCursorInfo(hOut, &cursorInfo);
+        cursorInfo.bVisible = cursor_visible ? TRUE : FALSE;
+        SetConsoleCursorInfo(hOut, &cursorInfo);
+        g_console_cursor_visible = cursor_visible;
+    }
+
+    return bytes;
+}
+
+// Map a console key event to a key code, 0 for keys we ignore (shift, ctrl, ...)
+static int decode_key_event(const KEY_EVENT_RECORD *key_event) {
+    switch (key_event->wVirtualKeyCode) {
+        case VK_UP:    return KEY_UP;
+        case VK_DOWN:  return KEY_DOWN;
+        case VK_LEFT:  return KEY_LEFT;
+        case VK_RIGHT: return KEY_RIGHT;
+        case VK_PRIOR: return KEY_PGUP;
+        case VK_NEXT:  return KEY_PGDN;
+        case VK_HOME:  return KEY_HOME;
+        case VK_END:   return KEY_END;
+    }
+
+    return (unsigned char)key_event->uChar.AsciiChar;
+}
+
+void term_watch_handles(const intptr_t *handles, int count) {
+    if (count > TERM_MAX_WATCH_HANDLES) count = TERM_MAX_WATCH_HANDLES;
+    for (int i = 0; i < count; i++) {
+        g_watch_handles[i] = (HANDLE)handles[i];
+    }
+    g_watch_count = count;
+}
+
+void term_wait_event(int timeout_ms, TermEvent *event) {
+    HANDLE hIn = GetStdHandle(STD_INPUT_HANDLE);
+    HANDLE handles[1 + TERM_MAX_WATCH_HANDLES];
+    DWORD start = GetTickCount();
+
+    handles[0] = hIn;
+    for (int i = 0; i < g_watch_count; i++) {
+        handles[1 + i] = g_watch_handles[i];
+    }
+
+    event->key = 0;
+
+    if (g_pending_repeats > 0) {
+        g_pending_repeats--;
+        event->type = TERM_EVENT_KEY;
+        event->key = g_pending_key;
+        return;
+    }
+
+    while (1) {
+        DWORD wait = INFINITE;
+        if (timeout_ms >= 0) {
+            DWORD elapsed = GetTickCount() - start;
+            wait = elapsed >= (DWORD)timeout_ms ? 0 : (DWORD)timeout_ms - elapsed;
+        }
+
+        // The input handle is signalled whenever a record is queued; it comes
+        // first, so input wins when a watched handle is ready at the same time
+        DWORD result = WaitForMultipleObjects(1 + g_watch_count, handles, FALSE, wait);
+        if (result == WAIT_TIMEOUT) {
+            event->type = TERM_EVENT_TIMEOUT;
+            return;
+        }
+        if (result > WAIT_OBJECT_0 && result <= WAIT_OBJECT_0 + (DWORD)g_watch_count) {
+            event->type = TERM_EVENT_WATCH;
+            return;
+        }
+
+        INPUT_RECORD record;
+        DWORD read = 0;
+        if (result != WAIT_OBJECT_0 || !ReadConsoleInputA(hIn, &record, 1, &read)) {
+            event->type = TERM_EVENT_KEY;
+            event->key = KEY_NONE;
+            return;
+        }
+        if (read == 0) continue;
+
+        if (record.EventType == WINDOW_BUFFER_SIZE_EVENT) {
+            event->type = TERM_EVENT_RESIZE;
+            return;
+        }
+
+        if (record.EventType == KEY_EVENT && record.Event.KeyEvent.bKeyDown) {
+            int key = decode_key_event(&record.Event.KeyEvent);
+            if (key) {
+                if (record.Event.KeyEvent.wRepeatCount > 1) {
+                    g_pending_key = key;
+                    g_pending_repeats = record.Event.KeyEvent.wRepeatCount - 1;
+                }
+                event->type = TERM_EVENT_KEY;
+                event->key = key;
+                return;
+            }
+        }
+
+        // Mouse, focus, key-up and modifier events are ignored
+    }
+}
+
+int term_read_key(void) {
+    TermEvent event;
+    int watch_count = g_watch_count;
+
+    // A ready watch handle stays signalled until its owner re-arms it
+    g_watch_count = 0;
+    do {
+        term_wait_event(-1, &event);
+    } while (event.type != TERM_EVENT_KEY);
+    g_watch_count = watch_count;
+
+    return event.key;
+}
+#endif // _WIN32
\ No newline at end of file
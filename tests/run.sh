@@ -0,0 +1,35 @@
+#!/bin/sh
+# Run each tests/*.txt batch script in an empty directory of its own and
+# compare what it prints, stdout and stderr, with tests/<name>.expected. A
+# script that exits non-zero ends its output with "[exit N]".
+#
+# Usage: tests/run.sh path/to/wcal [--update]
+# --update rewrites the .expected files from the current output instead.
+
+wcal=$(cd "$(dirname "$1")" && pwd)/$(basename "$1")
+update=$2
+tests=$(cd "$(dirname "$0")" && pwd)
+work=$(mktemp -d) || exit 1
+trap 'rm -rf "$work"' EXIT
+
+# Every year hot, so nothing depends on today's date; no reminder command
+WCAL_HORIZON_DAYS=0
+export WCAL_HORIZON_DAYS
+unset WCAL_REMINDER_COMMAND
+
+failed=0
+for script in "$tests"/*.txt; do
+    name=$(basename "$script" .txt)
+    mkdir "$work/$name"
+    (cd "$work/$name" && "$wcal" --batch "$script" > output 2>&1 || echo "[exit $?]" >> output)
+
+    if [ "$update" = "--update" ]; then
+        cp "$work/$name/output" "$tests/$name.expected"
+    elif diff -u "$tests/$name.expected" "$work/$name/output"; then
+        echo "PASS $name"
+    else
+        echo "FAIL $name"
+        failed=1
+    fi
+done
+exit $failed
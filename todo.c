@@ -1,272 +1,688 @@
 #include "todo.h"
-#include "ui.h"
+#include "cow.h"
+#include "wmem.h"
+#include "psort.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <conio.h>
+#include "compat.h"
+
+#define NO_SLOT (-1)
+#define NO_DUE_DATE 99991231    // Sorts after every real date
+#define WALK_DEPTH 128          // Far past a treap's expected height; todo_walk copes beyond it
 
 void init_todos(TodoList *list) {
+    memset(list, 0, sizeof(*list));
     list->capacity = 50;
-    list->count = 0;
-    list->items = (TodoItem*)malloc(sizeof(TodoItem) * list->capacity);
+    list->slots = (TodoItem*)cow_alloc(MEM_TODOS, sizeof(TodoItem) * list->capacity);
+    list->nodes = (TodoNode*)cow_alloc(MEM_TODOS, sizeof(TodoNode) * list->capacity);
+    list->root = NO_SLOT;
+    list->free_slot = NO_SLOT;
+    list->rng = 0x9E3779B9u;
+    list->version = 1;
 }
 
 void free_todos(TodoList *list) {
-    if (list->items) {
-        free(list->items);
-        list->items = NULL;
+    cow_free(list->slots);
+    cow_free(list->nodes);
+    cow_free(list->deadlines);
+    cow_free(list->days);
+    wmem_free(list->overdue);
+    memset(list, 0, sizeof(*list));
+    list->root = NO_SLOT;
+    list->free_slot = NO_SLOT;
+}
+
+// Every change starts here: arrays a snapshot still shares are copied, the
+// rest are left alone
+static int unshare_todos(TodoList *list) {
+    if (list->slots) {
+        TodoItem *slots = (TodoItem*)cow_reserve(MEM_TODOS, list->slots, sizeof(TodoItem) * list->used,
+                                                 sizeof(TodoItem) * list->capacity);
+        if (!slots) return 0;
+        list->slots = slots;
+        TodoNode *nodes = (TodoNode*)cow_reserve(MEM_TODOS, list->nodes, sizeof(TodoNode) * list->used,
+                                                 sizeof(TodoNode) * list->capacity);
+        if (!nodes) return 0;
+        list->nodes = nodes;
     }
+    if (list->deadlines) {
+        int *deadlines = (int*)cow_reserve(MEM_INDEXES, list->deadlines, sizeof(int) * list->deadline_count,
+                                           sizeof(int) * list->deadline_capacity);
+        if (!deadlines) return 0;
+        list->deadlines = deadlines;
+    }
+    if (list->days) {
+        size_t size = sizeof(TodoDayBucket) * list->day_capacity;
+        TodoDayBucket *days = (TodoDayBucket*)cow_reserve(MEM_INDEXES, list->days, size, size);
+        if (!days) return 0;
+        list->days = days;
+    }
+    return 1;
+}
+
+void snapshot_todos(TodoList *list, TodoList *snapshot) {
+    *snapshot = *list;
+    snapshot->slots = (TodoItem*)cow_retain(list->slots);
+    snapshot->nodes = (TodoNode*)cow_retain(list->nodes);
+    snapshot->deadlines = (int*)cow_retain(list->deadlines);
+    snapshot->days = (TodoDayBucket*)cow_retain(list->days);
+
+    // The overdue cache is the list's own
+    snapshot->overdue = NULL;
+    snapshot->overdue_count = 0;
+    snapshot->overdue_capacity = 0;
+    snapshot->overdue_day = 0;
+}
+
+void release_todos_snapshot(TodoList *snapshot) {
+    cow_release(snapshot->slots);
+    cow_release(snapshot->nodes);
+    cow_release(snapshot->deadlines);
+    cow_release(snapshot->days);
+    wmem_free(snapshot->overdue);
+    memset(snapshot, 0, sizeof(*snapshot));
+    snapshot->root = NO_SLOT;
+    snapshot->free_slot = NO_SLOT;
+}
+
+void clear_todos(TodoList *list) {
+    if (!unshare_todos(list)) return;
+
     list->count = 0;
-    list->capacity = 0;
+    list->used = 0;
+    list->free_slot = NO_SLOT;
+    list->root = NO_SLOT;
+    list->next_seq = 0;
+    list->deadline_count = 0;
+    if (list->days) memset(list->days, 0, sizeof(TodoDayBucket) * list->day_capacity);
+    list->day_used = 0;
+    list->version++;
 }
 
-int add_todo(TodoList *list, TodoItem *todo) {
-    // Resize if necessary
-    if (list->count >= list->capacity) {
-        list->capacity *= 2;
-        TodoItem *new_items = (TodoItem*)realloc(list->items, sizeof(TodoItem) * list->capacity);
-        if (!new_items) return 0;
-        list->items = new_items;
+// xorshift32; treap balance only needs keys that look random
+static unsigned int next_random(TodoList *list) {
+    unsigned int x = list->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    list->rng = x;
+    return x;
+}
+
+static int date_key(Date date) {
+    return date.year * 10000 + date.month * 100 + date.day;
+}
+
+static int due_key(const TodoItem *todo) {
+    return todo->due.year ? date_key(todo->due) : NO_DUE_DATE;
+}
+
+static int node_size(TodoList *list, int slot) {
+    return slot == NO_SLOT ? 0 : list->nodes[slot].size;
+}
+
+static void update_size(TodoList *list, int slot) {
+    TodoNode *node = &list->nodes[slot];
+    node->size = 1 + node_size(list, node->left) + node_size(list, node->right);
+}
+
+// Display order: open before completed, then higher priority, then earlier due
+// date, then older first
+static int todo_before(TodoList *list, int a, int b) {
+    TodoItem *todo1 = &list->slots[a];
+    TodoItem *todo2 = &list->slots[b];
+
+    if (todo1->completed != todo2->completed) {
+        return todo1->completed < todo2->completed;
     }
-    
-    list->items[list->count] = *todo;
-    list->count++;
-    
-    // Keep sorted
-    sort_todos(list);
-    
-    return 1;
+    if (todo1->priority != todo2->priority) {
+        return todo1->priority > todo2->priority;
+    }
+    if (due_key(todo1) != due_key(todo2)) {
+        return due_key(todo1) < due_key(todo2);
+    }
+    return list->nodes[a].seq < list->nodes[b].seq;
 }
 
-int delete_todo(TodoList *list, int index) {
-    if (index < 0 || index >= list->count) return 0;
-    
-    // Shift items
-    for (int i = index; i < list->count - 1; i++) {
-        list->items[i] = list->items[i + 1];
+// Split a subtree into the nodes ordered before `slot` and the rest
+static void split_by_key(TodoList *list, int root, int slot, int *left, int *right) {
+    if (root == NO_SLOT) {
+        *left = *right = NO_SLOT;
+        return;
     }
-    
-    list->count--;
-    return 1;
+
+    if (todo_before(list, root, slot)) {
+        split_by_key(list, list->nodes[root].right, slot, &list->nodes[root].right, right);
+        *left = root;
+    } else {
+        split_by_key(list, list->nodes[root].left, slot, left, &list->nodes[root].left);
+        *right = root;
+    }
+    update_size(list, root);
 }
 
-int edit_todo(TodoList *list, int index, TodoItem *new_todo) {
-    if (index < 0 || index >= list->count) return 0;
-    
-    list->items[index] = *new_todo;
-    sort_todos(list);
-    
+// Split a subtree into its first `count` nodes and the rest
+static void split_by_position(TodoList *list, int root, int count, int *left, int *right) {
+    if (root == NO_SLOT) {
+        *left = *right = NO_SLOT;
+        return;
+    }
+
+    int left_size = node_size(list, list->nodes[root].left);
+    if (count <= left_size) {
+        split_by_position(list, list->nodes[root].left, count, left, &list->nodes[root].left);
+        *right = root;
+    } else {
+        split_by_position(list, list->nodes[root].right, count - left_size - 1, &list->nodes[root].right, right);
+        *left = root;
+    }
+    update_size(list, root);
+}
+
+// Join two subtrees where everything in `a` comes before everything in `b`
+static int merge(TodoList *list, int a, int b) {
+    if (a == NO_SLOT) return b;
+    if (b == NO_SLOT) return a;
+
+    if (list->nodes[a].heap > list->nodes[b].heap) {
+        list->nodes[a].right = merge(list, list->nodes[a].right, b);
+        update_size(list, a);
+        return a;
+    }
+
+    list->nodes[b].left = merge(list, a, list->nodes[b].left);
+    update_size(list, b);
+    return b;
+}
+
+static void insert_slot(TodoList *list, int slot) {
+    int left, right;
+
+    list->nodes[slot].left = NO_SLOT;
+    list->nodes[slot].right = NO_SLOT;
+    list->nodes[slot].size = 1;
+
+    split_by_key(list, list->root, slot, &left, &right);
+    list->root = merge(list, merge(list, left, slot), right);
+}
+
+// Unlink the todo at a display position and return its slot
+static int remove_at(TodoList *list, int index) {
+    int left, middle, right;
+
+    split_by_position(list, list->root, index, &left, &right);
+    split_by_position(list, right, 1, &middle, &right);
+    list->root = merge(list, left, right);
+    return middle;
+}
+
+// Display position of a linked slot, found by searching for its key
+static int slot_position(TodoList *list, int slot) {
+    int position = 0;
+    int node = list->root;
+
+    while (node != NO_SLOT) {
+        if (node == slot) return position + node_size(list, list->nodes[node].left);
+
+        if (todo_before(list, slot, node)) {
+            node = list->nodes[node].left;
+        } else {
+            position += node_size(list, list->nodes[node].left) + 1;
+            node = list->nodes[node].right;
+        }
+    }
+
+    return -1;
+}
+
+static unsigned int day_hash(int day) {
+    unsigned int h = (unsigned int)day * 2654435761u;
+    return h ^ (h >> 16);
+}
+
+// Bucket for a day, or the empty bucket where it would go
+static TodoDayBucket *find_day(TodoList *list, int day) {
+    unsigned int mask = (unsigned int)list->day_capacity - 1;
+    unsigned int i = day_hash(day) & mask;
+
+    while (list->days[i].day != 0 && list->days[i].day != day) {
+        i = (i + 1) & mask;
+    }
+    return &list->days[i];
+}
+
+// Rebuild the map at a new size, dropping days whose count fell to zero
+static int grow_days(TodoList *list) {
+    TodoDayBucket *old_days = list->days;
+    int old_capacity = list->day_capacity;
+    int capacity = old_capacity ? old_capacity * 2 : 64;
+
+    TodoDayBucket *days = (TodoDayBucket*)cow_alloc(MEM_INDEXES, sizeof(TodoDayBucket) * capacity);
+    if (!days) return 0;
+    memset(days, 0, sizeof(TodoDayBucket) * capacity);
+
+    list->days = days;
+    list->day_capacity = capacity;
+    list->day_used = 0;
+
+    for (int i = 0; i < old_capacity; i++) {
+        if (old_days[i].day != 0 && old_days[i].count > 0) {
+            *find_day(list, old_days[i].day) = old_days[i];
+            list->day_used++;
+        }
+    }
+
+    cow_free(old_days);
     return 1;
 }
 
-void toggle_todo_completion(TodoList *list, int index) {
-    if (index < 0 || index >= list->count) return;
-    
-    list->items[index].completed = !list->items[index].completed;
+static void count_day(TodoList *list, int day, int delta) {
+    if (list->days) {
+        TodoDayBucket *bucket = find_day(list, day);
+        if (bucket->day == day) {
+            bucket->count += delta;
+            return;
+        }
+    }
+    if (delta < 0) return;
+
+    // Keep the load under 3/4 so probes stay short
+    if ((list->day_used + 1) * 4 > list->day_capacity * 3 && !grow_days(list)) return;
+
+    TodoDayBucket *bucket = find_day(list, day);
+    bucket->day = day;
+    bucket->count = delta;
+    list->day_used++;
 }
 
-// Comparison function for sorting todos
-static int compare_todos(const void *a, const void *b) {
-    TodoItem *todo1 = (TodoItem*)a;
-    TodoItem *todo2 = (TodoItem*)b;
-    
-    // Sort by: completed status (uncompleted first), then priority (higher first)
-    if (todo1->completed != todo2->completed) {
-        return todo1->completed - todo2->completed;
+static int deadline_key(TodoList *list, int heap_index) {
+    return date_key(list->slots[list->deadlines[heap_index]].due);
+}
+
+static void place_deadline(TodoList *list, int heap_index, int slot) {
+    list->deadlines[heap_index] = slot;
+    list->nodes[slot].deadline_pos = heap_index;
+}
+
+static void sift_up(TodoList *list, int heap_index) {
+    int slot = list->deadlines[heap_index];
+    int key = date_key(list->slots[slot].due);
+
+    while (heap_index > 0) {
+        int parent = (heap_index - 1) / 2;
+        if (deadline_key(list, parent) <= key) break;
+        place_deadline(list, heap_index, list->deadlines[parent]);
+        heap_index = parent;
     }
-    
-    return todo2->priority - todo1->priority;
+    place_deadline(list, heap_index, slot);
 }
 
-void sort_todos(TodoList *list) {
-    qsort(list->items, list->count, sizeof(TodoItem), compare_todos);
+static void sift_down(TodoList *list, int heap_index) {
+    int slot = list->deadlines[heap_index];
+    int key = date_key(list->slots[slot].due);
+
+    for (;;) {
+        int child = heap_index * 2 + 1;
+        if (child >= list->deadline_count) break;
+        if (child + 1 < list->deadline_count && deadline_key(list, child + 1) < deadline_key(list, child)) {
+            child++;
+        }
+        if (deadline_key(list, child) >= key) break;
+        place_deadline(list, heap_index, list->deadlines[child]);
+        heap_index = child;
+    }
+    place_deadline(list, heap_index, slot);
 }
 
-// Helper function to read a line with visual feedback (same as in appointments.c)
-static void read_line_visual(char *buffer, int max_len, int x, int y) {
-    int pos = 0;
-    char ch;
-    
-    // Show cursor
-    CONSOLE_CURSOR_INFO cursorInfo;
-    HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
-    GetConsoleCursorInfo(hOut, &cursorInfo);
-    cursorInfo.bVisible = TRUE;
-    SetConsoleCursorInfo(hOut, &cursorInfo);
-    
-    gotoxy(x, y);
+// Only open todos with a due date are tracked
+static void index_deadline(TodoList *list, int slot) {
+    TodoItem *todo = &list->slots[slot];
+
+    list->nodes[slot].deadline_pos = -1;
+    if (todo->completed || !todo->due.year) return;
+
+    if (list->deadline_count >= list->deadline_capacity) {
+        int capacity = list->deadline_capacity ? list->deadline_capacity * 2 : 64;
+        int *deadlines = (int*)cow_reserve(MEM_INDEXES, list->deadlines, sizeof(int) * list->deadline_count,
+                                           sizeof(int) * capacity);
+        if (!deadlines) return;
+        list->deadlines = deadlines;
+        list->deadline_capacity = capacity;
+    }
+
+    list->deadlines[list->deadline_count] = slot;
+    sift_up(list, list->deadline_count++);
+    count_day(list, date_key(todo->due), 1);
+}
+
+static void unindex_deadline(TodoList *list, int slot) {
+    int heap_index = list->nodes[slot].deadline_pos;
+    if (heap_index < 0) return;
+
+    count_day(list, date_key(list->slots[slot].due), -1);
+    list->nodes[slot].deadline_pos = -1;
+
+    // Move the last entry into the hole and restore the heap either way
+    int last = list->deadlines[--list->deadline_count];
+    if (heap_index < list->deadline_count) {
+        place_deadline(list, heap_index, last);
+        sift_up(list, heap_index);
+        sift_down(list, list->nodes[last].deadline_pos);
+    }
+}
+
+static int alloc_slot(TodoList *list) {
+    if (list->free_slot != NO_SLOT) {
+        int slot = list->free_slot;
+        list->free_slot = list->nodes[slot].left;
+        return slot;
+    }
+
+    // Resize if necessary
+    if (list->used >= list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 50;
+        TodoItem *slots = (TodoItem*)cow_reserve(MEM_TODOS, list->slots, sizeof(TodoItem) * list->used,
+                                                 sizeof(TodoItem) * capacity);
+        if (!slots) return NO_SLOT;
+        list->slots = slots;
+        TodoNode *nodes = (TodoNode*)cow_reserve(MEM_TODOS, list->nodes, sizeof(TodoNode) * list->used,
+                                                 sizeof(TodoNode) * capacity);
+        if (!nodes) return NO_SLOT;
+        list->nodes = nodes;
+        list->capacity = capacity;
+    }
+
+    return list->used++;
+}
+
+int add_todo(TodoList *list, TodoItem *todo) {
+    if (!unshare_todos(list)) return 0;
+
+    int slot = alloc_slot(list);
+    if (slot == NO_SLOT) return 0;
+
+    list->slots[slot] = *todo;
+    list->nodes[slot].seq = list->next_seq++;
+    list->nodes[slot].heap = next_random(list);
+    insert_slot(list, slot);
+    index_deadline(list, slot);
+    list->count++;
+    list->version++;
+
+    return 1;
+}
+
+// Display order without the insertion order, as one integer: open before
+// completed, higher priority first, earlier due date first
+static unsigned long long todo_key(const TodoItem *todo) {
+    int priority = todo->priority < 0 ? 0 : todo->priority > 255 ? 255 : todo->priority;
     
-    while (1) {
-        ch = _getch();
+    return ((unsigned long long)(todo->completed != 0) << 40) | ((unsigned long long)(255 - priority) << 32) |
+           (unsigned int)due_key(todo);
+}
+
+// The tree over slots already in display order, in one pass: the right
+// spine is kept on a stack, and a node with a larger heap key takes the
+// part of it below that key as its left subtree. A node's subtree is
+// complete when it leaves the stack.
+static void build_tree(TodoList *list, const SortPair *order, int count, int *stack) {
+    int depth = 0;
+    
+    for (int i = 0; i < count; i++) {
+        int slot = order[i].index;
+        int below = NO_SLOT;
         
-        if (ch == '\r' || ch == '\n') {  // Enter
-            buffer[pos] = '\0';
-            break;
-        } else if (ch == '\b' && pos > 0) {  // Backspace
-            pos--;
-            gotoxy(x + pos, y);
-            printf(" ");
-            gotoxy(x + pos, y);
-        } else if (ch == 27) {  // Escape
-            buffer[0] = '\0';
-            break;
-        } else if (ch >= 32 && ch < 127 && pos < max_len - 1) {  // Printable chars
-            buffer[pos++] = ch;
-            printf("%c", ch);
+        while (depth > 0 && list->nodes[stack[depth - 1]].heap < list->nodes[slot].heap) {
+            below = stack[--depth];
+            update_size(list, below);
         }
+        list->nodes[slot].left = below;
+        list->nodes[slot].right = NO_SLOT;
+        if (depth > 0) list->nodes[stack[depth - 1]].right = slot;
+        stack[depth++] = slot;
     }
     
-    // Hide cursor again
-    cursorInfo.bVisible = FALSE;
-    SetConsoleCursorInfo(hOut, &cursorInfo);
+    // The bottom of the spine is the root
+    list->root = depth > 0 ? stack[0] : NO_SLOT;
+    while (depth > 0) update_size(list, stack[--depth]);
 }
 
-void add_todo_interactive(TodoList *list) {
-    TodoItem new_todo;
-    char buffer[256];
-    
-    // Get window dimensions for centering
-    CONSOLE_SCREEN_BUFFER_INFO csbi;
-    GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &csbi);
-    int window_width = csbi.srWindow.Right - csbi.srWindow.Left + 1;
-    int window_height = csbi.srWindow.Bottom - csbi.srWindow.Top + 1;
-    
-    // Clear a section for input
-    int input_y = window_height / 2 - 4;
-    int input_x = window_width / 2 - 30;
-    
-    // Clear the background area first
-    clear_area(input_x, input_y, 60, 8);
-    
-    // Draw input box
-    draw_box(input_x, input_y, 60, 8, "Add TODO");
-    
-    set_color(NORMAL_FG, NORMAL_BG);
-    
-    // Get description
-    gotoxy(input_x + 2, input_y + 2);
-    printf("Description: ");
-    read_line_visual(new_todo.description, MAX_TODO_DESCRIPTION - 1, input_x + 15, input_y + 2);
+int add_todos(TodoList *list, const TodoItem *todos, int count) {
+    if (count <= 0) return 1;
+    if (!unshare_todos(list)) return 0;
+    
+    // Room for all of them first, so no slot can fail halfway
+    if (list->used + count > list->capacity) {
+        int capacity = list->capacity ? list->capacity : 50;
+        while (capacity < list->used + count) capacity *= 2;
+        TodoItem *slots = (TodoItem*)cow_reserve(MEM_TODOS, list->slots, sizeof(TodoItem) * list->used,
+                                                 sizeof(TodoItem) * capacity);
+        if (!slots) return 0;
+        list->slots = slots;
+        TodoNode *nodes = (TodoNode*)cow_reserve(MEM_TODOS, list->nodes, sizeof(TodoNode) * list->used,
+                                                 sizeof(TodoNode) * capacity);
+        if (!nodes) return 0;
+        list->nodes = nodes;
+        list->capacity = capacity;
+    }
     
-    if (strlen(new_todo.description) == 0) return;  // Cancelled
+    int total = list->count + count;
+    SortPair *order = (SortPair*)wmem_malloc(MEM_INDEXES, sizeof(SortPair) * total);
+    int *stack = (int*)wmem_malloc(MEM_INDEXES, sizeof(int) * total);
+    if (!order || !stack) {
+        wmem_free(order);
+        wmem_free(stack);
+        for (int i = 0; i < count; i++) {
+            if (!add_todo(list, (TodoItem*)&todos[i])) return 0;
+        }
+        return 1;
+    }
     
-    // Get priority
-    gotoxy(input_x + 2, input_y + 3);
-    printf("Priority (0=Normal, 1=High, 2=Urgent): ");
-    read_line_visual(buffer, 10, input_x + 41, input_y + 3);
+    // The todos already here in display order, then the new ones: a stable
+    // sort keeps equal keys in that order, which is insertion order
+    int n = 0;
+    int depth = 0;
+    for (int node = list->root; node != NO_SLOT || depth > 0; ) {
+        while (node != NO_SLOT) {
+            stack[depth++] = node;
+            node = list->nodes[node].left;
+        }
+        node = stack[--depth];
+        order[n].key = todo_key(&list->slots[node]);
+        order[n++].index = node;
+        node = list->nodes[node].right;
+    }
     
-    new_todo.priority = atoi(buffer);
-    if (new_todo.priority < 0) new_todo.priority = 0;
-    if (new_todo.priority > 2) new_todo.priority = 2;
+    for (int i = 0; i < count; i++) {
+        int slot = alloc_slot(list);
+        list->slots[slot] = todos[i];
+        list->nodes[slot].seq = list->next_seq++;
+        list->nodes[slot].heap = next_random(list);
+        list->nodes[slot].size = 1;
+        index_deadline(list, slot);
+        order[n].key = todo_key(&list->slots[slot]);
+        order[n++].index = slot;
+    }
     
-    new_todo.completed = 0;
+    if (psort_pairs(order, n) >= 0) {
+        build_tree(list, order, n, stack);
+    } else {
+        for (int i = list->count; i < n; i++) insert_slot(list, order[i].index);
+    }
+    list->count = n;
+    list->version++;
     
-    // Add the todo
-    add_todo(list, &new_todo);
+    wmem_free(order);
+    wmem_free(stack);
+    return 1;
+}
+
+int delete_todo(TodoList *list, int index) {
+    if (index < 0 || index >= list->count) return 0;
+    if (!unshare_todos(list)) return 0;
+
+    int slot = remove_at(list, index);
+    unindex_deadline(list, slot);
+    list->nodes[slot].left = list->free_slot;
+    list->free_slot = slot;
+    list->count--;
+    list->version++;
+
+    return 1;
 }
 
-void edit_todo_interactive(TodoList *list, int index) {
+int edit_todo(TodoList *list, int index, TodoItem *new_todo) {
+    if (index < 0 || index >= list->count) return 0;
+    if (!unshare_todos(list)) return 0;
+
+    // Re-insert under the new key; the sequence number keeps its place among equals
+    int slot = remove_at(list, index);
+    unindex_deadline(list, slot);
+    list->slots[slot] = *new_todo;
+    insert_slot(list, slot);
+    index_deadline(list, slot);
+    list->version++;
+
+    return 1;
+}
+
+void toggle_todo_completion(TodoList *list, int index) {
     if (index < 0 || index >= list->count) return;
-    
-    TodoItem *todo = &list->items[index];
-    TodoItem new_todo = *todo;  // Copy current todo
-    char buffer[256];
-    
-    // Get window dimensions for centering
-    CONSOLE_SCREEN_BUFFER_INFO csbi;
-    GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &csbi);
-    int window_width = csbi.srWindow.Right - csbi.srWindow.Left + 1;
-    int window_height = csbi.srWindow.Bottom - csbi.srWindow.Top + 1;
-    
-    // Clear a section for input
-    int input_y = window_height / 2 - 4;
-    int input_x = window_width / 2 - 25;
-    
-    // Clear the background area first
-    clear_area(input_x, input_y, 50, 8);
-    
-    // Draw input box
-    draw_box(input_x, input_y, 50, 8, "Edit TODO");
-    
-    set_color(NORMAL_FG, NORMAL_BG);
-    
-    // Show current values and get new ones
-    
-    // Description
-    gotoxy(input_x + 2, input_y + 2);
-    printf("Current: %.30s", todo->description);
-    gotoxy(input_x + 2, input_y + 3);
-    printf("New description: ");
-    
-    // Simple input reading
-    HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
-    CONSOLE_CURSOR_INFO cursorInfo;
-    GetConsoleCursorInfo(hOut, &cursorInfo);
-    cursorInfo.bVisible = TRUE;
-    SetConsoleCursorInfo(hOut, &cursorInfo);
-    
-    int pos = 0;
-    char ch;
-    gotoxy(input_x + 18, input_y + 3);
-    
-    while (1) {
-        ch = _getch();
-        
-        if (ch == '\r' || ch == '\n') {  // Enter
-            buffer[pos] = '\0';
-            break;
-        } else if (ch == '\b' && pos > 0) {  // Backspace
-            pos--;
-            gotoxy(input_x + 18 + pos, input_y + 3);
-            printf(" ");
-            gotoxy(input_x + 18 + pos, input_y + 3);
-        } else if (ch == 27) {  // Escape
-            cursorInfo.bVisible = FALSE;
-            SetConsoleCursorInfo(hOut, &cursorInfo);
-            return;  // Cancel
-        } else if (ch >= 32 && ch < 127 && pos < MAX_DESCRIPTION_LENGTH - 1) {  // Printable chars
-            buffer[pos++] = ch;
-            printf("%c", ch);
+    if (!unshare_todos(list)) return;
+
+    int slot = remove_at(list, index);
+    unindex_deadline(list, slot);
+    list->slots[slot].completed = !list->slots[slot].completed;
+    insert_slot(list, slot);
+    index_deadline(list, slot);
+    list->version++;
+}
+
+TodoItem *todo_at(TodoList *list, int index) {
+    if (index < 0 || index >= list->count) return NULL;
+
+    int slot = list->root;
+    while (slot != NO_SLOT) {
+        int left_size = node_size(list, list->nodes[slot].left);
+        if (index < left_size) {
+            slot = list->nodes[slot].left;
+        } else if (index == left_size) {
+            return &list->slots[slot];
+        } else {
+            index -= left_size + 1;
+            slot = list->nodes[slot].right;
         }
     }
-    
-    // Hide cursor again
-    cursorInfo.bVisible = FALSE;
-    SetConsoleCursorInfo(hOut, &cursorInfo);
-    
-    if (strlen(buffer) > 0) {
-        strcpy_s(new_todo.description, MAX_DESCRIPTION_LENGTH, buffer);
+
+    return NULL;
+}
+
+void todo_walk(TodoList *list, int first, TodoVisit visit, void *context) {
+    int stack[WALK_DEPTH];
+    int depth = 0;
+    int deep = 0;
+
+    if (first < 0) first = 0;
+    int position = first;
+    int index = first;
+
+    // Down to the todo at first; the stack keeps it on top, and under it
+    // the nodes the path went left at, which come after it
+    int slot = list->root;
+    while (slot != NO_SLOT && !deep) {
+        int left_size = node_size(list, list->nodes[slot].left);
+        if (index > left_size) {
+            index -= left_size + 1;
+            slot = list->nodes[slot].right;
+        } else if (depth == WALK_DEPTH) {
+            deep = 1;
+        } else {
+            stack[depth++] = slot;
+            slot = index < left_size ? list->nodes[slot].left : NO_SLOT;
+        }
     }
-    
-    // Priority
-    gotoxy(input_x + 2, input_y + 4);
-    printf("0=Normal, 1=High, 2=Urgent) [%d]: ", todo->priority);
-    
-    pos = 0;
-    gotoxy(input_x + 38, input_y + 4);
-    
-    cursorInfo.bVisible = TRUE;
-    SetConsoleCursorInfo(hOut, &cursorInfo);
-    
-    while (1) {
-        ch = _getch();
-        
-        if (ch == '\r' || ch == '\n') {  // Enter
-            break;
-        } else if (ch == 27) {  // Escape
-            cursorInfo.bVisible = FALSE;
-            SetConsoleCursorInfo(hOut, &cursorInfo);
-            return;  // Cancel
-        } else if (ch >= '0' && ch <= '2') {  // Valid priority
-            new_todo.priority = ch - '0';
-            printf("%c", ch);
-            break;
+
+    // Each todo is followed by the leftmost of its right subtree
+    while (depth > 0 && !deep) {
+        int node = stack[--depth];
+        if (!visit(context, &list->slots[node])) return;
+        position++;
+
+        for (slot = list->nodes[node].right; slot != NO_SLOT && !deep; slot = list->nodes[slot].left) {
+            if (depth == WALK_DEPTH) deep = 1;
+            else stack[depth++] = slot;
         }
     }
-    
-    cursorInfo.bVisible = FALSE;
-    SetConsoleCursorInfo(hOut, &cursorInfo);
-    
-    // Update the todo
-    list->items[index] = new_todo;
+
+    // A path deeper than the stack: the rest a position at a time
+    for (; deep && position < list->count; position++) {
+        if (!visit(context, todo_at(list, position))) return;
+    }
+}
+
+int todo_is_overdue(const TodoItem *todo, Date today) {
+    return !todo->completed && todo->due.year && date_key(todo->due) < date_key(today);
+}
+
+int todos_due_on(TodoList *list, Date day) {
+    if (!list->days) return 0;
+
+    TodoDayBucket *bucket = find_day(list, date_key(day));
+    return bucket->day ? bucket->count : 0;
+}
+
+int todo_next_deadline(TodoList *list, Date *due) {
+    if (list->deadline_count == 0) return 0;
+
+    if (due) *due = list->slots[list->deadlines[0]].due;
+    return 1;
+}
+
+// Walk only the part of the heap below today; every visited entry is a match
+static void collect_overdue(TodoList *list, int heap_index, int today, int *count) {
+    if (heap_index >= list->deadline_count || deadline_key(list, heap_index) >= today) return;
+
+    list->overdue[(*count)++] = slot_position(list, list->deadlines[heap_index]);
+    collect_overdue(list, heap_index * 2 + 1, today, count);
+    collect_overdue(list, heap_index * 2 + 2, today, count);
+}
+
+static int compare_positions(const void *a, const void *b) {
+    return *(const int*)a - *(const int*)b;
+}
+
+int todo_overdue(TodoList *list, Date today, const int **positions) {
+    int today_key = date_key(today);
+
+    if (list->overdue_version != list->version || list->overdue_day != today_key) {
+        if (list->overdue_capacity < list->deadline_count) {
+            int *overdue = (int*)wmem_realloc(MEM_INDEXES, list->overdue, sizeof(int) * list->deadline_count);
+            if (!overdue) {
+                *positions = NULL;
+                return 0;
+            }
+            list->overdue = overdue;
+            list->overdue_capacity = list->deadline_count;
+        }
+
+        list->overdue_count = 0;
+        collect_overdue(list, 0, today_key, &list->overdue_count);
+        qsort(list->overdue, list->overdue_count, sizeof(int), compare_positions);
+
+        list->overdue_version = list->version;
+        list->overdue_day = today_key;
+    }
+
+    *positions = list->overdue;
+    return list->overdue_count;
+}
+
+size_t todos_data_bytes(TodoList *list) {
+    size_t bytes = 0;
+
+    for (int i = 0; i < list->count; i++) {
+        bytes += sizeof(TodoItem) + sizeof(TodoNode) - MAX_TODO_DESCRIPTION + strlen(todo_at(list, i)->description) + 1;
+    }
+    return bytes;
 }
\ No newline at end of file
@@ -1,6 +1,9 @@
 #ifndef TODO_H
 #define TODO_H
 
+#include <stddef.h>
+#include "calendar.h"
+
 #define MAX_TODOS 500
 #define MAX_TODO_DESCRIPTION 256
 
@@ -9,26 +12,96 @@ typedef struct {
     char description[MAX_TODO_DESCRIPTION];
     int priority;  // 0 = normal, 1 = high, 2 = urgent
     int completed;
+    Date due;      // year 0 = no due date
 } TodoItem;
 
-// TODO list
+// Node of the ordering tree, one per slot. The tree is a treap (binary
+// search tree on the todo order, heap on a random key) whose subtree sizes
+// let todo_at() find the n-th item in O(log n).
+typedef struct {
+    int left, right;        // Child slots, -1 for none
+    int size;               // Nodes in this subtree
+    unsigned int heap;      // Random treap key
+    unsigned int seq;       // Insertion order; keeps equal todos stable
+    int deadline_pos;       // Index in the deadline heap, -1 if not in it
+} TodoNode;
+
+// Open todos due on one day. day is the date key (YYYYMMDD), 0 for an empty bucket.
 typedef struct {
-    TodoItem *items;
+    int day;
     int count;
-    int capacity;
+} TodoDayBucket;
+
+// TODO list. Items live in fixed slots that are reused but never moved;
+// display order comes from the tree: open before completed, then higher
+// priority first, then earlier due date (none last), then the order they
+// were added in.
+//
+// Open todos with a due date are also indexed by deadline: a min-heap for
+// the earliest and overdue ones, and a hash map of per-day counts so the
+// calendar can mark a day without looking at the list.
+typedef struct {
+    TodoItem *slots;
+    TodoNode *nodes;        // Parallel to slots
+    int count;              // Live todos
+    int capacity;           // Allocated slots
+    int used;               // Slots handed out so far
+    int free_slot;          // First recycled slot, chained through nodes[].left
+    int root;
+    unsigned int next_seq;
+    unsigned int rng;
+
+    int *deadlines;         // Min-heap of slots, keyed by due date
+    int deadline_count;
+    int deadline_capacity;
+    TodoDayBucket *days;    // Open addressing, capacity a power of two
+    int day_capacity;
+    int day_used;           // Buckets taken, including ones whose count fell to 0
+
+    unsigned int version;   // Bumped by every change
+    int *overdue;           // Display positions from the last todo_overdue() call
+    int overdue_count;
+    int overdue_capacity;
+    unsigned int overdue_version;
+    int overdue_day;
 } TodoList;
 
-// TODO functions
+// TODO functions. Indices are display positions; every update is O(log n).
 void init_todos(TodoList *list);
 void free_todos(TodoList *list);
+void clear_todos(TodoList *list);
 int add_todo(TodoList *list, TodoItem *todo);
+// Several at once, in the order given, for loads: the keys are sorted as a
+// batch and the tree is rebuilt in one pass, O(n) after the sort instead of
+// O(log n) per todo
+int add_todos(TodoList *list, const TodoItem *todos, int count);
 int delete_todo(TodoList *list, int index);
 int edit_todo(TodoList *list, int index, TodoItem *new_todo);
 void toggle_todo_completion(TodoList *list, int index);
-void sort_todos(TodoList *list);
+TodoItem *todo_at(TodoList *list, int index);
+// Visit the todos in display order from position first on, until visit
+// returns 0: O(log n) to start, then O(1) a todo on average, where a loop
+// over todo_at is O(log n) a todo. The list mustn't change meanwhile.
+typedef int (*TodoVisit)(void *context, TodoItem *todo);
+void todo_walk(TodoList *list, int first, TodoVisit visit, void *context);
+
+// A read-only copy in O(1) that shares the arrays until the list next
+// changes. Take it on the thread that owns the list; it can be read and
+// released on any thread, except that todo_overdue allocates its cache and
+// so belongs on the owning thread.
+void snapshot_todos(TodoList *list, TodoList *snapshot);
+void release_todos_snapshot(TodoList *snapshot);
+
+// Deadline queries
+int todo_is_overdue(const TodoItem *todo, Date today);
+int todos_due_on(TodoList *list, Date day);             // Open todos due that day, O(1)
+int todo_next_deadline(TodoList *list, Date *due);      // 0 when nothing open has a due date
+// Display positions of open todos due before today, in display order. The
+// result is cached until the list changes or the day does.
+int todo_overdue(TodoList *list, Date today, const int **positions);
 
-// Interactive functions
-void add_todo_interactive(TodoList *list);
-void edit_todo_interactive(TodoList *list, int index);
+// Bytes of live todos and their tree nodes, less unused description space
+// (for --mem-report)
+size_t todos_data_bytes(TodoList *list);
 
 #endif // TODO_H
\ No newline at end of file
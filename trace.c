@@ -0,0 +1,177 @@
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "compat.h"
+
+#ifdef _WIN32
+#include <windows.h>
+// Both return the value before the increment
+#define FETCH_INCREMENT(counter) (InterlockedIncrement64(counter) - 1)
+#else
+#include <time.h>
+#define FETCH_INCREMENT(counter) __atomic_fetch_add((counter), 1, __ATOMIC_RELAXED)
+#endif
+
+// Name in the Chrome trace, then the overlay's short label
+static const char *const g_point_names[TRACE_POINT_COUNT][2] = {
+    {"frame", "frame"},
+    {"process_input", "input"},
+    {"compose_ui", "compose"},
+    {"fb_flush", "flush"},
+    {"calendar_panel", "cal"},
+    {"appointments_panel", "appts"},
+    {"todo_panel", "todo"},
+    {"status_bar", "status"},
+    {"find_appointments_by_date", "find"},
+    {"sort_appointments", "sort"},
+    {"sync", "sync"},
+    {"load_data_from_zip", "load"},
+    {"save_data_to_zip", "save"}
+};
+
+typedef struct {
+    unsigned long long start;       // trace_now() when the span began
+    unsigned long long duration;    // Nanoseconds
+    int point;
+} TraceSpan;
+
+int g_trace_enabled;
+
+// Writers claim a slot with an atomic increment and never wait; the ring is
+// only read back at exit, or by the overlay for its own small windows
+static TraceSpan g_spans[TRACE_RING_SIZE];
+static volatile long long g_span_count;        // Spans ever recorded; the ring holds the newest
+
+static unsigned long long g_windows[TRACE_POINT_COUNT][TRACE_WINDOW];
+static volatile long long g_window_counts[TRACE_POINT_COUNT];
+
+static FILE *g_trace_file;
+static int g_live;
+
+unsigned long long trace_now(void) {
+#ifdef _WIN32
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+
+    if (!frequency.QuadPart) QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+
+    // Split so the multiplication can't overflow on long uptimes
+    unsigned long long seconds = counter.QuadPart / frequency.QuadPart;
+    unsigned long long rest = counter.QuadPart % frequency.QuadPart;
+    return seconds * 1000000000ULL + rest * 1000000000ULL / frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+#endif
+}
+
+unsigned long long trace_begin(void) {
+    return g_trace_enabled ? trace_now() : 0;
+}
+
+void trace_end(TracePoint point, unsigned long long start) {
+    // Tracing was off when the span began
+    if (!start) return;
+
+    unsigned long long duration = trace_now() - start;
+    TraceSpan *span = &g_spans[FETCH_INCREMENT(&g_span_count) & (TRACE_RING_SIZE - 1)];
+    span->start = start;
+    span->duration = duration;
+    span->point = point;
+
+    g_windows[point][FETCH_INCREMENT(&g_window_counts[point]) % TRACE_WINDOW] = duration;
+}
+
+// Chrome trace-event JSON: one complete ("X") event per span, times in
+// microseconds from the first span kept
+static void write_trace(void) {
+    long long count = g_span_count;
+    long long first = count > TRACE_RING_SIZE ? count - TRACE_RING_SIZE : 0;
+    unsigned long long origin = 0;
+
+    // Spans are stored as they end, so the earliest start can be anywhere
+    for (long long i = first; i < count; i++) {
+        const TraceSpan *span = &g_spans[i & (TRACE_RING_SIZE - 1)];
+        if (i == first || span->start < origin) origin = span->start;
+    }
+
+    fprintf(g_trace_file, "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped\":%lld},\"traceEvents\":[\n", first);
+    fprintf(g_trace_file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"wcal\"}}");
+    for (long long i = first; i < count; i++) {
+        const TraceSpan *span = &g_spans[i & (TRACE_RING_SIZE - 1)];
+        fprintf(g_trace_file,
+                ",\n{\"name\":\"%s\",\"cat\":\"wcal\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+                g_point_names[span->point][0], (span->start - origin) / 1000.0, span->duration / 1000.0);
+    }
+    fprintf(g_trace_file, "\n]}\n");
+    fclose(g_trace_file);
+    g_trace_file = NULL;
+}
+
+int trace_open(const char *path) {
+    if (g_trace_file) return 1;
+    if (fopen_s(&g_trace_file, path, "w") != 0) return 0;
+
+    atexit(write_trace);
+    g_trace_enabled = 1;
+    return 1;
+}
+
+void trace_set_live(int on) {
+    g_live = on;
+    g_trace_enabled = g_live || g_trace_file;
+}
+
+static int compare_durations(const void *a, const void *b) {
+    unsigned long long x = *(const unsigned long long*)a;
+    unsigned long long y = *(const unsigned long long*)b;
+    return (x > y) - (x < y);
+}
+
+int trace_percentiles(TracePoint point, unsigned long long *p50, unsigned long long *p99) {
+    unsigned long long sorted[TRACE_WINDOW];
+    long long total = g_window_counts[point];
+    int count = total < TRACE_WINDOW ? (int)total : TRACE_WINDOW;
+
+    if (count == 0) return 0;
+
+    // Until the window first fills, its spans are the leading slots
+    memcpy(sorted, g_windows[point], count * sizeof(sorted[0]));
+    qsort(sorted, count, sizeof(sorted[0]), compare_durations);
+    *p50 = sorted[(count - 1) / 2];
+    *p99 = sorted[(count - 1) * 99 / 100];
+    return count;
+}
+
+// "0.4us", "850us" below a millisecond, "12.3ms" from there
+static void format_duration(unsigned long long nanoseconds, char *buffer, int buffer_size) {
+    if (nanoseconds < 10000ULL) {
+        snprintf(buffer, buffer_size, "%.1fus", nanoseconds / 1000.0);
+    } else if (nanoseconds < 1000000ULL) {
+        snprintf(buffer, buffer_size, "%lluus", nanoseconds / 1000);
+    } else {
+        snprintf(buffer, buffer_size, "%.1fms", nanoseconds / 1000000.0);
+    }
+}
+
+void trace_describe_live(char *buffer, int buffer_size) {
+    int length = 0;
+
+    buffer[0] = '\0';
+    for (int point = 0; point < TRACE_POINT_COUNT && length < buffer_size - 1; point++) {
+        unsigned long long p50, p99;
+        char median[16], tail[16];
+
+        if (!trace_percentiles(point, &p50, &p99)) continue;
+        format_duration(p50, median, sizeof(median));
+        format_duration(p99, tail, sizeof(tail));
+
+        int written = snprintf(buffer + length, buffer_size - length, "%s%s %s/%s",
+                               length ? "  " : "", g_point_names[point][1], median, tail);
+        if (written < 0) break;
+        length += written;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// Scoped timers around wcal's hot paths. A span is
+//     unsigned long long span = trace_begin();
+//     ...
+//     trace_end(TRACE_SORT, span);
+// and costs one branch while tracing is off. Spans go to a ring buffer that
+// --trace writes out in Chrome trace-event format at exit (load it in
+// chrome://tracing or Perfetto), and to a short window per point behind the
+// live p50/p99 overlay.
+
+// Instrumented code paths, in the order the overlay lists them
+typedef enum {
+    TRACE_FRAME,                // One frame of the main loop (or draw_ui): compose and flush
+    TRACE_INPUT,                // process_input
+    TRACE_COMPOSE,              // compose_ui
+    TRACE_FLUSH,                // fb_flush
+    TRACE_CALENDAR_PANEL,       // Each panel's part of compose_ui, full or partial redraw
+    TRACE_APPOINTMENTS_PANEL,
+    TRACE_TODO_PANEL,
+    TRACE_STATUS_BAR,
+    TRACE_FIND_BY_DATE,         // find_appointments_by_date (and its windowed form)
+    TRACE_SORT,                 // sort_appointments
+    TRACE_SYNC,                 // Opening or reloading a watched file
+    TRACE_LOAD,                 // load_data_from_zip
+    TRACE_SAVE,                 // save_data_to_zip
+    TRACE_POINT_COUNT
+} TracePoint;
+
+#define TRACE_RING_SIZE     (1 << 16)   // Spans kept for --trace; older ones are overwritten
+#define TRACE_WINDOW        256         // Latest spans per point behind the live percentiles
+
+// Nonzero while spans are recorded: --trace was given or the overlay is on
+extern int g_trace_enabled;
+
+// Monotonic clock in nanoseconds
+unsigned long long trace_now(void);
+
+// Start a span; 0 (which trace_end ignores) while tracing is off
+unsigned long long trace_begin(void);
+void trace_end(TracePoint point, unsigned long long start);
+
+// Record from now on and write the spans to path when the process exits.
+// Returns 0 if the file can't be created.
+int trace_open(const char *path);
+
+// The status bar overlay records spans while it is shown
+void trace_set_live(int on);
+
+// Median and 99th percentile, in nanoseconds, of the point's latest spans;
+// returns how many spans that was, 0 before the first
+int trace_percentiles(TracePoint point, unsigned long long *p50, unsigned long long *p99);
+
+// "frame 412us/1.8ms  input 6us/15us ..." for every point seen so far
+void trace_describe_live(char *buffer, int buffer_size);
+
+#endif // TRACE_H
\ No newline at end of file
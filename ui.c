@@ -1,119 +1,64 @@
 #include "ui.h"
+#include "trace.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
-#include <conio.h>
+#include "compat.h"
 
 void init_console(void) {
-    // Get console handles
-    HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
-    HANDLE hIn = GetStdHandle(STD_INPUT_HANDLE);
-    
-    // Save original console state
-    CONSOLE_SCREEN_BUFFER_INFO csbi;
-    GetConsoleScreenBufferInfo(hOut, &csbi);
-    
-    // First, set window size smaller to allow buffer resize
-    SMALL_RECT tempWindowSize = {0, 0, 79, 24};  
-    SetConsoleWindowInfo(hOut, TRUE, &tempWindowSize);
-    
-    // Set console buffer size to match desired window exactly (no scrollbars)
-    COORD bufferSize = {140, 30};  
-    SetConsoleScreenBufferSize(hOut, bufferSize);
-    
-    // Now set the window size to match buffer exactly
-    SMALL_RECT windowSize = {0, 0, 139, 29};  // 140x30 window
-    SetConsoleWindowInfo(hOut, TRUE, &windowSize);
-    
-    // Set console mode
-    DWORD mode;
-    GetConsoleMode(hIn, &mode);
-    mode &= ~ENABLE_QUICK_EDIT_MODE; // Disable quick edit
-    mode |= ENABLE_EXTENDED_FLAGS;
-    SetConsoleMode(hIn, mode);
-    
-    // Set console code page for box drawing characters
-    SetConsoleOutputCP(437);
-    
-    // Hide cursor
-    CONSOLE_CURSOR_INFO cursorInfo;
-    GetConsoleCursorInfo(hOut, &cursorInfo);
-    cursorInfo.bVisible = FALSE;
-    SetConsoleCursorInfo(hOut, &cursorInfo);
+    term_init();
     
+    // Size the frame buffer to the window; the cursor stays hidden
+    int width, height;
+    term_get_size(&width, &height);
+    fb_resize(width, height);
+    fb_show_cursor(0);
+
     // Clear screen
     clear_screen();
+    fb_flush();
 }
 
 
 void restore_console(void) {
-    HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
-    
-    // Show cursor
-    CONSOLE_CURSOR_INFO cursorInfo;
-    GetConsoleCursorInfo(hOut, &cursorInfo);
-    cursorInfo.bVisible = TRUE;
-    SetConsoleCursorInfo(hOut, &cursorInfo);
-    
     // Reset colors
     set_color(COLOR_WHITE, COLOR_BLACK);
-    
-    // Clear screen
+
+    // Clear screen and show cursor
     clear_screen();
+    fb_show_cursor(1);
+    fb_flush();
+    fb_free();
+    term_restore();
 }
 
 void update_console_size(UIState *state) {
-    CONSOLE_SCREEN_BUFFER_INFO csbi;
-    GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &csbi);
-    state->window_width = csbi.srWindow.Right - csbi.srWindow.Left + 1;
-    state->window_height = csbi.srWindow.Bottom - csbi.srWindow.Top + 1;
+    term_get_size(&state->window_width, &state->window_height);
 }
 
 void clear_screen(void) {
-    HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
-    COORD topLeft = {0, 0};
-    DWORD written;
-    CONSOLE_SCREEN_BUFFER_INFO csbi;
-    
-    GetConsoleScreenBufferInfo(hOut, &csbi);
-    DWORD consoleSize = csbi.dwSize.X * csbi.dwSize.Y;
-    
-    FillConsoleOutputCharacter(hOut, ' ', consoleSize, topLeft, &written);
-    FillConsoleOutputAttribute(hOut, csbi.wAttributes, consoleSize, topLeft, &written);
-    SetConsoleCursorPosition(hOut, topLeft);
+    fb_clear();
 }
 
 void clear_area(int x, int y, int width, int height) {
-    HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
-    DWORD written;
-    
-    // Clear the area line by line
-    for (int row = 0; row < height; row++) {
-        COORD coord = {x, y + row};
-        FillConsoleOutputCharacter(hOut, ' ', width, coord, &written);
-        FillConsoleOutputAttribute(hOut, NORMAL_FG | (NORMAL_BG << 4), width, coord, &written);
-    }
+    fb_fill(x, y, width, height, ' ', NORMAL_FG | (NORMAL_BG << 4));
 }
 
 void gotoxy(int x, int y) {
-    COORD coord = {x, y};
-    SetConsoleCursorPosition(GetStdHandle(STD_OUTPUT_HANDLE), coord);
+    fb_move(x, y);
 }
 
 void set_color(int foreground, int background) {
-    WORD color = (background << 4) | foreground;
-    SetConsoleTextAttribute(GetStdHandle(STD_OUTPUT_HANDLE), color);
+    fb_set_attr((unsigned char)((background << 4) | foreground));
 }
 
 void draw_box(int x, int y, int width, int height, const char *title) {
-    set_color(BORDER_FG, BORDER_BG);
+    unsigned char border = BORDER_FG | (BORDER_BG << 4);
     
     // Top border
-    gotoxy(x, y);
-    printf("%c", BOX_TOP_LEFT);
-    for (int i = 1; i < width - 1; i++) {
-        printf("%c", BOX_HORIZONTAL);
-    }
-    printf("%c", BOX_TOP_RIGHT);
+    fb_fill(x, y, 1, 1, BOX_TOP_LEFT, border);
+    fb_fill(x + 1, y, width - 2, 1, BOX_HORIZONTAL, border);
+    fb_fill(x + width - 1, y, 1, 1, BOX_TOP_RIGHT, border);
     
     // Title
     if (title != NULL && strlen(title) > 0) {
@@ -121,35 +66,134 @@ void draw_box(int x, int y, int width, int height, const char *title) {
         int title_pos = x + (width - title_len - 2) / 2;
         gotoxy(title_pos, y);
         set_color(HEADER_FG, HEADER_BG);
-        printf(" %s ", title);
-        set_color(BORDER_FG, BORDER_BG);
+        fb_printf(" %s ", title);
     }
     
     // Side borders
-    for (int i = 1; i < height - 1; i++) {
-        gotoxy(x, y + i);
-        printf("%c", BOX_VERTICAL);
-        gotoxy(x + width - 1, y + i);
-        printf("%c", BOX_VERTICAL);
-    }
+    fb_fill(x, y + 1, 1, height - 2, BOX_VERTICAL, border);
+    fb_fill(x + width - 1, y + 1, 1, height - 2, BOX_VERTICAL, border);
     
     // Bottom border
-    gotoxy(x, y + height - 1);
-    printf("%c", BOX_BOTTOM_LEFT);
-    for (int i = 1; i < width - 1; i++) {
-        printf("%c", BOX_HORIZONTAL);
+    fb_fill(x, y + height - 1, 1, 1, BOX_BOTTOM_LEFT, border);
+    fb_fill(x + 1, y + height - 1, width - 2, 1, BOX_HORIZONTAL, border);
+    fb_fill(x + width - 1, y + height - 1, 1, 1, BOX_BOTTOM_RIGHT, border);
+    
+    set_color(BORDER_FG, BORDER_BG);
+}
+
+void mark_dirty(UIState *state, unsigned int panels) {
+    state->dirty |= panels;
+}
+
+void mark_dirty_range(DirtyRange *range, int first, int last) {
+    if (first > last) {
+        int tmp = first;
+        first = last;
+        last = tmp;
     }
-    printf("%c", BOX_BOTTOM_RIGHT);
+    
+    if (range->first > range->last) {
+        range->first = first;
+        range->last = last;
+    } else {
+        if (first < range->first) range->first = first;
+        if (last > range->last) range->last = last;
+    }
+}
+
+static void clear_dirty_range(DirtyRange *range) {
+    range->first = 0;
+    range->last = -1;
+}
+
+int ui_needs_redraw(const UIState *state) {
+    return state->dirty != 0 ||
+           state->calendar_dirty_days.first <= state->calendar_dirty_days.last ||
+           state->appointment_dirty_rows.first <= state->appointment_dirty_rows.last ||
+           state->todo_dirty_rows.first <= state->todo_dirty_rows.last;
+}
+
+// Page sizes follow the panel layout in draw_ui: panels are window_height - 3
+// tall, todo rows start below the border and title, appointments below the date
+int ui_appointment_page_size(const UIState *state) {
+    int entries = (state->window_height - 3 - 5) / 2;   // Two lines per entry
+    return entries > 0 ? entries : 1;
+}
+
+int ui_todo_page_size(const UIState *state) {
+    int rows = state->window_height - 3 - 4;
+    return rows > 0 ? rows : 1;
+}
+
+int ui_todo_count(const UIState *state, TodoList *todos) {
+    const int *positions;
+
+    if (state->todo_filter == TODO_FILTER_OVERDUE) {
+        return todo_overdue(todos, state->current_date, &positions);
+    }
+    return todos->count;
+}
+
+int ui_todo_index(const UIState *state, TodoList *todos, int position) {
+    if (position < 0) return -1;
+
+    if (state->todo_filter == TODO_FILTER_OVERDUE) {
+        const int *positions;
+        int count = todo_overdue(todos, state->current_date, &positions);
+        return position < count ? positions[position] : -1;
+    }
+    return position < todos->count ? position : -1;
+}
+
+int ui_appointment_count(const UIState *state, AppointmentList *appointments, Date date) {
+    if (state->calendars) return calset_count_on_date(state->calendars, date);
+    return count_appointments_on_date(appointments, date);
+}
+
+int ui_appointments_on_date(const UIState *state, AppointmentList *appointments, Date date, int first,
+                            AppointmentRef *refs, int max_refs) {
+    int indices[MAX_VISIBLE_ROWS];
+
+    if (state->calendars) return calset_find_on_date(state->calendars, date, first, refs, max_refs);
+
+    // Only the main list: its entries as calendar 0
+    if (max_refs > MAX_VISIBLE_ROWS) max_refs = MAX_VISIBLE_ROWS;
+    int found = find_appointments_by_date_window(appointments, date, first, indices, max_refs);
+    for (int i = 0; i < found; i++) {
+        refs[i].app = &appointments->items[indices[i]];
+        refs[i].calendar = 0;
+        refs[i].index = indices[i];
+    }
+    return found;
+}
+
+// Appointment text color for each calendar, the main one first
+unsigned char ui_calendar_color(int calendar) {
+    static const unsigned char colors[MAX_CALENDARS] = {
+        NORMAL_FG, COLOR_GREEN | COLOR_BRIGHT, COLOR_MAGENTA | COLOR_BRIGHT, COLOR_YELLOW,
+        COLOR_BLUE | COLOR_BRIGHT, COLOR_CYAN, COLOR_RED, COLOR_GREEN
+    };
+    return colors[calendar >= 0 && calendar < MAX_CALENDARS ? calendar : 0];
 }
 
 void draw_ui(UIState *state, AppointmentList *appointments, TodoList *todos) {
-    // Hide cursor during drawing to prevent flicker
-    HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
-    CONSOLE_CURSOR_INFO cursorInfo;
-    GetConsoleCursorInfo(hOut, &cursorInfo);
-    BOOL originalVisible = cursorInfo.bVisible;
-    cursorInfo.bVisible = FALSE;
-    SetConsoleCursorInfo(hOut, &cursorInfo);
+    unsigned long long span = trace_begin();
+    compose_ui(state, appointments, todos);
+    
+    // Only the cells that changed since the last frame reach the console
+    fb_flush();
+    trace_end(TRACE_FRAME, span);
+}
+
+void compose_ui(UIState *state, AppointmentList *appointments, TodoList *todos) {
+    // Everything is composed off-screen and sent in one flush, so there is
+    // no need to hide the cursor or clear the console while drawing.
+    // A new size invalidates the whole frame.
+    unsigned long long compose_span = trace_begin();
+    unsigned long long span;
+    if (fb_resize(state->window_width, state->window_height)) {
+        mark_dirty(state, DIRTY_ALL);
+    }
     
     // Calculate panel dimensions - give appointments panel extra 10 characters
     int appointments_width = (state->window_width / 3) + 10;
@@ -157,31 +201,59 @@ void draw_ui(UIState *state, AppointmentList *appointments, TodoList *todos) {
     int calendar_width = state->window_width - appointments_width - todo_width;
     int panel_height = state->window_height - 3; // Leave room for status bar
     
-    // Only clear what we absolutely need to clear, then draw immediately
-    // Use a single clear operation per panel to minimize flicker
-    
     // Appointments panel
-    clear_area(0, 0, appointments_width, panel_height);
-    draw_appointments_panel(state, appointments, 0, 0, appointments_width, panel_height);
+    span = trace_begin();
+    if (state->dirty & DIRTY_APPOINTMENTS) {
+        clear_area(0, 0, appointments_width, panel_height);
+        draw_appointments_panel(state, appointments, 0, 0, appointments_width, panel_height);
+    } else if (state->appointment_dirty_rows.first <= state->appointment_dirty_rows.last) {
+        draw_appointment_rows(state, appointments, 0, 0, appointments_width, panel_height,
+                              state->appointment_dirty_rows.first, state->appointment_dirty_rows.last);
+    }
+    trace_end(TRACE_APPOINTMENTS_PANEL, span);
     
     // Calendar panel  
-    clear_area(appointments_width, 0, calendar_width, panel_height);
-    draw_calendar_panel(state, appointments_width, 0, calendar_width, panel_height, appointments);
+    span = trace_begin();
+    if (state->dirty & DIRTY_CALENDAR) {
+        clear_area(appointments_width, 0, calendar_width, panel_height);
+        draw_calendar_panel(state, appointments_width, 0, calendar_width, panel_height, appointments, todos);
+    } else if (state->calendar_dirty_days.first <= state->calendar_dirty_days.last) {
+        for (int day = state->calendar_dirty_days.first; day <= state->calendar_dirty_days.last; day++) {
+            draw_calendar_day(state, appointments_width, 0, calendar_width, appointments, todos, day);
+        }
+    }
+    trace_end(TRACE_CALENDAR_PANEL, span);
     
     // Todo panel
-    clear_area(appointments_width + calendar_width, 0, todo_width, panel_height);
-    draw_todo_panel(state, todos, appointments_width + calendar_width, 0, todo_width, panel_height);
+    span = trace_begin();
+    if (state->dirty & DIRTY_TODO) {
+        clear_area(appointments_width + calendar_width, 0, todo_width, panel_height);
+        draw_todo_panel(state, todos, appointments_width + calendar_width, 0, todo_width, panel_height);
+    } else {
+        for (int row = state->todo_dirty_rows.first; row <= state->todo_dirty_rows.last; row++) {
+            draw_todo_row(state, todos, appointments_width + calendar_width, 0, todo_width, panel_height, row);
+        }
+    }
+    trace_end(TRACE_TODO_PANEL, span);
     
     // Status bar
-    clear_area(0, state->window_height - 2, state->window_width, 2);
-    draw_status_bar(state, state->window_height - 2, state->window_width);
-    
-    // Restore cursor visibility
-    cursorInfo.bVisible = originalVisible;
-    SetConsoleCursorInfo(hOut, &cursorInfo);
+    span = trace_begin();
+    if (state->dirty & DIRTY_STATUS) {
+        clear_area(0, state->window_height - 2, state->window_width, 2);
+        draw_status_bar(state, state->window_height - 2, state->window_width);
+    }
+    trace_end(TRACE_STATUS_BAR, span);
+    
+    // The timing overlay shows the latest numbers on every frame
+    state->dirty = state->show_timings ? DIRTY_STATUS : 0;
+    clear_dirty_range(&state->calendar_dirty_days);
+    clear_dirty_range(&state->appointment_dirty_rows);
+    clear_dirty_range(&state->todo_dirty_rows);
+    trace_end(TRACE_COMPOSE, compose_span);
 }
 
-void draw_calendar_panel(UIState *state, int x, int y, int width, int height, AppointmentList *appointments) {
+void draw_calendar_panel(UIState *state, int x, int y, int width, int height, AppointmentList *appointments,
+                         TodoList *todos) {
     char title[32];
     sprintf_s(title, sizeof(title), "Calendar");
     draw_box(x, y, width, height, title);
@@ -190,71 +262,163 @@ void draw_calendar_panel(UIState *state, int x, int y, int width, int height, Ap
     int content_x = x + 2;
     int content_y = y + 2;
     int content_width = width - 4;
-    int content_height = height - 4;
     
     // Month and year header
     set_color(HEADER_FG, HEADER_BG);
     gotoxy(content_x + (content_width - 20) / 2, content_y);
-    printf("%s %d", get_month_name(state->selected_date.month), state->selected_date.year);
+    fb_printf("%s %d", get_month_name(state->selected_date.month), state->selected_date.year);
     
     // Day headers
     set_color(NORMAL_FG, NORMAL_BG);
     gotoxy(content_x + 4, content_y + 2);
-    printf("Sun Mon Tue Wed Thu Fri Sat");
+    fb_printf("Sun Mon Tue Wed Thu Fri Sat");
     
     // Calculate first day of month
     int first_day = get_first_day_of_month(state->selected_date.year, state->selected_date.month);
     int days_in_month = get_days_in_month(state->selected_date.year, state->selected_date.month);
     
+    // Week numbers, one per row of the grid
+    int weeks = (first_day + days_in_month + 6) / 7;
+    set_color(COLOR_GRAY, NORMAL_BG);
+    for (int week = 0; week < weeks; week++) {
+        int day = week == 0 ? 1 : week * 7 - first_day + 1;
+        gotoxy(content_x, content_y + 4 + week * 2);
+        fb_printf("%2d ", get_week_number(state->selected_date.year, state->selected_date.month, day));
+    }
+    
     // Draw calendar days
-    int day = 1;
-    int week = 0;
+    for (int day = 1; day <= days_in_month; day++) {
+        draw_calendar_day(state, x, y, width, appointments, todos, day);
+    }
     
-    while (day <= days_in_month) {
-        gotoxy(content_x, content_y + 4 + week * 2);
+    set_color(NORMAL_FG, NORMAL_BG);
+}
+
+void draw_calendar_day(UIState *state, int x, int y, int width, AppointmentList *appointments, TodoList *todos,
+                       int day) {
+    int first_day = get_first_day_of_month(state->selected_date.year, state->selected_date.month);
+    int days_in_month = get_days_in_month(state->selected_date.year, state->selected_date.month);
+    
+    if (day < 1 || day > days_in_month) return;
+    
+    // Each day cell is 4 characters wide after the 3 character week number
+    int slot = first_day + day - 1;
+    gotoxy(x + 2 + 3 + (slot % 7) * 4, y + 2 + 4 + (slot / 7) * 2);
+    
+    // Create date for this day
+    Date current_day = {state->selected_date.year, state->selected_date.month, day};
+    
+    // Check if this day has appointments
+    int has_appointments = state->calendars ? calset_has_on_date(state->calendars, current_day)
+                                            : has_appointment_on_date(appointments, current_day);
+    
+    // Open todos due this day, straight from the deadline index
+    int has_todos = todos_due_on(todos, current_day) > 0;
+    
+    // Check if this is today
+    if (day == state->current_date.day &&
+        state->selected_date.month == state->current_date.month &&
+        state->selected_date.year == state->current_date.year) {
+        set_color(TODAY_FG, TODAY_BG);
+    }
+    // Check if this is selected
+    else if (day == state->selected_date.day && state->selected_view == VIEW_CALENDAR) {
+        set_color(SELECTED_FG, SELECTED_BG);
+    } else {
+        set_color(NORMAL_FG, NORMAL_BG);
+    }
+    
+    // Print day with todo (+) and appointment (*) indicators
+    fb_printf("%c%2d%c", has_todos ? '+' : ' ', day, has_appointments ? '*' : ' ');
+    
+    set_color(NORMAL_FG, NORMAL_BG);
+}
+
+// Draw one appointment (two lines) at the given absolute list line
+static void draw_appointment_entry(UIState *state, const AppointmentRef *ref, int line, int content_x,
+                                   int content_y) {
+    const Appointment *app = ref->app;
+    int selected = state->selected_view == VIEW_APPOINTMENTS && line == state->cursor_y;
+    
+    gotoxy(content_x, content_y + 2 + (line - state->appointment_scroll));
+    
+    // Highlight if selected, otherwise in the color of its calendar
+    if (selected) {
+        set_color(SELECTED_FG, SELECTED_BG);
+    } else {
+        set_color(ui_calendar_color(ref->calendar), NORMAL_BG);
+    }
+    
+    // Check if this is a multi-day event
+    int is_multiday = 0;
+    DateTime end_time = app->date_time;
+    
+    if (app->duration_minutes > 0) {
+        // Calculate end date and time
+        int total_minutes = end_time.minute + app->duration_minutes;
         
-        // Print week number
-        set_color(COLOR_GRAY, NORMAL_BG);
-        printf("%2d ", get_week_number(state->selected_date.year, state->selected_date.month, day));
+        end_time.minute = total_minutes % 60;
+        int total_hours = end_time.hour + (total_minutes / 60);
+        
+        end_time.hour = total_hours % 24;
+        int total_days = total_hours / 24;
+        
+        // Add days
+        end_time.day += total_days;
         
-        // Print days
-        for (int dow = 0; dow < 7; dow++) {
-            if (week == 0 && dow < first_day) {
-                printf("    ");
-            } else if (day <= days_in_month) {
-                // Create date for this day
-                Date current_day = {state->selected_date.year, state->selected_date.month, day};
-                
-                // Check if this day has appointments
-                int has_appointments = has_appointment_on_date(appointments, current_day);
-                
-                // Check if this is today
-                if (day == state->current_date.day &&
-                    state->selected_date.month == state->current_date.month &&
-                    state->selected_date.year == state->current_date.year) {
-                    set_color(TODAY_FG, TODAY_BG);
-                }
-                // Check if this is selected
-                else if (day == state->selected_date.day && state->selected_view == VIEW_CALENDAR) {
-                    set_color(SELECTED_FG, SELECTED_BG);
-                } else {
-                    set_color(NORMAL_FG, NORMAL_BG);
-                }
-                
-                // Print day with appointment indicator
-                if (has_appointments) {
-                    printf(" %2d*", day);  // Add asterisk for appointments
-                } else {
-                    printf(" %2d ", day);
-                }
-                day++;
-            } else {
-                printf("    ");
+        // Handle month/year overflow (simplified)
+        while (end_time.day > get_days_in_month(end_time.year, end_time.month)) {
+            end_time.day -= get_days_in_month(end_time.year, end_time.month);
+            end_time.month++;
+            if (end_time.month > 12) {
+                end_time.month = 1;
+                end_time.year++;
             }
         }
-        week++;
+        
+        // Check if it spans multiple days
+        is_multiday = (app->date_time.year != end_time.year ||
+                      app->date_time.month != end_time.month ||
+                      app->date_time.day != end_time.day);
     }
     
+    if (is_multiday && app->duration_minutes > 0) {
+        // Multi-day format: "Jul 21, 2025 01:00 -> Jul 24, 2025 10:00"
+        const char* months[] = {"", "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                              "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+        fb_printf("- %s %d, %d %02d:%02d -> %s %d, %d %02d:%02d",
+               months[app->date_time.month],
+               app->date_time.day,
+               app->date_time.year,
+               app->date_time.hour,
+               app->date_time.minute,
+               months[end_time.month],
+               end_time.day,
+               end_time.year,
+               end_time.hour,
+               end_time.minute);
+    } else {
+        // Single day format: "01:00 -> 15:00" or just "01:00"
+        fb_printf("- %02d:%02d", 
+               app->date_time.hour,
+               app->date_time.minute);
+        
+        if (app->duration_minutes > 0) {
+            fb_printf(" -> %02d:%02d", end_time.hour, end_time.minute);
+        }
+    }
+    
+    // Reminder lead time, e.g. "!15m"
+    if (app->reminder_minutes > 0) {
+        char lead[32];
+        format_duration_compact(app->reminder_minutes, lead, sizeof(lead));
+        fb_printf("  !%s", lead);
+    }
+    
+    // Description on next line
+    set_color(selected ? NORMAL_FG : ui_calendar_color(ref->calendar), NORMAL_BG);
+    gotoxy(content_x + 2, content_y + 3 + (line - state->appointment_scroll));
+    fb_printf("%.30s", app->description);
     set_color(NORMAL_FG, NORMAL_BG);
 }
 
@@ -264,172 +428,178 @@ void draw_appointments_panel(UIState *state, AppointmentList *appointments, int
     // Content area
     int content_x = x + 2;
     int content_y = y + 2;
-    int content_width = width - 4;
     
     // Show date
     set_color(HEADER_FG, HEADER_BG);
     gotoxy(content_x, content_y);
-    printf("%s %d, %d", get_month_name(state->selected_date.month), 
+    fb_printf("%s %d, %d", get_month_name(state->selected_date.month), 
            state->selected_date.day, state->selected_date.year);
     
-    // Show appointments for selected date
+    // Only the visible window is fetched; entries above the scroll offset are
+    // skipped by the search instead of being walked here
     set_color(NORMAL_FG, NORMAL_BG);
-    int line = 0;
-    int found = 0;
-    int appointment_indices[100];  // Store actual appointment indices
-    int appointment_count = 0;
+    int first = state->appointment_scroll / 2;
+    int visible = ui_appointment_page_size(state);
+    AppointmentRef refs[MAX_VISIBLE_ROWS];
+    if (visible > MAX_VISIBLE_ROWS) visible = MAX_VISIBLE_ROWS;
     
-    // Find all appointments that span the selected date using the existing function
-    appointment_count = find_appointments_by_date(appointments, state->selected_date, appointment_indices, 100);
+    int shown = ui_appointments_on_date(state, appointments, state->selected_date, first, refs, visible);
     
-    for (int idx = 0; idx < appointment_count; idx++) {
-        int i = appointment_indices[idx];  // Actual appointment index
-        
-        if (line >= state->appointment_scroll && line - state->appointment_scroll < height - 6) {
-            gotoxy(content_x, content_y + 2 + (line - state->appointment_scroll));
-            
-            // Highlight if selected
-            if (state->selected_view == VIEW_APPOINTMENTS && line == state->cursor_y) {
-                set_color(SELECTED_FG, SELECTED_BG);
-            }
-            
-            // Check if this is a multi-day event
-            int is_multiday = 0;
-            DateTime end_time = appointments->items[i].date_time;
-            
-            if (appointments->items[i].duration_minutes > 0) {
-                // Calculate end date and time
-                int total_minutes = end_time.minute + appointments->items[i].duration_minutes;
-                
-                end_time.minute = total_minutes % 60;
-                int total_hours = end_time.hour + (total_minutes / 60);
-                
-                end_time.hour = total_hours % 24;
-                int total_days = total_hours / 24;
-                
-                // Add days
-                end_time.day += total_days;
-                
-                // Handle month/year overflow (simplified)
-                while (end_time.day > get_days_in_month(end_time.year, end_time.month)) {
-                    end_time.day -= get_days_in_month(end_time.year, end_time.month);
-                    end_time.month++;
-                    if (end_time.month > 12) {
-                        end_time.month = 1;
-                        end_time.year++;
-                    }
-                }
-                
-                // Check if it spans multiple days
-                is_multiday = (appointments->items[i].date_time.year != end_time.year ||
-                              appointments->items[i].date_time.month != end_time.month ||
-                              appointments->items[i].date_time.day != end_time.day);
-            }
-            
-            if (is_multiday && appointments->items[i].duration_minutes > 0) {
-                // Multi-day format: "Jul 21, 2025 01:00 -> Jul 24, 2025 10:00"
-                const char* months[] = {"", "Jan", "Feb", "Mar", "Apr", "May", "Jun",
-                                      "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
-                printf("- %s %d, %d %02d:%02d -> %s %d, %d %02d:%02d",
-                       months[appointments->items[i].date_time.month],
-                       appointments->items[i].date_time.day,
-                       appointments->items[i].date_time.year,
-                       appointments->items[i].date_time.hour,
-                       appointments->items[i].date_time.minute,
-                       months[end_time.month],
-                       end_time.day,
-                       end_time.year,
-                       end_time.hour,
-                       end_time.minute);
-            } else {
-                // Single day format: "01:00 -> 15:00" or just "01:00"
-                printf("- %02d:%02d", 
-                       appointments->items[i].date_time.hour,
-                       appointments->items[i].date_time.minute);
-                
-                if (appointments->items[i].duration_minutes > 0) {
-                    printf(" -> %02d:%02d", end_time.hour, end_time.minute);
-                }
-            }
-            
-            set_color(NORMAL_FG, NORMAL_BG);
-            
-            // Description on next line
-            gotoxy(content_x + 2, content_y + 3 + (line - state->appointment_scroll));
-            printf("%.30s", appointments->items[i].description);
-            
-            line += 2;
-        } else {
-            line += 2; // Still increment line count for appointments that are scrolled off
-        }
-        found = 1;
+    for (int idx = 0; idx < shown; idx++) {
+        draw_appointment_entry(state, &refs[idx], (first + idx) * 2, content_x, content_y);
     }
     
-    if (!found) {
+    if (shown == 0 && first == 0) {
         gotoxy(content_x, content_y + 2);
-        printf("(none)");
+        fb_printf("(none)");
+    }
+}
+
+void draw_appointment_rows(UIState *state, AppointmentList *appointments, int x, int y, int width, int height,
+                           int first, int last) {
+    int content_x = x + 2;
+    int content_y = y + 2;
+    int top = state->appointment_scroll / 2;
+    int visible = ui_appointment_page_size(state);
+    AppointmentRef refs[MAX_VISIBLE_ROWS];
+    if (visible > MAX_VISIBLE_ROWS) visible = MAX_VISIBLE_ROWS;
+    
+    // Clip to the visible window, then fetch just those entries
+    if (first < top) first = top;
+    if (last > top + visible - 1) last = top + visible - 1;
+    if (first > last) return;
+    
+    int shown = ui_appointments_on_date(state, appointments, state->selected_date, first, refs, last - first + 1);
+    
+    for (int idx = 0; idx < shown; idx++) {
+        int line = (first + idx) * 2;
+        
+        // Wipe both lines of the entry and restore the right border it may have overdrawn
+        int row_y = content_y + 2 + (line - state->appointment_scroll);
+        clear_area(content_x, row_y, width - 3, 2);
+        fb_fill(x + width - 1, row_y, 1, 2, BOX_VERTICAL, BORDER_FG | (BORDER_BG << 4));
+        
+        draw_appointment_entry(state, &refs[idx], line, content_x, content_y);
     }
 }
 
 void draw_todo_panel(UIState *state, TodoList *todos, int x, int y, int width, int height) {
-    draw_box(x, y, width, height, "TODO");
+    const int *positions;
+    char title[32];
+    int overdue = todo_overdue(todos, state->current_date, &positions);
+    int count = ui_todo_count(state, todos);
+    
+    if (state->todo_filter == TODO_FILTER_OVERDUE) {
+        sprintf_s(title, sizeof(title), "TODO: overdue");
+    } else if (overdue > 0) {
+        sprintf_s(title, sizeof(title), "TODO: %d overdue", overdue);
+    } else {
+        sprintf_s(title, sizeof(title), "TODO");
+    }
+    draw_box(x, y, width, height, title);
     
+    for (int row = 0; row < height - 4 && state->todo_scroll + row < count; row++) {
+        draw_todo_row(state, todos, x, y, width, height, row);
+    }
+}
+
+void draw_todo_row(UIState *state, TodoList *todos, int x, int y, int width, int height, int row) {
     // Content area
     int content_x = x + 2;
     int content_y = y + 2;
-    int content_width = width - 4;
+    int position = state->todo_scroll + row;
+    
+    if (row < 0 || row >= height - 4) return;
     
+    clear_area(content_x, content_y + row, width - 3, 1);
+    fb_fill(x + width - 1, content_y + row, 1, 1, BOX_VERTICAL, BORDER_FG | (BORDER_BG << 4));
+    
+    int i = ui_todo_index(state, todos, position);
+    if (i < 0) return;
+    
+    TodoItem *todo = todo_at(todos, i);
+    
+    gotoxy(content_x, content_y + row);
     set_color(NORMAL_FG, NORMAL_BG);
     
-    int visible_todos = 0;
-    for (int i = 0; i < todos->count && visible_todos < height - 4; i++) {
-        if (i >= state->todo_scroll) {
-            gotoxy(content_x, content_y + visible_todos);
-            
-            // Highlight if selected
-            if (state->selected_view == VIEW_TODO && visible_todos == state->cursor_y) {
-                set_color(SELECTED_FG, SELECTED_BG);
-            }
-            
-            // Priority indicator
-            char priority_char = ' ';
-            if (todos->items[i].priority == 1) priority_char = '!';
-            else if (todos->items[i].priority == 2) priority_char = '*';
-            
-            // Completion status
-            char status = todos->items[i].completed ? 'X' : ' ';
-            
-            printf("%d. [%c] %c %.25s", i + 1, status, priority_char, todos->items[i].description);
-            
-            set_color(NORMAL_FG, NORMAL_BG);
-            visible_todos++;
-        }
+    // Highlight if selected, otherwise flag overdue items
+    if (state->selected_view == VIEW_TODO && row == state->cursor_y) {
+        set_color(SELECTED_FG, SELECTED_BG);
+    } else if (todo_is_overdue(todo, state->current_date)) {
+        set_color(TODAY_FG, TODAY_BG);
+    }
+
+    // Priority indicator
+    char priority_char = ' ';
+    if (todo->priority == 1) priority_char = '!';
+    else if (todo->priority == 2) priority_char = '*';
+    
+    // Completion status
+    char status = todo->completed ? 'X' : ' ';
+    
+    fb_printf("%d. [%c] %c ", position + 1, status, priority_char);
+    if (todo->due.year) {
+        fb_printf("%02d/%02d ", todo->due.month, todo->due.day);
     }
+    fb_printf("%.25s", todo->description);
+    
+    set_color(NORMAL_FG, NORMAL_BG);
 }
 
 void draw_status_bar(UIState *state, int y, int width) {
     // Clear status bar area
-    gotoxy(0, y);
+    clear_area(0, y, width, 1);
     set_color(NORMAL_FG, NORMAL_BG);
-    for (int i = 0; i < width; i++) printf(" ");
     
     // Draw status bar content
     gotoxy(2, y);
-    printf("Help:h  Quit:q  Add:a  Delete:d  Edit:e  Tab:Switch View");
+    fb_printf("Help:h  Quit:q  Add:a  Delete:d  Edit:e  Tab:Switch View");
+    
+    // Calendar legend; the number key toggles that calendar, hidden ones are grey
+    if (state->calendars && state->calendars->count > 1) {
+        int legend_x = 61;
+        for (int i = 0; i < state->calendars->count; i++) {
+            const Calendar *calendar = &state->calendars->calendars[i];
+            int length = (int)strlen(calendar->name) + 3;
+            if (legend_x + length > width - 21) break;
+            
+            set_color(calendar->visible ? ui_calendar_color(i) : COLOR_GRAY, NORMAL_BG);
+            gotoxy(legend_x, y);
+            fb_printf("%d:%s", i + 1, calendar->name);
+            legend_x += length;
+        }
+        set_color(NORMAL_FG, NORMAL_BG);
+    }
     
     // Show current view
     gotoxy(width - 20, y);
     switch (state->selected_view) {
         case VIEW_CALENDAR:
-            printf("[Calendar View]");
+            fb_printf("[Calendar View]");
             break;
         case VIEW_APPOINTMENTS:
-            printf("[Appointments]");
+            fb_printf("[Appointments]");
             break;
         case VIEW_TODO:
-            printf("[TODO List]");
+            fb_printf("[TODO List]");
             break;
     }
+    
+    // Reminders stand out on the line below
+    if (state->status_message[0]) {
+        set_color(TODAY_FG, NORMAL_BG);
+        gotoxy(2, y + 1);
+        fb_printf("%.*s", width > 4 ? width - 4 : 0, state->status_message);
+        set_color(NORMAL_FG, NORMAL_BG);
+    } else if (state->show_timings) {
+        // p50/p99 of the latest spans of each traced path, up to the previous frame
+        char timings[512];
+        trace_describe_live(timings, sizeof(timings));
+        set_color(COLOR_GRAY, NORMAL_BG);
+        gotoxy(2, y + 1);
+        fb_printf("p50/p99 %.*s", width > 12 ? width - 12 : 0, timings);
+        set_color(NORMAL_FG, NORMAL_BG);
+    }
 }
 
 void draw_help_screen(UIState *state) {
@@ -445,40 +615,43 @@ void draw_help_screen(UIState *state) {
     
     set_color(HEADER_FG, HEADER_BG);
     gotoxy(help_x + 2, help_y + 2);
-    printf("KEYBOARD SHORTCUTS");
+    fb_printf("KEYBOARD SHORTCUTS");
     
     set_color(NORMAL_FG, NORMAL_BG);
     
     // Navigation section
     gotoxy(help_x + 2, help_y + 4);
-    printf("Navigation:");
+    fb_printf("Navigation:");
     gotoxy(help_x + 4, help_y + 5);
-    printf("Arrow Keys     Move cursor/Navigate calendar");
+    fb_printf("Arrow Keys     Move cursor/Navigate calendar");
     gotoxy(help_x + 4, help_y + 6);
-    printf("Tab            Switch between panels");
+    fb_printf("Tab            Switch between panels");
     gotoxy(help_x + 4, help_y + 7);
-    printf("PgUp/PgDn      Previous/Next month or scroll");
+    fb_printf("PgUp/PgDn      Previous/Next month or scroll");
     gotoxy(help_x + 4, help_y + 8);
-    printf("Home           Jump to today");
+    fb_printf("Home           Jump to today");
     
     // Actions section
     gotoxy(help_x + 2, help_y + 10);
-    printf("Actions:");
+    fb_printf("Actions:");
     gotoxy(help_x + 4, help_y + 11);
-    printf("a              Add appointment or todo");
+    fb_printf("a              Add appointment or todo");
     gotoxy(help_x + 4, help_y + 12);
-    printf("d              Delete selected item");
+    fb_printf("d              Delete selected item");
     gotoxy(help_x + 4, help_y + 13);
-    printf("e              Edit selected item");
+    fb_printf("e              Edit selected item");
     gotoxy(help_x + 4, help_y + 14);
-    printf("Space          Toggle todo completion");
+    fb_printf("Space          Toggle todo completion");
     gotoxy(help_x + 4, help_y + 15);
-    printf("q              Quit and save");
+    fb_printf("o              Show only overdue todos (again for all)");
+    gotoxy(help_x + 4, help_y + 16);
+    fb_printf("1-8            Show/hide a calendar");
+    gotoxy(help_x + 4, help_y + 17);
+    fb_printf("q              Quit and save");
     
-    gotoxy(help_x + 2, help_y + 17);
+    gotoxy(help_x + 2, help_y + 18);
     set_color(HEADER_FG, HEADER_BG);
-    printf("Press any key to return...");
+    fb_printf("Press any key to return...");
     
     set_color(NORMAL_FG, NORMAL_BG);
-    _getch();
 }
\ No newline at end of file
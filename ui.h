@@ -1,10 +1,12 @@
 #ifndef UI_H
 #define UI_H
 
-#include <windows.h>
 #include "calendar.h"
 #include "appointments.h"
 #include "todo.h"
+#include "calset.h"
+#include "render.h"
+#include "term.h"
 
 // Color definitions
 #define COLOR_BLACK     0
@@ -37,6 +39,30 @@ typedef enum {
     VIEW_TODO
 } ViewType;
 
+// Which todos the todo panel lists
+typedef enum {
+    TODO_FILTER_ALL,
+    TODO_FILTER_OVERDUE
+} TodoFilter;
+
+// Panels that need a full redraw (UIState.dirty)
+#define DIRTY_CALENDAR      0x01
+#define DIRTY_APPOINTMENTS  0x02
+#define DIRTY_TODO          0x04
+#define DIRTY_STATUS        0x08
+#define DIRTY_ALL           (DIRTY_CALENDAR | DIRTY_APPOINTMENTS | DIRTY_TODO | DIRTY_STATUS)
+
+// Longest status bar message (reminders)
+#define MAX_STATUS_MESSAGE  160
+
+// Upper bound on list rows fetched for one panel, whatever the window height
+#define MAX_VISIBLE_ROWS    256
+
+// Inclusive range of rows (or calendar days) to redraw; empty when first > last
+typedef struct {
+    int first, last;
+} DirtyRange;
+
 // UI State
 typedef struct {
     int cursor_x, cursor_y;
@@ -44,12 +70,17 @@ typedef struct {
     Date current_date;
     Date selected_date;
     int window_width, window_height;
-    int appointment_scroll;
+    int appointment_scroll;         // First visible line (two lines per appointment)
     int appointment_display_index;  // Which appointment is selected in the display
-    int todo_scroll;
-    HANDLE console_output;
-    HANDLE console_input;
-    CONSOLE_SCREEN_BUFFER_INFO original_console_info;
+    int todo_scroll;                // First visible todo; cursor_y is relative to it
+    TodoFilter todo_filter;
+    CalendarSet *calendars;             // Calendars merged into the views; NULL for the main list alone
+    char status_message[MAX_STATUS_MESSAGE];   // Shown under the shortcuts until the next key
+    int show_timings;                   // Live trace percentiles in place of the status message
+    unsigned int dirty;                 // DIRTY_* panels to redraw in full
+    DirtyRange calendar_dirty_days;     // Day cells of the shown month
+    DirtyRange appointment_dirty_rows;  // Display indices in the appointment list
+    DirtyRange todo_dirty_rows;         // Visible rows of the todo list
 } UIState;
 
 // Box drawing characters (using ASCII for compatibility)
@@ -74,10 +105,28 @@ void clear_area(int x, int y, int width, int height);
 void gotoxy(int x, int y);
 void set_color(int foreground, int background);
 void draw_box(int x, int y, int width, int height, const char *title);
+void mark_dirty(UIState *state, unsigned int panels);
+void mark_dirty_range(DirtyRange *range, int first, int last);
+int ui_needs_redraw(const UIState *state);
+int ui_appointment_page_size(const UIState *state);
+int ui_todo_page_size(const UIState *state);
+int ui_todo_count(const UIState *state, TodoList *todos);                 // Rows the filter lets through
+int ui_todo_index(const UIState *state, TodoList *todos, int position);  // List index of a row, -1 past the end
+int ui_appointment_count(const UIState *state, AppointmentList *appointments, Date date);
+int ui_appointments_on_date(const UIState *state, AppointmentList *appointments, Date date, int first,
+                            AppointmentRef *refs, int max_refs);
+unsigned char ui_calendar_color(int calendar);
 void draw_ui(UIState *state, AppointmentList *appointments, TodoList *todos);
-void draw_calendar_panel(UIState *state, int x, int y, int width, int height, AppointmentList *appointments);
+void compose_ui(UIState *state, AppointmentList *appointments, TodoList *todos);   // Frame buffer only, no flush
+void draw_calendar_panel(UIState *state, int x, int y, int width, int height, AppointmentList *appointments,
+                         TodoList *todos);
+void draw_calendar_day(UIState *state, int x, int y, int width, AppointmentList *appointments, TodoList *todos,
+                       int day);
 void draw_appointments_panel(UIState *state, AppointmentList *appointments, int x, int y, int width, int height);
+void draw_appointment_rows(UIState *state, AppointmentList *appointments, int x, int y, int width, int height,
+                           int first, int last);
 void draw_todo_panel(UIState *state, TodoList *todos, int x, int y, int width, int height);
+void draw_todo_row(UIState *state, TodoList *todos, int x, int y, int width, int height, int row);
 void draw_status_bar(UIState *state, int y, int width);
 void draw_help_screen(UIState *state);
 
@@ -0,0 +1,154 @@
+#include "watch.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "compat.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif
+
+// Split a path into its directory (copied out) and its final component
+static const char *split_path(const char *path, char *directory, size_t directory_size) {
+    const char *name = path;
+
+    for (const char *p = path; *p; p++) {
+        if (*p == '/' || *p == '\\') name = p + 1;
+    }
+
+    if (name == path) {
+        strcpy_s(directory, directory_size, ".");
+    } else {
+        // Keep the separator only for the root itself
+        size_t length = name - path > 1 ? (size_t)(name - path - 1) : 1;
+        if (length >= directory_size) length = directory_size - 1;
+        memcpy(directory, path, length);
+        directory[length] = '\0';
+    }
+    return name;
+}
+
+// Appends id unless it is already listed
+static int report(int *ids, int count, int max_ids, int id) {
+    for (int i = 0; i < count; i++) {
+        if (ids[i] == id) return count;
+    }
+    if (count < max_ids) ids[count++] = id;
+    return count;
+}
+
+#ifdef _WIN32
+// Last write time and size; a directory notification doesn't say which file
+static void stamp_file(WatchedFile *file) {
+    WIN32_FILE_ATTRIBUTE_DATA data;
+
+    if (GetFileAttributesExA(file->path, GetFileExInfoStandard, &data)) {
+        file->mtime = ((long long)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+        file->size = ((long long)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+    } else {
+        file->mtime = -1;
+        file->size = -1;
+    }
+}
+#endif
+
+void watcher_init(FileWatcher *watcher) {
+    memset(watcher, 0, sizeof(*watcher));
+}
+
+int watcher_add(FileWatcher *watcher, const char *path, int id) {
+    char directory[MAX_WATCH_PATH];
+
+    if (watcher->count >= MAX_WATCHED_FILES) return 0;
+
+    WatchedFile *file = &watcher->files[watcher->count];
+    strcpy_s(file->path, sizeof(file->path), path);
+    file->name = split_path(file->path, directory, sizeof(directory));
+    file->id = id;
+
+#ifdef _WIN32
+    HANDLE handle = FindFirstChangeNotificationA(directory, FALSE, FILE_NOTIFY_CHANGE_FILE_NAME |
+                                                 FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE);
+    if (handle == INVALID_HANDLE_VALUE) return 0;
+    file->watch = watcher->handle_count;
+    watcher->handles[watcher->handle_count++] = (intptr_t)handle;
+    stamp_file(file);
+#elif defined(__linux__)
+    if (watcher->handle_count == 0) {
+        int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd < 0) return 0;
+        watcher->handles[watcher->handle_count++] = fd;
+    }
+
+    // A new version lands either by closing a file written in place or by
+    // renaming a finished one over it; partial writes are never reported
+    file->watch = inotify_add_watch((int)watcher->handles[0], directory, IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (file->watch < 0) return 0;
+#else
+    return 0;
+#endif
+
+    watcher->count++;
+    return 1;
+}
+
+int watcher_poll(FileWatcher *watcher, int *ids, int max_ids) {
+    int count = 0;
+
+#ifdef _WIN32
+    for (int i = 0; i < watcher->count; i++) {
+        WatchedFile *file = &watcher->files[i];
+        HANDLE handle = (HANDLE)watcher->handles[file->watch];
+        if (WaitForSingleObject(handle, 0) != WAIT_OBJECT_0) continue;
+        FindNextChangeNotification(handle);
+
+        long long mtime = file->mtime;
+        long long size = file->size;
+        stamp_file(file);
+        if (file->mtime != mtime || file->size != size) count = report(ids, count, max_ids, file->id);
+    }
+#elif defined(__linux__)
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t length;
+
+    if (watcher->handle_count == 0) return 0;
+
+    while ((length = read((int)watcher->handles[0], buffer, sizeof(buffer))) > 0) {
+        for (char *p = buffer; p < buffer + length; ) {
+            const struct inotify_event *event = (const struct inotify_event*)p;
+
+            for (int i = 0; i < watcher->count; i++) {
+                WatchedFile *file = &watcher->files[i];
+
+                // An overflowed queue lost events; every file may have changed
+                if ((event->mask & IN_Q_OVERFLOW) ||
+                    (event->wd == file->watch && event->len && strcmp(event->name, file->name) == 0)) {
+                    count = report(ids, count, max_ids, file->id);
+                }
+            }
+            p += sizeof(struct inotify_event) + event->len;
+        }
+    }
+#else
+    (void)watcher;
+    (void)ids;
+    (void)max_ids;
+#endif
+
+    return count;
+}
+
+void watcher_close(FileWatcher *watcher) {
+#ifdef _WIN32
+    for (int i = 0; i < watcher->handle_count; i++) {
+        FindCloseChangeNotification((HANDLE)watcher->handles[i]);
+    }
+#elif defined(__linux__)
+    if (watcher->handle_count > 0) close((int)watcher->handles[0]);
+#endif
+    watcher_init(watcher);
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+#ifndef WATCH_H
+#define WATCH_H
+
+#include <stdint.h>
+
+#define MAX_WATCHED_FILES   8
+#define MAX_WATCH_PATH      260
+
+// A file whose changes are reported under the caller's id
+typedef struct {
+    char path[MAX_WATCH_PATH];
+    const char *name;           // Final component of path
+    int id;
+    int watch;                  // inotify watch descriptor, or index into handles on Windows
+    long long mtime;            // Windows: compared after a directory notification
+    long long size;
+} WatchedFile;
+
+// Watches the directories holding the files rather than the files, so a
+// file replaced by rename (as sync tools and editors save) is still seen.
+// Linux uses one inotify descriptor, Windows one change notification per
+// file; elsewhere nothing is reported.
+typedef struct {
+    WatchedFile files[MAX_WATCHED_FILES];
+    int count;
+    intptr_t handles[MAX_WATCHED_FILES];    // For term_watch_handles
+    int handle_count;
+} FileWatcher;
+
+void watcher_init(FileWatcher *watcher);
+int watcher_add(FileWatcher *watcher, const char *path, int id);
+// Consume pending notifications (and re-arm them); returns the ids of files
+// that changed, each once
+int watcher_poll(FileWatcher *watcher, int *ids, int max_ids);
+void watcher_close(FileWatcher *watcher);
+
+#endif // WATCH_H
\ No newline at end of file
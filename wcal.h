@@ -0,0 +1,28 @@
+#ifndef WCAL_H
+#define WCAL_H
+
+// The core library, libwcal: dates, appointment and todo lists, the data
+// archive and ICS/CSV files, queries, reminders, calendar sets and their
+// live reload. It has no console code and builds the same on Windows and
+// POSIX, so tools link it directly:
+//     make lib        (libwcal.a; libwcal.lib with MSVC)
+// The console application (ui, render, term_*, input, dialog, batch) and
+// the query server are built on top.
+
+#include "calendar.h"
+#include "appointments.h"
+#include "todo.h"
+#include "storage.h"
+#include "archive.h"
+#include "query.h"
+#include "reminder.h"
+#include "calset.h"
+#include "sync.h"
+#include "watch.h"
+#include "trace.h"
+#include "wmem.h"
+#include "cow.h"
+#include "crc32c.h"
+#include "psort.h"
+
+#endif // WCAL_H
\ No newline at end of file
@@ -0,0 +1,140 @@
+#include "wmem.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Sits in front of every block; the union keeps the block itself aligned
+// for any type
+typedef union {
+    struct {
+        size_t size;
+        int subsystem;
+    } info;
+    long double align_float;
+    long long align_integer;
+    void *align_pointer;
+} MemHeader;
+
+// The last row is the total over every subsystem
+#define MEM_TOTAL MEM_SUBSYSTEM_COUNT
+
+static const char *const g_subsystem_names[MEM_SUBSYSTEM_COUNT + 1] = {
+    "appointments", "todos", "indexes", "render", "total"
+};
+
+int g_mem_report;
+
+static MemStats g_stats[MEM_SUBSYSTEM_COUNT + 1];
+
+// live and used as of wmem_report_checkpoint
+static MemStats g_checkpoint[MEM_SUBSYSTEM_COUNT + 1];
+static int g_have_checkpoint;
+
+static void count_live(int subsystem, size_t added, size_t removed) {
+    int rows[2] = {subsystem, MEM_TOTAL};
+
+    for (int i = 0; i < 2; i++) {
+        MemStats *stats = &g_stats[rows[i]];
+        stats->live += added;
+        stats->live -= removed;
+        if (stats->live > stats->peak) stats->peak = stats->live;
+    }
+}
+
+void *wmem_malloc(MemSubsystem subsystem, size_t size) {
+    MemHeader *header = (MemHeader*)malloc(sizeof(MemHeader) + size);
+    if (!header) return NULL;
+
+    header->info.size = size;
+    header->info.subsystem = subsystem;
+    g_stats[subsystem].allocations++;
+    g_stats[MEM_TOTAL].allocations++;
+    count_live(subsystem, size, 0);
+    return header + 1;
+}
+
+void *wmem_calloc(MemSubsystem subsystem, size_t count, size_t size) {
+    if (size && count > ((size_t)-1 - sizeof(MemHeader)) / size) return NULL;
+
+    void *block = wmem_malloc(subsystem, count * size);
+    if (block) memset(block, 0, count * size);
+    return block;
+}
+
+void *wmem_realloc(MemSubsystem subsystem, void *block, size_t size) {
+    if (!block) return wmem_malloc(subsystem, size);
+
+    MemHeader *header = (MemHeader*)block - 1;
+    size_t old_size = header->info.size;
+    int old_subsystem = header->info.subsystem;
+
+    // On failure the old block, and its accounting, stay as they were
+    header = (MemHeader*)realloc(header, sizeof(MemHeader) + size);
+    if (!header) return NULL;
+
+    header->info.size = size;
+    g_stats[old_subsystem].reallocations++;
+    g_stats[MEM_TOTAL].reallocations++;
+    count_live(old_subsystem, size, old_size);
+    return header + 1;
+}
+
+void wmem_free(void *block) {
+    if (!block) return;
+
+    MemHeader *header = (MemHeader*)block - 1;
+    g_stats[header->info.subsystem].frees++;
+    g_stats[MEM_TOTAL].frees++;
+    count_live(header->info.subsystem, 0, header->info.size);
+    free(header);
+}
+
+void wmem_stats(MemSubsystem subsystem, MemStats *stats) {
+    *stats = g_stats[subsystem];
+}
+
+// Bytes, exact, so reports from different releases can be compared. Peak
+// and the counts cover the whole run; allocs minus frees is what leaked.
+static void print_report(void) {
+    fprintf(stderr, "wcal memory: live and used %s; peak and counts for the whole run\n",
+            g_have_checkpoint ? "with the data loaded" : "at exit");
+    fprintf(stderr, "%-13s %12s %12s %12s %9s %9s %9s %6s\n",
+            "subsystem", "live", "peak", "used", "allocs", "reallocs", "frees", "waste");
+
+    for (int i = 0; i <= MEM_TOTAL; i++) {
+        MemStats row = g_stats[i];
+        char waste[16] = "-";
+
+        if (g_have_checkpoint) {
+            row.live = g_checkpoint[i].live;
+            row.used = g_checkpoint[i].used;
+        }
+
+        // Waste is what's live but not data: spare capacity plus the unused
+        // tails of fixed-size text fields
+        if (row.used && row.live) {
+            snprintf(waste, sizeof(waste), "%.1f%%", 100.0 * (double)(row.live - row.used) / (double)row.live);
+        }
+        fprintf(stderr, "%-13s %12zu %12zu %12zu %9llu %9llu %9llu %6s\n", g_subsystem_names[i],
+                row.live, row.peak, row.used, row.allocations, row.reallocations, row.frees, waste);
+    }
+}
+
+void wmem_enable_report(void) {
+    if (g_mem_report) return;
+    g_mem_report = 1;
+    atexit(print_report);
+}
+
+void wmem_report_checkpoint(const size_t used[MEM_SUBSYSTEM_COUNT]) {
+    if (!g_mem_report) return;
+
+    memcpy(g_checkpoint, g_stats, sizeof(g_checkpoint));
+    for (int i = 0; i < MEM_SUBSYSTEM_COUNT; i++) {
+        if (used[i] <= g_checkpoint[i].live) g_checkpoint[i].used = used[i];
+
+        // Unmeasured subsystems count as all data in the total
+        g_checkpoint[MEM_TOTAL].used += g_checkpoint[i].used ? g_checkpoint[i].used : g_checkpoint[i].live;
+    }
+    g_have_checkpoint = 1;
+}
\ No newline at end of file
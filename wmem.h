@@ -0,0 +1,47 @@
+#ifndef WMEM_H
+#define WMEM_H
+
+#include <stddef.h>
+
+// Accounted allocation for the data model. Every block carries a small
+// header with its size and subsystem, so frees and reallocs keep per-
+// subsystem byte counts exact. Blocks from these functions must be released
+// with wmem_free (and never with free), and the reverse. wcal allocates from
+// one thread, so the counters are plain integers; snapshots read on other
+// threads hand their blocks back to it to free (see cow.h).
+typedef enum {
+    MEM_APPOINTMENTS,       // Appointment arrays, calendar lists
+    MEM_TODOS,              // Todo slots and treap nodes
+    MEM_INDEXES,            // Deadline heap and day buckets, reminder timers, sync indexes
+    MEM_RENDER,             // Frame buffers and terminal output buffers
+    MEM_SUBSYSTEM_COUNT
+} MemSubsystem;
+
+typedef struct {
+    size_t live;                    // Bytes allocated now
+    size_t peak;                    // Most bytes live at once
+    size_t used;                    // Of live, bytes holding data; 0 when not measured
+    unsigned long long allocations;
+    unsigned long long reallocations;
+    unsigned long long frees;
+} MemStats;
+
+// Set by --mem-report: print the footprint to stderr at exit
+extern int g_mem_report;
+
+void *wmem_malloc(MemSubsystem subsystem, size_t size);
+void *wmem_calloc(MemSubsystem subsystem, size_t count, size_t size);
+void *wmem_realloc(MemSubsystem subsystem, void *block, size_t size);
+void wmem_free(void *block);
+
+void wmem_stats(MemSubsystem subsystem, MemStats *stats);
+
+// Start reporting at exit
+void wmem_enable_report(void);
+
+// Take the numbers to report now, while the data is still loaded, with
+// used[] measured by the caller (see calset_measure). Without a checkpoint
+// the report shows what is left at exit.
+void wmem_report_checkpoint(const size_t used[MEM_SUBSYSTEM_COUNT]);
+
+#endif // WMEM_H
\ No newline at end of file